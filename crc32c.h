@@ -0,0 +1,73 @@
+/*****************************************************************************
+ * File Name:   crc32c.h
+ *
+ * Description: This file provides the CRC32C (Castagnoli) checksum used to check
+ *              images without MCUBoot format
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef CRC32C_H_
+#define CRC32C_H_
+
+#include <stdint.h>
+
+/**
+ * Fold in eight bytes per step with eight 1 KB tables. Set to 0 to use a
+ * single 1 KB table and one byte per step.
+ */
+#ifndef CRC32C_SLICE_BY_8
+#define CRC32C_SLICE_BY_8           (1u)
+#endif
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Update a CRC32C (Castagnoli, reflected polynomial 0x82F63B78).
+ *
+ * The result of one call can be passed as crc to the next call to checksum
+ * data in pieces. Start with 0.
+ *
+ * @param  crc        The CRC of the preceding data, 0 for the first call.
+ * @param  data       The pointer to data.
+ * @param  len        The length of data in bytes.
+ *
+ * @return The CRC32C of the preceding data and data.
+ */
+uint32_t crc32c_update(uint32_t crc, const uint8_t *data, uint32_t len);
+
+#endif /* CRC32C_H_ */
+
+/* [] END OF FILE */
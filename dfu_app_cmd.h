@@ -0,0 +1,215 @@
+/*****************************************************************************
+ * File Name:   dfu_app_cmd.h
+ *
+ * Description: This file contains the application DFU commands that are
+ *              handled in dfu_user.c next to the DFU middleware commands
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_APP_CMD_H_
+#define DFU_APP_CMD_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Handle the application commands below. Their packets are taken out of the
+ * received data in Cy_DFU_TransportRead() and answered there, the DFU
+ * middleware does not see them.
+ */
+#ifndef DFU_APP_CMD_ENABLE
+#define DFU_APP_CMD_ENABLE          (1u)
+#endif
+
+/** DFU packet framing: start of packet, command or status, length, checksum, end of packet */
+#define DFU_PACKET_SOP              (0x01u)
+#define DFU_PACKET_EOP              (0x17u)
+#define DFU_PACKET_OVERHEAD         (7u)
+
+/**
+ * Digest of an address range.
+ *
+ * Data:     address (4 bytes), length (4 bytes), algorithm (1 byte), little endian
+ * Response: CRC32C (4 bytes, little endian) or SHA-256 (32 bytes) of the range
+ *
+ * The range must be whole rows of the image slot, FLASH_ADDR(0) to
+ * FLASH_ADDR(IMAGE_SLOT_SIZE): other ranges fail with CY_DFU_ERROR_ADDRESS,
+ * a length that is not a multiple of the row size with CY_DFU_ERROR_LENGTH.
+ * Rows still programming are waited for first. The digest is computed in
+ * slices by dfu_app_digest_run(), the response follows the last slice.
+ */
+#define DFU_APP_CMD_RANGE_DIGEST    (0x60u)
+
+#define DFU_APP_DIGEST_CRC32C       (0x00u)
+#define DFU_APP_DIGEST_SHA256       (0x01u)     /* MCUBOOT_IMAGE builds only */
+
+/**
+ * Completed rows of the image slot, for resuming an interrupted download.
+ *
+ * Data:     image tag (4 bytes, little endian), chosen by the host for the
+ *           image it sends, e.g. its CRC32C; 0 forgets the journal
+ * Response: slot address (4 bytes), row size (2 bytes), row count (2 bytes),
+ *           little endian, then one bit per row, set when the row is
+ *           programmed, row n is bit (n % 8) of byte (n / 8)
+ *
+ * When the tag differs from the journal, the journal is restarted empty for
+ * the new tag. A session entered after the query keeps the completed rows;
+ * the host then sends the rows whose bit is clear. See DFU_NVM_RESUME.
+ */
+#define DFU_APP_CMD_RESUME_QUERY    (0x61u)
+
+/**
+ * Capabilities of the device, so the host sizes its packets and writes.
+ *
+ * Data:     none
+ * Response: version (1 byte), DFU_APP_CAP_* flags (1 byte), row size
+ *           (2 bytes), largest command packet (2 bytes), largest write
+ *           (2 bytes), little endian
+ *
+ * The largest command packet is CY_DFU_SIZEOF_CMD_BUFFER, framing included.
+ * The largest write is the data of one program data command, the sum of its
+ * send data chunks: CY_DFU_SIZEOF_DATA_BUFFER rounded down to whole rows.
+ * Cy_DFU_WriteData() writes that many contiguous rows in one call.
+ */
+#define DFU_APP_CMD_GET_CAPS        (0x62u)
+
+/**
+ * Accept the windowed write commands below in a DFU session. They let the
+ * host send up to DFU_APP_WINDOW_MAX data packets without waiting for a
+ * response to each, so the turnaround of the bus is paid once per window.
+ */
+#ifndef DFU_APP_WINDOW_ENABLE
+#define DFU_APP_WINDOW_ENABLE       (1u)
+#endif
+
+/** Data packets a host may send ahead of an acknowledgement */
+#ifndef DFU_APP_WINDOW_MAX
+#define DFU_APP_WINDOW_MAX          (16u)
+#endif
+
+/**
+ * Start windowed writes: the next data packet has sequence number 0.
+ *
+ * Data:     none
+ * Response: window (2 bytes), largest write of a data packet (2 bytes),
+ *           little endian
+ *
+ * Accepted in a DFU session only, see dfu_app_window_enable(), otherwise
+ * answered with CY_DFU_ERROR_CMD.
+ */
+#define DFU_APP_CMD_WINDOW_OPEN     (0x63u)
+
+/**
+ * Windowed write of contiguous rows.
+ *
+ * Data:     sequence number (2 bytes), DFU_APP_WINDOW_* flags (1 byte),
+ *           reserved (1 byte), address (4 bytes), CRC32C of the rows
+ *           (4 bytes), little endian, then the rows
+ * Response: only with DFU_APP_WINDOW_ACK_REQ: next sequence number
+ *           (2 bytes, little endian), result (1 byte)
+ *
+ * Packets are written in sequence order. A packet ahead of the next sequence
+ * number is a gap: it and the packets after it are dropped until the missing
+ * one arrives, and the result is CY_DFU_ERROR_DATA. A packet that fails to
+ * write stops the sequence at it, the result is its status. The response is
+ * cumulative: result CY_DFU_SUCCESS acknowledges every packet ahead of the
+ * next sequence number, any other result asks the host to send again from
+ * the next sequence number (go-back-N). Packets behind it were written
+ * before and are not written again. A corrupted packet is dropped without
+ * a response, the host sees it as a gap or as a missing acknowledgement.
+ *
+ * Rows are programmed in the background. A row that fails after its packet
+ * was handled takes the next sequence number back to that packet, and the
+ * result is CY_DFU_ERROR_DATA. The response waits until the rows of the
+ * acknowledged packets are programmed, so they never need to be sent again.
+ * A failed row that the window did not write closes the window.
+ */
+#define DFU_APP_CMD_WINDOW_DATA     (0x64u)
+
+#define DFU_APP_WINDOW_HEADER       (12u)       /* Data packet payload ahead of the rows */
+#define DFU_APP_WINDOW_ACK_REQ      (0x01u)     /* Answer this data packet */
+
+#define DFU_APP_CAPS_VERSION        (0x01u)
+
+#define DFU_APP_CAP_PIPELINE        (0x01u)     /* Rows are programmed in the background */
+#define DFU_APP_CAP_PRE_ERASE       (0x02u)     /* The slot is erased ahead of the rows */
+#define DFU_APP_CAP_RESUME          (0x04u)     /* DFU_APP_CMD_RESUME_QUERY is handled */
+#define DFU_APP_CAP_SHA256          (0x08u)     /* DFU_APP_DIGEST_SHA256 is handled */
+#define DFU_APP_CAP_WINDOW          (0x10u)     /* DFU_APP_CMD_WINDOW_* are handled */
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Accepts windowed writes in a DFU session or stops accepting them
+ *
+ * The DFU middleware accepts program data commands between its enter and
+ * exit commands only. Enable windowed writes when it enters a session and
+ * disable them when the session ends, times out or fails.
+ *
+ * @param enable    true when the session starts
+ */
+void dfu_app_window_enable(bool enable);
+
+/**
+ * @brief Tells whether windowed data packets arrived since the last call
+ *
+ * The DFU middleware does not see them, count them as session activity.
+ *
+ * @return true when data packets arrived
+ */
+bool dfu_app_window_active(void);
+
+/**
+ * @brief Tells whether a range digest is in progress
+ *
+ * The host waits for its response, read no command until it is done.
+ *
+ * @return true when dfu_app_digest_run() has slices left
+ */
+bool dfu_app_digest_pending(void);
+
+/**
+ * @brief Digests the next slice of the range of DFU_APP_CMD_RANGE_DIGEST
+ *
+ * Sends the response to the host with the last slice.
+ *
+ * @param budget    Bytes to digest in this call, non-zero
+ */
+void dfu_app_digest_run(uint32_t budget);
+
+#endif /* DFU_APP_CMD_H_ */
+
+/* [] END OF FILE */
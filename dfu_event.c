@@ -0,0 +1,129 @@
+/*****************************************************************************
+ * File Name:   dfu_event.c
+ *
+ * Description: This file provides the main loop events of dfu_event.h
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include "dfu_event.h"
+#if !defined(DFU_USER_HOST)
+#include "cy_syslib.h"
+#include "cy_syspm.h"
+#else
+#include "dfu_user_host.h"
+#endif /* !DFU_USER_HOST */
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+#if !defined(DFU_USER_HOST)
+    #define DFU_EVENT_ENTER()           Cy_SysLib_EnterCriticalSection()
+    #define DFU_EVENT_EXIT(state)       Cy_SysLib_ExitCriticalSection(state)
+
+    /* WFI ends on a pending interrupt while interrupts are masked, its handler runs after DFU_EVENT_EXIT() */
+    #define DFU_EVENT_SLEEP()           ((void) Cy_SysPm_CpuEnterSleep(CY_SYSPM_WAIT_FOR_INTERRUPT))
+
+    /* The signalling interrupt has woken the CPU already */
+    #define DFU_EVENT_WAKE()
+#else
+    #define DFU_EVENT_ENTER()           dfu_event_host_enter()
+    #define DFU_EVENT_EXIT(state)       dfu_event_host_exit(state)
+    #define DFU_EVENT_SLEEP()           dfu_event_host_sleep()
+    #define DFU_EVENT_WAKE()            dfu_event_host_wake()
+#endif /* !DFU_USER_HOST */
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+/* Events set by the interrupt handlers and not taken yet */
+static volatile uint32_t dfu_events;
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+void dfu_event_signal(uint32_t events)
+{
+    uint32_t state = DFU_EVENT_ENTER();
+
+    dfu_events |= events;
+    DFU_EVENT_WAKE();
+
+    DFU_EVENT_EXIT(state);
+}
+
+uint32_t dfu_event_take(uint32_t mask)
+{
+    uint32_t state = DFU_EVENT_ENTER();
+    uint32_t events = dfu_events & mask;
+
+    dfu_events &= ~events;
+
+    DFU_EVENT_EXIT(state);
+
+    return events;
+}
+
+uint32_t dfu_event_wait(uint32_t mask)
+{
+    /* Only interrupts set events, those set stay set until taken */
+    dfu_event_sleep(mask);
+
+    return dfu_event_take(mask);
+}
+
+void dfu_event_sleep(uint32_t mask)
+{
+    uint32_t state = DFU_EVENT_ENTER();
+
+    /* Checked and slept on with interrupts masked, an event set in between is not missed */
+    while ((dfu_events & mask) == 0u)
+    {
+        DFU_EVENT_SLEEP();
+
+        /* Run the handler of the interrupt that ended the sleep */
+        DFU_EVENT_EXIT(state);
+        state = DFU_EVENT_ENTER();
+    }
+
+    DFU_EVENT_EXIT(state);
+}
+
+/* [] END OF FILE */
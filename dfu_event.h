@@ -0,0 +1,108 @@
+/*****************************************************************************
+ * File Name:   dfu_event.h
+ *
+ * Description: This file provides the events that interrupt handlers signal
+ *              to the main loop, and the wait that sleeps until one is set
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_EVENT_H_
+#define DFU_EVENT_H_
+
+#include <stdint.h>
+
+/**
+ * Sleep in the main loop until a transport interrupt or the loop tick sets
+ * an event, instead of polling the DFU transport and waiting 1 ms per pass.
+ * A command is handled as soon as its interrupt wakes the CPU. Set to 0 for
+ * the polling loop.
+ */
+#ifndef DFU_EVENT_LOOP
+#define DFU_EVENT_LOOP              (1u)
+#endif
+
+#define DFU_EVENT_RX                (0x01u)     /* A DFU transport received data */
+#define DFU_EVENT_TICK              (0x02u)     /* A SysTick period of dfu_time.h elapsed */
+#define DFU_EVENT_APP               (0x100u)    /* First event free for the application */
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Set events and wake the main loop.
+ *
+ * May be called from interrupt handlers. An event set again before the main
+ * loop takes it is seen once.
+ *
+ * @param events    DFU_EVENT_* to set
+ */
+void dfu_event_signal(uint32_t events);
+
+/**
+ * @brief Take the events that are set, without waiting.
+ *
+ * @param mask      DFU_EVENT_* to take, the others stay set
+ *
+ * @return The events of mask that were set, now cleared
+ */
+uint32_t dfu_event_take(uint32_t mask);
+
+/**
+ * @brief Sleep until one of the events is set and take them.
+ *
+ * The events are checked with interrupts masked and the CPU sleeps in that
+ * state, so an interrupt that sets an event after the check still ends the
+ * sleep. An interrupt that sets no event of mask only wakes the CPU for its
+ * handler.
+ *
+ * @param mask      DFU_EVENT_* to wait for
+ *
+ * @return The events of mask that were set, now cleared, at least one
+ */
+uint32_t dfu_event_wait(uint32_t mask);
+
+/**
+ * @brief Sleep until one of the events is set, without taking them.
+ *
+ * As dfu_event_wait(), for a loop whose tasks take their own events, e.g.
+ * dfu_task_run().
+ *
+ * @param mask      DFU_EVENT_* to wait for
+ */
+void dfu_event_sleep(uint32_t mask);
+
+#endif /* DFU_EVENT_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,252 @@
+/*****************************************************************************
+ * File Name:   dfu_nvm.h
+ *
+ * Description: This file contains the NVM write path settings and helpers of
+ *              the DFU user interface (dfu_user.c)
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_NVM_H_
+#define DFU_NVM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#if !defined (DFU_USER_HOST)
+#include "cy_dfu.h"
+#else
+#include "dfu_user_host.h"
+#endif /* !DFU_USER_HOST */
+
+/**
+ * Program rows without blocking: Cy_DFU_WriteData() starts programming the
+ * row and returns, so the transport can receive the next row while the flash
+ * is busy, see DFU_NVM_ZERO_COPY. Set to 0 to program each row before
+ * Cy_DFU_WriteData() returns.
+ */
+#ifndef DFU_WRITE_PIPELINE
+#define DFU_WRITE_PIPELINE          (1u)
+#endif
+
+/**
+ * With DFU_WRITE_PIPELINE, program the rows straight from the buffer they
+ * arrive in, the DFU data buffer or the packet buffer of a windowed write,
+ * instead of a copy in a pipeline buffer. Saves the pipeline buffers and a
+ * row copy per row. Cy_DFU_TransportRead() does not wait before a packet is
+ * received: it waits for the row in flight once the packet is in, and
+ * receives windowed packets into two packet buffers in turn. The DFU data
+ * and packet buffers must be 4-byte aligned. Set to 0 to copy the rows.
+ */
+#ifndef DFU_NVM_ZERO_COPY
+#define DFU_NVM_ZERO_COPY           (1u)
+#endif
+
+/**
+ * Number of pipeline row buffers with DFU_NVM_ZERO_COPY 0. One buffer is
+ * programmed while the next row is copied into another one. The flash has a
+ * single operation in flight, so more than two buffers do not add overlap.
+ */
+#ifndef DFU_WRITE_PIPELINE_DEPTH
+#define DFU_WRITE_PIPELINE_DEPTH    (2u)
+#endif
+
+#if (DFU_WRITE_PIPELINE_DEPTH < 2u)
+#error "DFU_WRITE_PIPELINE_DEPTH must be at least 2"
+#endif
+
+/**
+ * Erase the target slot ahead of the rows, one erase sector at a time from
+ * dfu_nvm_pre_erase_run(), so rows that land in an erased sector are only
+ * programmed. See dfu_nvm_pre_erase_start(). Set to 0 to erase each row as
+ * it is written.
+ */
+#ifndef DFU_NVM_PRE_ERASE
+#define DFU_NVM_PRE_ERASE           (1u)
+#endif
+
+/**
+ * Keep interrupts enabled while a row of the inactive bank is programmed. In
+ * dual bank mode the firmware runs from the bank at the lower address and
+ * DFU only writes the bank at CY_DUAL_FLASH_S_SBUS_BASE, so code fetch is not
+ * stalled by the flash operation. Rows of the running bank are still written
+ * with interrupts masked. Set to 0 to mask interrupts for every row.
+ */
+#ifndef DFU_NVM_RWW
+#define DFU_NVM_RWW                 (1u)
+#endif
+
+/**
+ * Record the longest time the NVM write path keeps interrupts masked, in
+ * DWT cycles. That is the worst case latency the write path adds to any
+ * interrupt. See dfu_nvm_irq_masked_max().
+ */
+#ifndef DFU_NVM_IRQ_PROBE
+#define DFU_NVM_IRQ_PROBE           (0u)
+#endif
+
+/**
+ * Keep a journal of the completed rows of the image slot in its metadata
+ * row, so a host that lost the session sends only the missing rows. The
+ * host binds the journal to its image with DFU_APP_CMD_RESUME_QUERY, see
+ * dfu_app_cmd.h. Needs DFU_APP_CMD_ENABLE.
+ */
+#ifndef DFU_NVM_RESUME
+#define DFU_NVM_RESUME              (1u)
+#endif
+
+/**
+ * Completed rows between two journal writes. Rows completed after the last
+ * journal write are sent again after a power failure.
+ */
+#ifndef DFU_NVM_RESUME_INTERVAL
+#define DFU_NVM_RESUME_INTERVAL     (16u)
+#endif
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Wait until the row started by the last Cy_DFU_WriteData() is
+ * programmed.
+ *
+ * Must be called before the written area is read back or executed.
+ * Cy_DFU_ReadData() waits for the row itself and fails only a read or
+ * compare that holds a row that could not be programmed.
+ *
+ * A row that could not be programmed in the background makes every write of
+ * another row and this call fail until the row is written again.
+ *
+ * @return CY_DFU_SUCCESS when every written row is programmed,
+ *         CY_DFU_ERROR_DATA when a row could not be programmed
+ */
+cy_en_dfu_status_t dfu_nvm_flush(void);
+
+/**
+ * @brief Write the image metadata row of the slot.
+ *
+ * The verification cache of MCUBoot images is kept in this row, so DFU
+ * writes from the host do not reach it. Returns when the row is programmed.
+ *
+ * @param address   The metadata row address, FLASH_ADDR(IMAGE_META_OFFSET)
+ * @param row       The row data, CY_NVM_SIZEOF_ROW bytes, 4-byte aligned
+ *
+ * @return CY_DFU_SUCCESS when the row is programmed,
+ *         CY_DFU_ERROR_ADDRESS when address is not a metadata row
+ */
+cy_en_dfu_status_t dfu_nvm_meta_write(uint32_t address, const uint8_t row[]);
+
+/**
+ * @brief Start erasing a slot ahead of a DFU session.
+ *
+ * Forgets the sectors erased for the previous session and a row it could not
+ * program, and clears the verification cache of the slot. The slot must
+ * start on an erase sector of one writable range and hold at most
+ * IMAGE_SLOT_SIZE bytes, otherwise rows are erased as they are written. A
+ * locked metadata row ends the range, its sector is not erased ahead.
+ *
+ * @param address   The slot start address
+ * @param size      The slot size in bytes, a multiple of the erase sector
+ */
+void dfu_nvm_pre_erase_start(uint32_t address, uint32_t size);
+
+/**
+ * @brief Erase the next sector of the slot that has no rows written yet.
+ *
+ * Call from the main loop while a session is running. With the write
+ * pipeline the erase is started and the call returns, otherwise one sector
+ * is erased before it returns. Does nothing while the flash is busy.
+ */
+void dfu_nvm_pre_erase_run(void);
+
+/**
+ * @brief Tells whether sectors of the slot are left to erase.
+ *
+ * The main loop keeps calling dfu_nvm_pre_erase_run() without sleeping while
+ * this returns true.
+ *
+ * @return true while dfu_nvm_pre_erase_run() has sectors to erase
+ */
+bool dfu_nvm_pre_erase_pending(void);
+
+/**
+ * @brief Tells whether a row or an erase is still in flight.
+ *
+ * Polls the flash without waiting and completes a finished operation. While
+ * this returns true, the next write, read back or pre-erase waits for the
+ * flash. Always false without the write pipeline.
+ *
+ * @return true while the flash is busy
+ */
+bool dfu_nvm_busy(void);
+
+/**
+ * @brief Bind the row journal to a new DFU session.
+ *
+ * Call when a session starts, after dfu_nvm_pre_erase_start(). When the host
+ * queried the journal with DFU_APP_CMD_RESUME_QUERY before the session, the
+ * completed rows are kept and are not pre-erased. Otherwise the journal of an
+ * earlier session is dropped, the slot is about to be overwritten.
+ */
+void dfu_nvm_resume_start(void);
+
+/**
+ * @brief Write the completed rows to the journal.
+ *
+ * Cy_DFU_WriteData() does this every DFU_NVM_RESUME_INTERVAL rows. Call when
+ * the session is lost so every completed row is kept.
+ */
+void dfu_nvm_resume_checkpoint(void);
+
+/**
+ * @brief Forget the completed rows.
+ *
+ * Call when the session has ended, so a host does not resume on an image
+ * that failed authentication or was launched.
+ */
+void dfu_nvm_resume_drop(void);
+
+#if (DFU_NVM_IRQ_PROBE != 0u)
+/**
+ * @brief Longest interval the NVM write path kept interrupts masked.
+ *
+ * @param reset     Start a new measurement after reading the result
+ *
+ * @return Longest masked interval in DWT cycles
+ */
+uint32_t dfu_nvm_irq_masked_max(bool reset);
+#endif /* DFU_NVM_IRQ_PROBE */
+
+#endif /* DFU_NVM_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,560 @@
+/*****************************************************************************
+ * File Name:   dfu_task.c
+ *
+ * Description: This file provides the DFU background task of dfu_task.h
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <stdio.h>
+
+#include "cy_syslib.h"
+#include "dfu_task.h"
+#include "dfu_nvm.h"
+#include "dfu_transport.h"
+#include "dfu_app_cmd.h"
+#include "dfu_event.h"
+#include "dfu_time.h"
+#include "image_auth.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+/* Steps of dfu_task_run(), each with its own cost */
+typedef enum
+{
+    TASK_STEP_COMMAND,          /* One DFU command */
+    TASK_STEP_FINISH,           /* End of the download */
+    TASK_STEP_ERASE,            /* One sector of the pre-erase */
+    TASK_STEP_AUTH,             /* One slice of the image validation */
+    TASK_STEP_DIGEST,           /* One slice of a range digest */
+    TASK_STEP_COUNT,
+    TASK_STEP_NONE = TASK_STEP_COUNT
+} task_step_t;
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+static cy_stc_dfu_params_t *task_params;
+static uint32_t task_slot;
+
+/* State of the DFU middleware and status of its last command */
+static uint32_t task_state = CY_DFU_STATE_NONE;
+static uint32_t task_prev_state = CY_DFU_STATE_NONE;
+static cy_en_dfu_status_t task_status;
+
+/* Set while the downloaded image is being validated, and once it is valid */
+static bool task_auth_pending;
+static bool task_ready;
+
+/* A transport may hold a command, cleared when the command step runs */
+static bool task_rx;
+
+/* Set while the error response to a failed command may still be sending */
+static bool task_hold;
+
+static dfu_deadline_t task_command_deadline;
+static dfu_deadline_t task_idle_deadline;
+static dfu_deadline_t task_hold_deadline;
+
+/* Cost of each step, in microseconds, decays slowly from the longest seen */
+static uint32_t task_step_us[TASK_STEP_COUNT];
+
+/* Longest dfu_task_run() call, in microseconds */
+static uint32_t task_longest_us;
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: TaskNextStep
+ ********************************************************************************
+ * Summary:
+ *  Selects the next step, the image validation first, then a range digest,
+ *  the end of the download, a command and the pre-erase. The end of the download and the
+ *  pre-erase wait until the flash is idle, a command is read meanwhile.
+ *
+ * Return:
+ *  The step, TASK_STEP_NONE for none
+ *
+ *******************************************************************************/
+static task_step_t TaskNextStep(void);
+
+/*******************************************************************************
+ * Function Name: TaskWorkLeft
+ ********************************************************************************
+ * Summary:
+ *  Tells whether a step is left, also one that waits for the flash.
+ *
+ * Return:
+ *  true when dfu_task_run() is to be called again without sleeping
+ *
+ *******************************************************************************/
+static bool TaskWorkLeft(void);
+
+/*******************************************************************************
+ * Function Name: TaskDeadlines
+ ********************************************************************************
+ * Summary:
+ *  Ends the error response hold, and restarts a session without commands.
+ *
+ *******************************************************************************/
+static void TaskDeadlines(void);
+
+/*******************************************************************************
+ * Function Name: TaskCommand
+ ********************************************************************************
+ * Summary:
+ *  Handles one DFU command and the session state it leads to.
+ *
+ *******************************************************************************/
+static void TaskCommand(void);
+
+/*******************************************************************************
+ * Function Name: TaskFinish
+ ********************************************************************************
+ * Summary:
+ *  Starts the validation of a complete download, or restarts DFU after a
+ *  failed one.
+ *
+ *******************************************************************************/
+static void TaskFinish(void);
+
+/*******************************************************************************
+ * Function Name: TaskAuth
+ ********************************************************************************
+ * Summary:
+ *  Validates one slice of the downloaded image.
+ *
+ *******************************************************************************/
+static void TaskAuth(void);
+
+/*******************************************************************************
+ * Function Name: TaskAuthFailed
+ ********************************************************************************
+ * Summary:
+ *  Drops a downloaded image that cannot be validated and restarts DFU, the
+ *  application keeps running.
+ *
+ *******************************************************************************/
+static void TaskAuthFailed(void);
+
+/*******************************************************************************
+ * Function Name: TaskRestart
+ ********************************************************************************
+ * Summary:
+ *  Releases the transport so any host can take the next session.
+ *
+ *******************************************************************************/
+static void TaskRestart(void);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static task_step_t TaskNextStep(void)
+{
+#if (DFU_EVENT_LOOP != 0u)
+    if (dfu_event_take(DFU_EVENT_RX) != 0u)
+    {
+        task_rx = true;
+    }
+#endif /* DFU_EVENT_LOOP */
+
+    if (task_ready)
+    {
+        return TASK_STEP_NONE;
+    }
+    if (task_auth_pending)
+    {
+        return TASK_STEP_AUTH;
+    }
+    if (dfu_app_digest_pending())
+    {
+        /* The host waits for the digest, no command is read meanwhile */
+        return TASK_STEP_DIGEST;
+    }
+    if (CY_DFU_STATE_FINISHED == task_state)
+    {
+        /* The last row is programmed first */
+        return dfu_nvm_busy() ? TASK_STEP_NONE : TASK_STEP_FINISH;
+    }
+    if (task_rx && !task_hold)
+    {
+        /* Received while a row programs, Cy_DFU_TransportRead() waits for the flash once the packet is in */
+        return TASK_STEP_COMMAND;
+    }
+    if ((CY_DFU_STATE_UPDATING == task_state) && dfu_nvm_pre_erase_pending() && !dfu_nvm_busy())
+    {
+        return TASK_STEP_ERASE;
+    }
+
+    return TASK_STEP_NONE;
+}
+
+static bool TaskWorkLeft(void)
+{
+    return task_auth_pending || dfu_app_digest_pending() ||
+           (CY_DFU_STATE_FINISHED == task_state) ||
+           (task_rx && !task_hold) ||
+           ((CY_DFU_STATE_UPDATING == task_state) && dfu_nvm_pre_erase_pending());
+}
+
+static void TaskRestart(void)
+{
+#if (DFU_TRANSPORT_LISTEN != 0u)
+    dfu_transport_listen();
+#endif /* DFU_TRANSPORT_LISTEN */
+}
+
+static void TaskDeadlines(void)
+{
+    if (task_hold && dfu_deadline_expired(&task_hold_deadline))
+    {
+        task_hold = false;
+        TaskRestart();
+    }
+
+    if ((CY_DFU_STATE_UPDATING == task_state) && dfu_deadline_expired(&task_command_deadline))
+    {
+        /* No command during DFU_COMMAND_TIMEOUT_MS in a session, restart loading */
+        dfu_deadline_restart(&task_command_deadline);
+
+        /* Keep every completed row for a host that reconnects */
+        dfu_nvm_resume_checkpoint();
+        TaskRestart();
+    }
+
+    if ((CY_DFU_STATE_NONE == task_state) && dfu_deadline_expired(&task_idle_deadline))
+    {
+        /* In case, no valid user application, lets start fresh all over.
+         * This is just for demonstration.
+         * Final application can change it to either assert, reboot, enter low power mode etc,
+         * based on usecase requirements.
+         */
+        dfu_deadline_restart(&task_idle_deadline);
+    }
+}
+
+static void TaskCommand(void)
+{
+    task_rx = false;
+    task_status = Cy_DFU_Continue(&task_state, task_params);
+
+    if (CY_DFU_STATE_UPDATING == task_state)
+    {
+        if (CY_DFU_STATE_UPDATING != task_prev_state)
+        {
+            /* New session: erase the slot ahead of the rows, keep the rows of a resumed one */
+            dfu_nvm_pre_erase_start(task_slot, IMAGE_SLOT_SIZE);
+            dfu_nvm_resume_start();
+            dfu_app_window_enable(true);
+            dfu_deadline_restart(&task_command_deadline);
+
+#if (DFU_TRANSPORT_LISTEN != 0u)
+            cy_en_dfu_transport_t transport;
+
+            if (dfu_transport_locked(&transport))
+            {
+                printf("DFU host on transport %u\r\n", (unsigned int)transport);
+            }
+#endif /* DFU_TRANSPORT_LISTEN */
+        }
+
+        if ((task_status == CY_DFU_SUCCESS) || dfu_app_window_active())
+        {
+            /* Windowed data packets do not reach the DFU middleware */
+            dfu_deadline_restart(&task_command_deadline);
+        }
+        else if (task_status != CY_DFU_ERROR_TIMEOUT)
+        {
+            dfu_deadline_restart(&task_command_deadline);
+            dfu_nvm_resume_checkpoint();
+
+            /* The transport still may be sending the error response to the host */
+            task_hold = true;
+            dfu_deadline_start(&task_hold_deadline, DFU_TASK_RESPONSE_MS);
+        }
+    }
+    else if (CY_DFU_STATE_FAILED == task_state)
+    {
+        dfu_deadline_restart(&task_idle_deadline);
+        dfu_app_window_enable(false);
+        dfu_nvm_resume_checkpoint();
+        (void) Cy_DFU_Init(&task_state, task_params);
+
+        /* Let any host take the next session */
+        TaskRestart();
+        printf("DFU_STATE_FAILED: %s \r\n", dfu_status_in_str(task_status));
+    }
+
+    task_prev_state = task_state;
+}
+
+static void TaskFinish(void)
+{
+    int status;
+
+    dfu_deadline_restart(&task_idle_deadline);
+    dfu_app_window_enable(false);
+
+    if (CY_DFU_SUCCESS == task_status)
+    {
+        /* The flash is idle, the last row is programmed */
+        task_status = dfu_nvm_flush();
+
+#if (DFU_NVM_IRQ_PROBE != 0u)
+        uint32_t masked = dfu_nvm_irq_masked_max(true);
+        printf("\r\nLongest NVM interrupt mask (%s): %lu cycles, %lu us\r\n",
+               (DFU_NVM_RWW != 0u) ? "RWW" : "masked", (unsigned long)masked,
+               (unsigned long)(masked / (SystemCoreClock / 1000000u)));
+#endif /* DFU_NVM_IRQ_PROBE */
+    }
+
+    if (CY_DFU_SUCCESS == task_status)
+    {
+        printf("\r\nAuthenticating  Application\r\n");
+
+        /* Validate image */
+        status = image_auth_job_start(task_slot);
+
+        if (status != 0)
+        {
+            TaskAuthFailed();
+        }
+        else
+        {
+            task_auth_pending = true;
+        }
+    }
+    else
+    {
+        dfu_nvm_resume_checkpoint();
+        (void) Cy_DFU_Init(&task_state, task_params);
+        TaskRestart();
+        printf("DFU_STATE_FINISHED: %s \r\n", dfu_status_in_str(task_status));
+    }
+
+    task_prev_state = task_state;
+}
+
+static void TaskAuth(void)
+{
+    int status = image_auth_job_run(DFU_TASK_AUTH_SLICE_SIZE);
+
+    if (status == 0)
+    {
+#if defined (MCUBOOT_IMAGE)
+        /* Imported keys are not needed by the application */
+        image_auth_keys_release();
+#endif /* MCUBOOT_IMAGE */
+
+        /* Nothing to resume on a launched image */
+        dfu_nvm_resume_drop();
+
+        task_auth_pending = false;
+        task_ready = true;
+        printf("Image Authentication successful\r\n");
+    }
+    else if (status != IMAGE_AUTH_JOB_PENDING)
+    {
+        TaskAuthFailed();
+    }
+}
+
+static void TaskAuthFailed(void)
+{
+    task_auth_pending = false;
+    task_status = CY_DFU_ERROR_VERIFY;
+    dfu_deadline_restart(&task_idle_deadline);
+
+    /* The host must not resume on rows that failed authentication */
+    dfu_nvm_resume_drop();
+    (void) Cy_DFU_Init(&task_state, task_params);
+    task_prev_state = task_state;
+
+    /* Let any host take the next session */
+    TaskRestart();
+    printf("Image Authentication failed: %s \r\n", dfu_status_in_str(task_status));
+}
+
+cy_en_dfu_status_t dfu_task_init(cy_stc_dfu_params_t *params, uint32_t slot)
+{
+    task_params = params;
+    task_slot = slot;
+    task_prev_state = CY_DFU_STATE_NONE;
+    task_auth_pending = false;
+    task_ready = false;
+    task_rx = false;
+    task_hold = false;
+
+    dfu_deadline_start(&task_command_deadline, DFU_COMMAND_TIMEOUT_MS);
+    dfu_deadline_start(&task_idle_deadline, DFU_IDLE_TIMEOUT_MS);
+    dfu_transport_read_limit(DFU_TASK_READ_TIMEOUT_MS);
+
+    task_status = Cy_DFU_Init(&task_state, task_params);
+
+    return task_status;
+}
+
+dfu_task_status_t dfu_task_run(uint32_t budget_us)
+{
+    uint32_t start = dfu_time_us();
+    uint32_t elapsed = 0u;
+    uint32_t now;
+    task_step_t step;
+
+#if (DFU_EVENT_LOOP != 0u)
+    /* The tick only wakes the loop for the deadlines */
+    (void) dfu_event_take(DFU_EVENT_TICK);
+#else
+    /* Without events, poll the transport once per call */
+    task_rx = true;
+#endif /* DFU_EVENT_LOOP */
+
+    TaskDeadlines();
+
+    for (step = TaskNextStep(); step != TASK_STEP_NONE; step = TaskNextStep())
+    {
+        /* A step starts when its cost fits the rest of the budget, the first one always */
+        if ((elapsed != 0u) && ((elapsed + task_step_us[step]) > budget_us))
+        {
+            break;
+        }
+
+        switch (step)
+        {
+            case TASK_STEP_COMMAND:
+                TaskCommand();
+                break;
+            case TASK_STEP_FINISH:
+                TaskFinish();
+                break;
+            case TASK_STEP_ERASE:
+                dfu_nvm_pre_erase_run();
+                break;
+            case TASK_STEP_AUTH:
+                TaskAuth();
+                break;
+            case TASK_STEP_DIGEST:
+                dfu_app_digest_run(DFU_TASK_AUTH_SLICE_SIZE);
+                break;
+            default:
+                break;
+        }
+
+        now = dfu_time_us() - start;
+
+        /* The longest cost seen, decaying by an eighth per step */
+        task_step_us[step] -= task_step_us[step] / 8u;
+        if ((now - elapsed) > task_step_us[step])
+        {
+            task_step_us[step] = now - elapsed;
+        }
+
+        /* At least 1 us, so the next step checks the budget */
+        elapsed = (now != 0u) ? now : 1u;
+    }
+
+    if (elapsed > task_longest_us)
+    {
+        task_longest_us = elapsed;
+    }
+
+    if (task_ready)
+    {
+        return DFU_TASK_READY;
+    }
+
+    return TaskWorkLeft() ? DFU_TASK_BUSY : DFU_TASK_IDLE;
+}
+
+uint32_t dfu_task_longest_us(bool reset)
+{
+    uint32_t longest = task_longest_us;
+
+    if (reset)
+    {
+        task_longest_us = 0u;
+    }
+
+    return longest;
+}
+
+const char *dfu_status_in_str(cy_en_dfu_status_t dfu_status)
+{
+    switch (dfu_status)
+    {
+        case CY_DFU_SUCCESS:
+            return "DFU: success";
+
+        case CY_DFU_ERROR_VERIFY:
+            return "DFU:Verification failed";
+
+        case CY_DFU_ERROR_LENGTH:
+            return "DFU: The length the packet is outside of the expected range";
+
+        case CY_DFU_ERROR_DATA:
+            return "DFU: The data in the received packet is invalid";
+
+        case CY_DFU_ERROR_CMD:
+            return "DFU: The command is not recognized";
+
+        case CY_DFU_ERROR_CHECKSUM:
+            return "DFU: The checksum does not match the expected value ";
+
+        case CY_DFU_ERROR_ADDRESS:
+            return "DFU: The wrong address";
+
+        case CY_DFU_ERROR_TIMEOUT:
+            return "DFU: The command timed out";
+
+        case CY_DFU_ERROR_BAD_PARAM:
+            return "DFU: One or more of input parameters are invalid";
+
+        case CY_DFU_ERROR_UNKNOWN:
+            return "DFU: did not recognize error";
+
+        default:
+            return "Not recognized DFU status code";
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,156 @@
+/*****************************************************************************
+ * File Name:   dfu_task.h
+ *
+ * Description: This file contains the DFU background task, which runs the
+ *              DFU state machine beside the application with a CPU budget
+ *              per call
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_TASK_H_
+#define DFU_TASK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "cy_dfu.h"
+
+/**
+ * CPU time of one dfu_task_run() call, in microseconds, for callers that
+ * have no budget of their own. See dfu_task_run().
+ */
+#ifndef DFU_TASK_BUDGET_US
+#define DFU_TASK_BUDGET_US          (2000u)
+#endif
+
+/**
+ * Longest wait of Cy_DFU_Continue() for the rest of a packet, in
+ * milliseconds. A packet that takes longer is handled by a later call.
+ * Caps the read timeout of the DFU parameters, the responses keep theirs.
+ */
+#ifndef DFU_TASK_READ_TIMEOUT_MS
+#define DFU_TASK_READ_TIMEOUT_MS    (1u)
+#endif
+
+/** Image bytes hashed per validation or range digest step */
+#ifndef DFU_TASK_AUTH_SLICE_SIZE
+#define DFU_TASK_AUTH_SLICE_SIZE    (1024u)
+#endif
+
+/** Time for the error response to a failed command before the transports restart, in milliseconds */
+#ifndef DFU_TASK_RESPONSE_MS
+#define DFU_TASK_RESPONSE_MS        (20u)
+#endif
+
+/** No command in a DFU session for this long ends it, in milliseconds */
+#ifndef DFU_COMMAND_TIMEOUT_MS
+#define DFU_COMMAND_TIMEOUT_MS      (5000u)
+#endif
+
+/** No DFU session for this long, in milliseconds */
+#ifndef DFU_IDLE_TIMEOUT_MS
+#define DFU_IDLE_TIMEOUT_MS         (300000u)
+#endif
+
+/** Result of dfu_task_run() */
+typedef enum
+{
+    DFU_TASK_IDLE,              /* Nothing to do until the next DFU event */
+    DFU_TASK_BUSY,              /* Work left, call again without sleeping */
+    DFU_TASK_READY,             /* The downloaded image is valid and can be launched */
+} dfu_task_status_t;
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Initialize the DFU state machine.
+ *
+ * Start the time base of dfu_time.h first, then start the transports. The
+ * read timeout of the transports is capped to DFU_TASK_READ_TIMEOUT_MS.
+ *
+ * @param params    DFU parameters with the DFU buffers, must stay valid
+ * @param slot      Start address of the slot the image is downloaded to
+ *
+ * @return Status of Cy_DFU_Init()
+ */
+cy_en_dfu_status_t dfu_task_init(cy_stc_dfu_params_t *params, uint32_t slot);
+
+/**
+ * @brief Run the DFU state machine for at most about budget_us of CPU time.
+ *
+ * The work is done in steps: one DFU command, one sector of the pre-erase,
+ * or one slice of the image validation or of a range digest. A step starts only when its last
+ * cost fits the rest of the budget, the first step of a call always runs.
+ * Commands are read while a row programs, the read waits for the flash
+ * only once the packet is in. Steps that cannot be split exceed the
+ * budget: a write of several rows, the signature verification, and any
+ * step without the write pipeline.
+ *
+ * An image that fails validation is dropped and DFU starts over, the call
+ * returns DFU_TASK_IDLE.
+ *
+ * With DFU_EVENT_LOOP, commands are read after DFU_EVENT_RX only. The call
+ * takes DFU_EVENT_RX and DFU_EVENT_TICK.
+ *
+ * @param budget_us CPU time for this call, in microseconds
+ *
+ * @return DFU_TASK_IDLE when the caller may sleep until the next DFU event,
+ *         DFU_TASK_BUSY when work is left, DFU_TASK_READY once the image
+ *         is valid
+ */
+dfu_task_status_t dfu_task_run(uint32_t budget_us);
+
+/**
+ * @brief Longest dfu_task_run() call, the worst case the DFU adds to a pass
+ * of the application loop.
+ *
+ * @param reset     Start a new measurement after reading the result
+ *
+ * @return The longest call in microseconds
+ */
+uint32_t dfu_task_longest_us(bool reset);
+
+/**
+ * @brief Convert a DFU status to text.
+ *
+ * @param dfu_status    DFU status
+ *
+ * @return The text of the status
+ */
+const char *dfu_status_in_str(cy_en_dfu_status_t dfu_status);
+
+#endif /* DFU_TASK_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,206 @@
+/*****************************************************************************
+ * File Name:   dfu_time.c
+ *
+ * Description: This file provides the time base and deadlines of dfu_time.h
+ *              on SysTick
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <stddef.h>
+
+#include "dfu_time.h"
+#include "cy_syslib.h"
+#include "cy_systick.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+/* SysTick callback slot of the time base */
+#define DFU_TIME_CALLBACK           (0u)
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+/* SysTick periods since dfu_time_start() */
+static volatile uint32_t time_ticks;
+
+/* CPU clock cycles per SysTick period, millisecond and microsecond */
+static uint32_t time_tick_cycles;
+static uint32_t time_ms_cycles;
+static uint32_t time_us_cycles;
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/*******************************************************************************
+ * Function Name: TimeTick
+ ********************************************************************************
+ * Summary:
+ *  SysTick callback, counts the periods.
+ *
+ *******************************************************************************/
+static void TimeTick(void);
+
+/*******************************************************************************
+ * Function Name: TimeRead
+ ********************************************************************************
+ * Summary:
+ *  Reads the SysTick periods and the cycles into the current one as a
+ *  consistent pair.
+ *
+ * Parameters:
+ *  cycles - Receives the cycles elapsed in the current period
+ *
+ * Return:
+ *  The SysTick periods since dfu_time_start()
+ *
+ *******************************************************************************/
+static uint32_t TimeRead(uint32_t *cycles);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static void TimeTick(void)
+{
+    time_ticks++;
+}
+
+static uint32_t TimeRead(uint32_t *cycles)
+{
+    uint32_t ticks;
+    uint32_t value;
+    bool pending;
+
+    /* A period that ends between the reads is counted by the handler, read again */
+    do
+    {
+        ticks = time_ticks;
+        value = Cy_SysTick_GetValue();
+        pending = ((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0u);
+    } while (ticks != time_ticks);
+
+    *cycles = (time_tick_cycles - 1u) - value;
+
+    /* With interrupts masked, a period that ended is pending and not counted yet */
+    if (pending && (*cycles < (time_tick_cycles / 2u)))
+    {
+        ticks++;
+    }
+
+    return ticks;
+}
+
+void dfu_time_start(void)
+{
+    time_ms_cycles = SystemCoreClock / 1000u;
+    time_us_cycles = SystemCoreClock / 1000000u;
+    time_tick_cycles = time_ms_cycles * DFU_TIME_TICK_MS;
+    time_ticks = 0u;
+
+    /* The reload value is 24 bits */
+    CY_ASSERT((time_tick_cycles - 1u) <= SysTick_LOAD_RELOAD_Msk);
+
+    Cy_SysTick_Init(CY_SYSTICK_CLOCK_SOURCE_CLK_CPU, time_tick_cycles - 1u);
+    (void) Cy_SysTick_SetCallback(DFU_TIME_CALLBACK, TimeTick);
+}
+
+void dfu_time_stop(void)
+{
+    Cy_SysTick_Disable();
+    (void) Cy_SysTick_SetCallback(DFU_TIME_CALLBACK, NULL);
+}
+
+uint32_t dfu_time_ms(void)
+{
+    uint32_t cycles;
+    uint32_t ticks = TimeRead(&cycles);
+
+    return (ticks * DFU_TIME_TICK_MS) + (cycles / time_ms_cycles);
+}
+
+uint32_t dfu_time_us(void)
+{
+    uint32_t cycles;
+    uint32_t ticks = TimeRead(&cycles);
+
+    return (ticks * DFU_TIME_TICK_MS * 1000u) + (cycles / time_us_cycles);
+}
+
+void dfu_deadline_start(dfu_deadline_t *deadline, uint32_t period)
+{
+    deadline->start = dfu_time_ms();
+    deadline->period = period;
+}
+
+void dfu_deadline_restart(dfu_deadline_t *deadline)
+{
+    deadline->start = dfu_time_ms();
+}
+
+bool dfu_deadline_expired(const dfu_deadline_t *deadline)
+{
+    return ((dfu_time_ms() - deadline->start) >= deadline->period);
+}
+
+bool dfu_deadline_periodic(dfu_deadline_t *deadline)
+{
+    uint32_t now = dfu_time_ms();
+    uint32_t elapsed = now - deadline->start;
+
+    if (elapsed < deadline->period)
+    {
+        return false;
+    }
+
+    if (elapsed < (2u * deadline->period))
+    {
+        deadline->start += deadline->period;
+    }
+    else
+    {
+        deadline->start = now;
+    }
+
+    return true;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,141 @@
+/*****************************************************************************
+ * File Name:   dfu_time.h
+ *
+ * Description: This file contains the monotonic time base and the deadlines
+ *              of the DFU main loop
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_TIME_H_
+#define DFU_TIME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Period of the SysTick interrupt, in milliseconds. Time between ticks is
+ * read from the SysTick counter, so this only sets how often the interrupt
+ * runs, and with DFU_EVENT_LOOP how often the loop wakes without a command.
+ * One period must fit the 24-bit counter at the CPU clock.
+ */
+#ifndef DFU_TIME_TICK_MS
+#define DFU_TIME_TICK_MS            (20u)
+#endif
+
+/**
+ * A time limit of the main loop, in milliseconds of dfu_time_ms(). Compared
+ * by the time elapsed since its start, so it expires correctly across the
+ * wrap of dfu_time_ms() for periods up to 2^31 ms.
+ */
+typedef struct
+{
+    uint32_t start;             /* dfu_time_ms() when the deadline was started */
+    uint32_t period;            /* Milliseconds from start to expiry */
+} dfu_deadline_t;
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Start the SysTick time base at 0.
+ *
+ * SysTick runs from the CPU clock. Callbacks from 1 on are free for the
+ * application, e.g. a tick event of the main loop.
+ */
+void dfu_time_start(void);
+
+/**
+ * @brief Stop the SysTick time base before launching an application.
+ */
+void dfu_time_stop(void);
+
+/**
+ * @brief Milliseconds since dfu_time_start().
+ *
+ * Wraps after 2^32 ms. Callable with interrupts masked.
+ *
+ * @return The time in milliseconds
+ */
+uint32_t dfu_time_ms(void);
+
+/**
+ * @brief Microseconds since dfu_time_start().
+ *
+ * Wraps after 2^32 us, about 71 minutes. Callable with interrupts masked.
+ *
+ * @return The time in microseconds
+ */
+uint32_t dfu_time_us(void);
+
+/**
+ * @brief Start a deadline period milliseconds from now.
+ *
+ * @param deadline  Deadline to start
+ * @param period    Milliseconds to expiry, up to 2^31
+ */
+void dfu_deadline_start(dfu_deadline_t *deadline, uint32_t period);
+
+/**
+ * @brief Start a deadline again from now, with its period.
+ *
+ * @param deadline  Deadline to restart
+ */
+void dfu_deadline_restart(dfu_deadline_t *deadline);
+
+/**
+ * @brief Tell whether the period of a deadline has elapsed.
+ *
+ * @param deadline  Deadline to check
+ *
+ * @return true when expired
+ */
+bool dfu_deadline_expired(const dfu_deadline_t *deadline);
+
+/**
+ * @brief Tell whether a periodic deadline expired, and start its next period.
+ *
+ * The next period starts at the expiry, so the periods do not drift by the
+ * time the loop takes to check. When the loop fell behind by more than one
+ * period, the periods missed are dropped and the next starts now.
+ *
+ * @param deadline  Deadline to check
+ *
+ * @return true once per expired period
+ */
+bool dfu_deadline_periodic(dfu_deadline_t *deadline);
+
+#endif /* DFU_TIME_H_ */
+
+/* [] END OF FILE */
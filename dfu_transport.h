@@ -0,0 +1,178 @@
+/*****************************************************************************
+ * File Name:   dfu_transport.h
+ *
+ * Description: This file contains the DFU transport interface of the DFU
+ *              user interface (dfu_user.c)
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_TRANSPORT_H_
+#define DFU_TRANSPORT_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#if !defined (DFU_USER_HOST)
+#include "cy_dfu.h"
+#else
+#include "dfu_user_host.h"
+#endif /* !DFU_USER_HOST */
+
+/* Number of DFU transports enabled with COMPONENT_DFU_* */
+#if defined(COMPONENT_DFU_I2C)
+    #define DFU_TRANSPORT_COUNT_I2C     (1u)
+#else
+    #define DFU_TRANSPORT_COUNT_I2C     (0u)
+#endif /* COMPONENT_DFU_I2C */
+#if defined(COMPONENT_DFU_UART)
+    #define DFU_TRANSPORT_COUNT_UART    (1u)
+#else
+    #define DFU_TRANSPORT_COUNT_UART    (0u)
+#endif /* COMPONENT_DFU_UART */
+#if defined(COMPONENT_DFU_SPI)
+    #define DFU_TRANSPORT_COUNT_SPI     (1u)
+#else
+    #define DFU_TRANSPORT_COUNT_SPI     (0u)
+#endif /* COMPONENT_DFU_SPI */
+#if defined(COMPONENT_DFU_CANFD)
+    #define DFU_TRANSPORT_COUNT_CANFD   (1u)
+#else
+    #define DFU_TRANSPORT_COUNT_CANFD   (0u)
+#endif /* COMPONENT_DFU_CANFD */
+
+#define DFU_TRANSPORT_COUNT         (DFU_TRANSPORT_COUNT_I2C + DFU_TRANSPORT_COUNT_UART + \
+                                     DFU_TRANSPORT_COUNT_SPI + DFU_TRANSPORT_COUNT_CANFD)
+
+/**
+ * Allow a transport to be registered with dfu_transport_register(), e.g. a
+ * loopback for host testing. While 0, a build with a single COMPONENT_DFU_*
+ * calls that transport directly, without the function table.
+ */
+#ifndef DFU_TRANSPORT_REGISTER
+#define DFU_TRANSPORT_REGISTER      (0u)
+#endif
+
+/**
+ * Listen on all transports with dfu_transport_listen() and lock onto the one
+ * that receives the first valid packet. Enabled by default when more than one
+ * COMPONENT_DFU_* is enabled.
+ */
+#ifndef DFU_TRANSPORT_LISTEN
+    #if (DFU_TRANSPORT_COUNT > 1u)
+        #define DFU_TRANSPORT_LISTEN    (1u)
+    #else
+        #define DFU_TRANSPORT_LISTEN    (0u)
+    #endif /* DFU_TRANSPORT_COUNT > 1u */
+#endif
+
+/**
+ * Read timeout in milliseconds for each transport without a pending()
+ * check, per listening pass of Cy_DFU_TransportRead().
+ */
+#ifndef DFU_TRANSPORT_LISTEN_SLICE_MS
+#define DFU_TRANSPORT_LISTEN_SLICE_MS   (1u)
+#endif
+
+/**
+ * Operations of a DFU transport, with the signatures of the transport
+ * functions of the DFU middleware (e.g. I2C_I2cCyBtldrCommRead()).
+ * Cy_DFU_TransportStart() selects one, the other Cy_DFU_Transport*()
+ * functions call it through this table.
+ *
+ * pending() is optional: it tells without waiting whether a packet may have
+ * arrived, so that an idle transport costs no read while listening. The DFU
+ * middleware transports have none.
+ */
+typedef struct
+{
+    void (*start)(void);
+    void (*stop)(void);
+    void (*reset)(void);
+    cy_en_dfu_status_t (*read)(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+    cy_en_dfu_status_t (*write)(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+    bool (*pending)(void);
+} dfu_transport_t;
+
+/**
+ * @brief Caps the read timeout of Cy_DFU_TransportRead()
+ *
+ * The DFU middleware passes one timeout for its reads and writes. A shorter
+ * read timeout bounds the time Cy_DFU_Continue() waits for a packet, while
+ * responses keep the middleware timeout. A packet not complete within the
+ * read timeout is read by a later call.
+ *
+ * @param timeout   Longest read timeout in milliseconds, 0 for none
+ */
+void dfu_transport_read_limit(uint32_t timeout);
+
+#if (DFU_TRANSPORT_REGISTER != 0u)
+/**
+ * @brief Registers a transport for a transport ID
+ *
+ * The next Cy_DFU_TransportStart() with the ID uses the transport instead of
+ * the built-in one, also for an ID without a COMPONENT_DFU_*. Call before
+ * Cy_DFU_TransportStart(). A transport passed as NULL restores the built-in
+ * transports.
+ *
+ * @param id        Transport ID passed to Cy_DFU_TransportStart()
+ * @param transport Transport operations, must stay valid while in use
+ */
+void dfu_transport_register(cy_en_dfu_transport_t id, const dfu_transport_t *transport);
+#endif /* DFU_TRANSPORT_REGISTER */
+
+#if (DFU_TRANSPORT_LISTEN != 0u)
+/**
+ * @brief Starts all transports and listens on them
+ *
+ * Starts the transports built with COMPONENT_DFU_* and the registered one,
+ * and sets up the NVM as Cy_DFU_TransportStart() does. Cy_DFU_TransportRead()
+ * then polls them in turn until one receives a valid DFU packet, stops the
+ * others and reads only that one from then on. Call again to release the
+ * transport, e.g. when a session times out, so that another host can take
+ * over. Use instead of Cy_DFU_TransportStart().
+ */
+void dfu_transport_listen(void);
+
+/**
+ * @brief Gets the transport the DFU locked onto
+ *
+ * @param id    The ID of the transport, set when locked
+ *
+ * @return true when a transport received the first valid packet
+ */
+bool dfu_transport_locked(cy_en_dfu_transport_t *id);
+#endif /* DFU_TRANSPORT_LISTEN */
+
+#endif /* DFU_TRANSPORT_H_ */
+
+/* [] END OF FILE */
@@ -41,11 +41,22 @@
  *****************************************************************************/
 
 
+#include <stddef.h>
 #include <string.h>
+#if !defined (DFU_USER_HOST)
 #include "cy_dfu.h"
 #include "cy_dfu_logging.h"
+#include "cy_flash.h"
 #include "mtb_hal_nvm.h"
 #include "mtb_hal_system.h"
+#else
+#include "dfu_user_host.h"
+#endif /* !DFU_USER_HOST */
+#include "image_auth.h"
+#include "dfu_nvm.h"
+#include "dfu_app_cmd.h"
+#include "crc32c.h"
+#include "dfu_transport.h"
 
 #ifdef COMPONENT_DFU_I2C
     #include "transport_i2c.h"
@@ -63,24 +74,318 @@
     #include "transport_canfd.h"
 #endif  /* COMPONENT_DFU_CANFD */
 
-#if !defined(COMPONENT_DFU_I2C) && !defined(COMPONENT_DFU_UART) && !defined(COMPONENT_DFU_SPI) &&\
-    !defined(COMPONENT_DFU_CANFD)
+#if (DFU_TRANSPORT_COUNT == 0u) && (DFU_TRANSPORT_REGISTER == 0u)
     #warning "Select at least one of the DFU transports."
-#endif /* !defined(COMPONENT_DFU_I2C) ... !defined(COMPONENT_DFU_CANFD) */
+#endif /* (DFU_TRANSPORT_COUNT == 0u) && (DFU_TRANSPORT_REGISTER == 0u) */
 
 
 #if !defined COMPONENT_CAT1B || !defined COMPONENT_NON_SECURE_DEVICE
     static mtb_hal_nvm_t nvm_obj;
 #endif /* !defined COMPONENT_CAT1B || !defined COMPONENT_NON_SECURE_DEVICE */
 
-static cy_en_dfu_transport_t selectedInterface = CY_DFU_UART;
+/* Transport functions of the DFU middleware, prefix##Start() to prefix##Write(), without pending() */
+#define DFU_TRANSPORT_OPS(prefix)   { prefix##Start, prefix##Stop, prefix##Reset, prefix##Read, prefix##Write, NULL }
+
+/* A single transport is called directly, without the function table */
+#if (DFU_TRANSPORT_COUNT == 1u) && (DFU_TRANSPORT_REGISTER == 0u) && (DFU_TRANSPORT_LISTEN == 0u)
+    #define DFU_TRANSPORT_DIRECT        (1u)
+    #if defined(COMPONENT_DFU_I2C)
+        #define DFU_TRANSPORT_ID            (CY_DFU_I2C)
+        #define DFU_TRANSPORT_FN(op)        I2C_I2cCyBtldrComm##op
+    #elif defined(COMPONENT_DFU_UART)
+        #define DFU_TRANSPORT_ID            (CY_DFU_UART)
+        #define DFU_TRANSPORT_FN(op)        UART_UartCyBtldrComm##op
+    #elif defined(COMPONENT_DFU_SPI)
+        #define DFU_TRANSPORT_ID            (CY_DFU_SPI)
+        #define DFU_TRANSPORT_FN(op)        SPI_SpiCyBtldrComm##op
+    #else
+        #define DFU_TRANSPORT_ID            (CY_DFU_CANFD)
+        #define DFU_TRANSPORT_FN(op)        CANFD_CanfdCyBtldrComm##op
+    #endif /* COMPONENT_DFU_I2C */
+#else
+    #define DFU_TRANSPORT_DIRECT        (0u)
+#endif /* (DFU_TRANSPORT_COUNT == 1u) && (DFU_TRANSPORT_REGISTER == 0u) && (DFU_TRANSPORT_LISTEN == 0u) */
 
-#ifdef CY_IP_M7CPUSS
-    static const mtb_hal_nvm_region_info_t* blocks_info;
-    static uint8_t blocks_count;
-    static uint32_t blocks_sector_size;
+#if (DFU_TRANSPORT_DIRECT == 0u)
+static void TransportNoneControl(void);
+static cy_en_dfu_status_t TransportNoneData(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+static const dfu_transport_t *TransportSelect(cy_en_dfu_transport_t transport);
+static void TransportPrepare(void);
+
+#ifdef COMPONENT_DFU_I2C
+static const dfu_transport_t transport_i2c = DFU_TRANSPORT_OPS(I2C_I2cCyBtldrComm);
+#endif /* COMPONENT_DFU_I2C */
+#ifdef COMPONENT_DFU_UART
+static const dfu_transport_t transport_uart = DFU_TRANSPORT_OPS(UART_UartCyBtldrComm);
+#endif /* COMPONENT_DFU_UART */
+#ifdef COMPONENT_DFU_SPI
+static const dfu_transport_t transport_spi = DFU_TRANSPORT_OPS(SPI_SpiCyBtldrComm);
+#endif /* COMPONENT_DFU_SPI */
+#ifdef COMPONENT_DFU_CANFD
+static const dfu_transport_t transport_canfd = DFU_TRANSPORT_OPS(CANFD_CanfdCyBtldrComm);
+#endif /* COMPONENT_DFU_CANFD */
+
+/* Stands in for a transport that is not built, until Cy_DFU_TransportStart() */
+static const dfu_transport_t transport_none =
+{
+    TransportNoneControl, TransportNoneControl, TransportNoneControl, TransportNoneData, TransportNoneData, NULL
+};
+
+/* Transport selected in Cy_DFU_TransportStart() */
+static const dfu_transport_t *transport_active = &transport_none;
+
+#if (DFU_TRANSPORT_REGISTER != 0u)
+static cy_en_dfu_transport_t transport_registered_id;
+static const dfu_transport_t *transport_registered;
+#endif /* DFU_TRANSPORT_REGISTER */
+
+#if (DFU_TRANSPORT_LISTEN != 0u)
+static void TransportListenStop(void);
+static void TransportListenReset(void);
+static cy_en_dfu_status_t TransportListenRead(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+static bool PacketValid(const uint8_t packet[], uint32_t count);
+
+/* A transport listened on by dfu_transport_listen() */
+typedef struct
+{
+    cy_en_dfu_transport_t id;
+    const dfu_transport_t *ops;
+} dfu_transport_entry_t;
+
+/* Active while listening: reads all transports until one locks, writes none */
+static const dfu_transport_t transport_listen =
+{
+    TransportNoneControl, TransportListenStop, TransportListenReset, TransportListenRead, TransportNoneData, NULL
+};
+
+#if (DFU_TRANSPORT_COUNT > 0u)
+/* IDs of the transports built with COMPONENT_DFU_* */
+static const cy_en_dfu_transport_t transport_builtin_ids[DFU_TRANSPORT_COUNT] =
+{
+#ifdef COMPONENT_DFU_I2C
+    CY_DFU_I2C,
+#endif /* COMPONENT_DFU_I2C */
+#ifdef COMPONENT_DFU_UART
+    CY_DFU_UART,
+#endif /* COMPONENT_DFU_UART */
+#ifdef COMPONENT_DFU_SPI
+    CY_DFU_SPI,
+#endif /* COMPONENT_DFU_SPI */
+#ifdef COMPONENT_DFU_CANFD
+    CY_DFU_CANFD,
+#endif /* COMPONENT_DFU_CANFD */
+};
+#endif /* DFU_TRANSPORT_COUNT > 0u */
+
+/* Built-in transports plus the registered one */
+static dfu_transport_entry_t transport_listen_set[DFU_TRANSPORT_COUNT + DFU_TRANSPORT_REGISTER];
+static uint32_t transport_listen_count;
+static cy_en_dfu_transport_t transport_locked_id;
+static bool transport_locked;
+#endif /* DFU_TRANSPORT_LISTEN */
+#endif /* DFU_TRANSPORT_DIRECT */
+
+/* Longest read timeout of Cy_DFU_TransportRead(), 0 for none */
+static uint32_t transport_read_limit;
+
+/* Capacity of the address range table: base regions plus the pieces they are split into */
+#define DFU_NVM_RANGE_MAX           (16u)
+
+/* Address range access flags */
+#define DFU_NVM_RANGE_READ          (0x01u)
+#define DFU_NVM_RANGE_WRITE         (0x02u)
+#define DFU_NVM_RANGE_GOLDEN        (0x04u) /* Writable only while the golden app is invalid */
+#define DFU_NVM_RANGE_META          (0x08u) /* The image metadata row, see dfu_nvm_meta_write() */
+
+/* The verification cache in the metadata row is trusted, the host must not write that row */
+#if defined(MCUBOOT_IMAGE) && (IMAGE_AUTH_CACHE != 0u)
+    #define DFU_NVM_META_LOCKED     (1u)
+#else
+    #define DFU_NVM_META_LOCKED     (0u)
+#endif
+
+/* Address range with the same access rules, last is inclusive */
+typedef struct
+{
+    uint32_t start;
+    uint32_t last;
+    uint32_t sector_size;
+    uint16_t flags;
+    uint16_t app;
+} dfu_nvm_range_t;
+
+/* Non-overlapping ranges sorted by start, built by NvmRangesBuild() */
+static dfu_nvm_range_t nvm_ranges[DFU_NVM_RANGE_MAX];
+static uint32_t nvm_range_count;
+static bool nvm_ranges_built;
+
+/* The completed rows of the image slot are journaled where rows are written one at a time */
+#if (DFU_NVM_RESUME != 0u) && (DFU_APP_CMD_ENABLE != 0u) && !defined(CY_IP_M7CPUSS) && \
+    (!defined COMPONENT_CAT1B || !defined COMPONENT_NON_SECURE_DEVICE)
+    #define DFU_NVM_JOURNAL         (1u)
+#else
+    #define DFU_NVM_JOURNAL         (0u)
+#endif
+
+#if (DFU_NVM_JOURNAL != 0u)
+    #define DFU_NVM_JOURNAL_ROWS        (IMAGE_SLOT_SIZE / CY_NVM_SIZEOF_ROW)
+    #define DFU_NVM_JOURNAL_WORDS       ((DFU_NVM_JOURNAL_ROWS + 31U) / 32U)
+    #define DFU_NVM_JOURNAL_MAGIC       (0x4A524E4Cu)
+
+    /* The image metadata row is unused until the image trailer or the verification cache is written */
+    #define DFU_NVM_JOURNAL_ADDR        (FLASH_ADDR(IMAGE_META_OFFSET))
+
+    /* Journal record at the start of the metadata row */
+    typedef struct
+    {
+        uint32_t magic;
+        uint32_t tag;                           /* Image tag of DFU_APP_CMD_RESUME_QUERY */
+        uint32_t base;
+        uint32_t rows;
+        uint32_t done[DFU_NVM_JOURNAL_WORDS];   /* Bit set when the row is programmed */
+        uint32_t crc;                           /* CRC32C of the fields above */
+    } dfu_nvm_journal_t;
+
+    /* Completed rows, tag 0 while no host has bound the journal */
+    static dfu_nvm_journal_t nvm_journal;
+
+    /* Completed rows in the journal row, rows rewritten from there are dropped first */
+    static uint32_t nvm_journal_saved[DFU_NVM_JOURNAL_WORDS];
+
+    /* Rows completed since the last journal write */
+    static uint32_t nvm_journal_pending;
+
+    /* The host queried the journal since the last session start */
+    static bool nvm_journal_queried;
+
+    /* The metadata row holds the journal, cleared when it is written as image data */
+    static bool nvm_journal_owned;
+
+    CY_ALIGN(4) static uint8_t nvm_journal_row[CY_NVM_SIZEOF_ROW];
+#endif /* DFU_NVM_JOURNAL */
+
+#if (DFU_APP_CMD_ENABLE != 0u)
+    /* Largest application command response data: a SHA-256 or the resume query row bitmap */
+    #if (DFU_NVM_JOURNAL != 0u)
+        #define DFU_APP_RSP_DATA_MAX    (((8u + (4u * DFU_NVM_JOURNAL_WORDS)) > 32u) ? \
+                                         (8u + (4u * DFU_NVM_JOURNAL_WORDS)) : 32u)
+    #else
+        #define DFU_APP_RSP_DATA_MAX    (32u)
+    #endif /* DFU_NVM_JOURNAL */
+
+    /* Timeout to send an application command response, in milliseconds */
+    #define DFU_APP_CMD_TIMEOUT_MS      (20u)
+
+    /* Handles the data of an application command and fills in the response data */
+    typedef cy_en_dfu_status_t (*dfu_app_cmd_handler_t)(const uint8_t data[], uint32_t length,
+                                                         uint8_t rsp[], uint32_t *rspLength);
+
+    typedef struct
+    {
+        uint8_t cmd;
+        dfu_app_cmd_handler_t handler;
+    } dfu_app_cmd_t;
+
+    CY_ALIGN(4) static uint8_t app_cmd_rsp[DFU_APP_RSP_DATA_MAX + DFU_PACKET_OVERHEAD];
+
+    /* Range digest in progress: rows left, algorithm and the digest so far, see dfu_app_digest_run() */
+    static bool app_digest_pending;
+    static uint32_t app_digest_next;
+    static uint32_t app_digest_end;
+    static uint8_t app_digest_alg;
+    static uint32_t app_digest_crc;
+    #if defined(MCUBOOT_IMAGE)
+        static psa_hash_operation_t app_digest_op;
+    #endif /* MCUBOOT_IMAGE */
+#endif /* DFU_APP_CMD_ENABLE */
+
+/* Windowed writes are application commands */
+#if (DFU_APP_CMD_ENABLE != 0u) && (DFU_APP_WINDOW_ENABLE != 0u)
+    #define DFU_APP_WINDOW          (1u)
+
+    /* Rows of one windowed data packet: its share of the command buffer, at most one write */
+    #define DFU_APP_WINDOW_WRITE_MAX    ((((CY_DFU_SIZEOF_CMD_BUFFER - DFU_PACKET_OVERHEAD - DFU_APP_WINDOW_HEADER) < \
+                                           CY_DFU_SIZEOF_DATA_BUFFER) ? \
+                                          (CY_DFU_SIZEOF_CMD_BUFFER - DFU_PACKET_OVERHEAD - DFU_APP_WINDOW_HEADER) : \
+                                          CY_DFU_SIZEOF_DATA_BUFFER) / CY_NVM_SIZEOF_ROW * CY_NVM_SIZEOF_ROW)
+
+    /* Windowed writes: accepted in a session, started, data packets seen since dfu_app_window_active() */
+    static bool app_window_enabled;
+    static bool app_window_open;
+    static bool app_window_active;
+
+    /* Sequence number of the next packet to write, and its result: missing, failed or success */
+    static uint16_t app_window_next;
+    static cy_en_dfu_status_t app_window_result;
+
+    /* Sequence number and rows of a written packet */
+    typedef struct
+    {
+        uint16_t seq;
+        uint32_t start;
+        uint32_t end;
+    } dfu_app_window_packet_t;
+
+    /* The last two packets written, a row that fails in the background belongs to one of them */
+    static dfu_app_window_packet_t app_window_written[2];
+#else
+    #define DFU_APP_WINDOW          (0u)
+#endif /* (DFU_APP_CMD_ENABLE != 0u) && (DFU_APP_WINDOW_ENABLE != 0u) */
+
+/* Rows are programmed in the background on devices with the SROM flash driver */
+#if (DFU_WRITE_PIPELINE != 0u) && !defined(CY_IP_M7CPUSS) && \
+    (!defined COMPONENT_CAT1B || !defined COMPONENT_NON_SECURE_DEVICE)
+    #define DFU_NVM_ASYNC           (1u)
+#else
+    #define DFU_NVM_ASYNC           (0u)
 #endif
 
+/* int_status of a write that left interrupts enabled */
+#define DFU_NVM_UNMASKED            (0xFFFFFFFFu)
+
+#if (DFU_NVM_IRQ_PROBE != 0u)
+    /* Longest masked interval and start of the current one, in DWT cycles */
+    static uint32_t nvm_irq_masked_max;
+    static uint32_t nvm_irq_masked_start;
+#endif /* DFU_NVM_IRQ_PROBE */
+
+#if (DFU_NVM_ASYNC != 0u)
+    #if (DFU_NVM_ZERO_COPY == 0u)
+        /* Copies of the rows being programmed, the DFU data buffer is reused for the next packet */
+        CY_ALIGN(4) static uint8_t nvm_row_buf[DFU_WRITE_PIPELINE_DEPTH][CY_NVM_SIZEOF_ROW];
+        static uint32_t nvm_row_next;
+    #endif /* DFU_NVM_ZERO_COPY */
+
+    /* Row or sector the flash works on, valid while nvm_busy is set */
+    static bool nvm_busy;
+    static bool nvm_busy_erase;
+    static uint32_t nvm_busy_addr;
+    static const uint8_t *nvm_busy_row;
+
+    /* Row that failed in the background and in the retry, other rows are refused until it is written again */
+    static bool nvm_failed;
+    static uint32_t nvm_failed_addr;
+
+    #if (DFU_NVM_ZERO_COPY != 0u) && (DFU_APP_WINDOW != 0u)
+        /* Second packet buffer, a windowed packet is received in one while a row programs from the other */
+        CY_ALIGN(4) static uint8_t nvm_packet_buf[CY_DFU_SIZEOF_CMD_BUFFER];
+    #endif /* (DFU_NVM_ZERO_COPY != 0u) && (DFU_APP_WINDOW != 0u) */
+#endif /* DFU_NVM_ASYNC */
+
+#if (DFU_NVM_PRE_ERASE != 0u)
+    #define DFU_NVM_PRE_ERASE_ROWS      (IMAGE_SLOT_SIZE / CY_NVM_SIZEOF_ROW)
+
+    /* Slot erased ahead of the rows, offsets below nvm_erase_next are done */
+    static uint32_t nvm_erase_base;
+    static uint32_t nvm_erase_size;
+    static uint32_t nvm_erase_next;
+    static uint32_t nvm_erase_sector_size;
+
+    /* Rows erased and not programmed since, and rows written in this session */
+    static uint32_t nvm_row_blank[(DFU_NVM_PRE_ERASE_ROWS + 31U) / 32U];
+    static uint32_t nvm_row_written[(DFU_NVM_PRE_ERASE_ROWS + 31U) / 32U];
+#endif /* DFU_NVM_PRE_ERASE */
+
 #if CY_DFU_FLOW == CY_DFU_BASIC_FLOW
     /*
     * The DFU SDK metadata initial value is placed here
@@ -98,12 +403,98 @@ static cy_en_dfu_transport_t selectedInterface = CY_DFU_UART;
 
 
 static bool IsMultipleOf(uint32_t value, uint32_t multiple);
-static bool AddressValid(uint32_t address, cy_stc_dfu_params_t *params);
+static bool AddressValid(uint32_t address, uint32_t access, const dfu_nvm_range_t **range);
+static void NvmRangeAdd(uint32_t start, uint32_t size, uint32_t sector_size, uint32_t flags);
+static void NvmRangesBuild(void);
+
+#ifndef CY_IP_M7CPUSS
+    static uint32_t NvmSectorSize(uint32_t address);
+#endif /* CY_IP_M7CPUSS */
+
+#if (DFU_APP_CMD_ENABLE != 0u) || (DFU_TRANSPORT_LISTEN != 0u)
+    static uint16_t PacketChecksum(const uint8_t data[], uint32_t length);
+#endif /* (DFU_APP_CMD_ENABLE != 0u) || (DFU_TRANSPORT_LISTEN != 0u) */
+
+#if (DFU_APP_CMD_ENABLE != 0u)
+    static uint32_t GetU32(const uint8_t data[]);
+    static cy_en_dfu_status_t AppCmdRangeDigest(const uint8_t data[], uint32_t length,
+                                                uint8_t rsp[], uint32_t *rspLength);
+    #if (DFU_NVM_JOURNAL != 0u)
+        static cy_en_dfu_status_t AppCmdResumeQuery(const uint8_t data[], uint32_t length,
+                                                    uint8_t rsp[], uint32_t *rspLength);
+    #endif /* DFU_NVM_JOURNAL */
+    static cy_en_dfu_status_t AppCmdGetCaps(const uint8_t data[], uint32_t length,
+                                            uint8_t rsp[], uint32_t *rspLength);
+    #if (DFU_APP_WINDOW != 0u)
+        static cy_en_dfu_status_t AppCmdWindowOpen(const uint8_t data[], uint32_t length,
+                                                   uint8_t rsp[], uint32_t *rspLength);
+        static cy_en_dfu_status_t AppCmdWindowData(const uint8_t data[], uint32_t length,
+                                                   uint8_t rsp[], uint32_t *rspLength);
+    #endif /* DFU_APP_WINDOW */
+    static bool AppCmdProcess(const uint8_t packet[], uint32_t count);
+    static void AppCmdRespond(cy_en_dfu_status_t status, uint32_t rspLength);
+
+    /* Application commands, see dfu_app_cmd.h */
+    static const dfu_app_cmd_t app_cmds[] =
+    {
+        { DFU_APP_CMD_RANGE_DIGEST, AppCmdRangeDigest },
+    #if (DFU_NVM_JOURNAL != 0u)
+        { DFU_APP_CMD_RESUME_QUERY, AppCmdResumeQuery },
+    #endif /* DFU_NVM_JOURNAL */
+        { DFU_APP_CMD_GET_CAPS,     AppCmdGetCaps },
+    #if (DFU_APP_WINDOW != 0u)
+        { DFU_APP_CMD_WINDOW_OPEN,  AppCmdWindowOpen },
+        { DFU_APP_CMD_WINDOW_DATA,  AppCmdWindowData },
+    #endif /* DFU_APP_WINDOW */
+    };
+#endif /* DFU_APP_CMD_ENABLE */
+
+static uint32_t NvmCriticalEnter(uint32_t address);
+static void NvmCriticalExit(uint32_t int_status);
+
+static bool NvmRowTake(uint32_t address);
+#if (DFU_APP_WINDOW != 0u)
+    static bool NvmRowFailed(uint32_t *address);
+#endif /* DFU_APP_WINDOW */
+static cy_en_dfu_status_t WriteRow(uint32_t address, uint32_t end, const uint8_t data[],
+                                   const dfu_nvm_range_t *range);
+static cy_en_dfu_status_t WriteRows(uint32_t address, uint32_t length, const uint8_t data[], uint32_t ctl,
+                                    uint32_t access, cy_stc_dfu_params_t *params);
+
+#if (DFU_NVM_JOURNAL != 0u)
+    static bool NvmJournalLoad(uint32_t tag);
+    static bool NvmJournalInFlash(void);
+    static void NvmJournalWrite(bool keep);
+    static void NvmJournalPrepare(uint32_t address);
+    static void NvmJournalRowDone(uint32_t address);
+#endif /* DFU_NVM_JOURNAL */
+
+#if (DFU_NVM_PRE_ERASE != 0u)
+    static bool NvmSectorWritten(uint32_t offset);
+    static void NvmSectorSetBlank(uint32_t offset);
+    static cy_en_dfu_status_t NvmSectorErase(uint32_t offset);
+    static void NvmEraseAhead(uint32_t address);
+#endif /* DFU_NVM_PRE_ERASE */
+
+#if (DFU_NVM_ASYNC != 0u)
+    static cy_en_dfu_status_t NvmWait(void);
+    static cy_en_dfu_status_t NvmComplete(cy_en_flashdrv_status_t fstatus);
+    #if (DFU_NVM_ZERO_COPY != 0u)
+        static bool NvmRowIn(const uint8_t buffer[], uint32_t size);
+    #endif /* DFU_NVM_ZERO_COPY */
+    static cy_en_dfu_status_t NvmStartWrite(uint32_t address, const uint8_t *row, bool programOnly);
+    #if (DFU_NVM_PRE_ERASE != 0u)
+        static cy_en_dfu_status_t NvmStartErase(uint32_t address);
+    #endif /* DFU_NVM_PRE_ERASE */
+#endif /* DFU_NVM_ASYNC */
 
 
 #if CY_DFU_FLOW == CY_DFU_BASIC_FLOW
     static void GetStartEndAddress(uint32_t appId, uint32_t *startAddress, uint32_t *endAddress);
 #endif /* CY_DFU_FLOW == CY_DFU_BASIC_FLOW */
+#if (CY_DFU_FLOW == CY_DFU_BASIC_FLOW) || (DFU_NVM_META_LOCKED != 0u)
+    static void NvmRangeCarve(uint32_t start, uint32_t end, uint32_t clear, uint32_t set, uint32_t app);
+#endif /* (CY_DFU_FLOW == CY_DFU_BASIC_FLOW) || (DFU_NVM_META_LOCKED != 0u) */
 
 
 /*******************************************************************************
@@ -126,210 +517,2165 @@ static bool IsMultipleOf(uint32_t value, uint32_t multiple)
 
 
 /*******************************************************************************
-* Function Name: AddressValid
+* Function Name: NvmRangeAdd
 ****************************************************************************//**
 *
-* Internal function to validate address
+* Internal function to insert a base region into the address range table,
+* keeping the table sorted. Regions must not overlap.
 *
-* \param address    The address to check.
-* \param params     The pointer to a DFU parameters structure, see \ref cy_stc_dfu_params_t.
+* \param start          The region start address.
+* \param size           The region size in bytes, 0 adds nothing.
+* \param sector_size    The erase sector size of the region.
+* \param flags          DFU_NVM_RANGE_* access flags.
 *
-* \return True - address valid
+*******************************************************************************/
+static void NvmRangeAdd(uint32_t start, uint32_t size, uint32_t sector_size, uint32_t flags)
+{
+    uint32_t idx = nvm_range_count;
+
+    if ((size == 0U) || (nvm_range_count >= DFU_NVM_RANGE_MAX))
+    {
+        CY_ASSERT(size == 0U);
+        return;
+    }
+
+    while ((idx > 0U) && (nvm_ranges[idx - 1U].start > start))
+    {
+        nvm_ranges[idx] = nvm_ranges[idx - 1U];
+        idx--;
+    }
+
+    nvm_ranges[idx].start = start;
+    nvm_ranges[idx].last = start + (size - 1U);
+    nvm_ranges[idx].sector_size = sector_size;
+    nvm_ranges[idx].flags = (uint16_t)flags;
+    nvm_ranges[idx].app = 0U;
+    nvm_range_count++;
+}
+
+
+#if (CY_DFU_FLOW == CY_DFU_BASIC_FLOW) || (DFU_NVM_META_LOCKED != 0u)
+/*******************************************************************************
+* Function Name: NvmRangeCarve
+****************************************************************************//**
+*
+* Internal function to change the access flags of [start, end) in the address
+* range table. Ranges that cross the bounds are split. When the table is full
+* the whole overlapping range gets the new flags, which only restricts access.
+*
+* \param start  The first address.
+* \param end    The address past the last one.
+* \param clear  Access flags to remove.
+* \param set    Access flags to add.
+* \param app    Application number for DFU_NVM_RANGE_GOLDEN.
+*
+*******************************************************************************/
+static void NvmRangeCarve(uint32_t start, uint32_t end, uint32_t clear, uint32_t set, uint32_t app)
+{
+    dfu_nvm_range_t out[DFU_NVM_RANGE_MAX];
+    uint32_t count = 0U;
+    uint32_t last = end - 1U;
+
+    if (end <= start)
+    {
+        return;
+    }
+
+    for (uint32_t idx = 0U; idx < nvm_range_count; idx++)
+    {
+        dfu_nvm_range_t range = nvm_ranges[idx];
+        bool split = (range.start < start) || (last < range.last);
+
+        if ((range.last < start) || (last < range.start))
+        {
+            out[count++] = range;
+            continue;
+        }
+
+        if (split && ((nvm_range_count - idx) + count + 2U > DFU_NVM_RANGE_MAX))
+        {
+            /* No room to split, restrict the whole range */
+            range.flags = (uint16_t)((range.flags & ~clear) | set);
+            range.app = (uint16_t)app;
+            out[count++] = range;
+            continue;
+        }
+
+        if (range.start < start)
+        {
+            out[count] = range;
+            out[count].last = start - 1U;
+            count++;
+            range.start = start;
+        }
+
+        if (last < range.last)
+        {
+            out[count] = range;
+            out[count].last = last;
+            out[count].flags = (uint16_t)((range.flags & ~clear) | set);
+            out[count].app = (uint16_t)app;
+            count++;
+            range.start = last + 1U;
+        }
+        else
+        {
+            range.flags = (uint16_t)((range.flags & ~clear) | set);
+            range.app = (uint16_t)app;
+        }
+        out[count++] = range;
+    }
+
+    (void) memcpy(nvm_ranges, out, count * sizeof(out[0]));
+    nvm_range_count = count;
+}
+#endif /* (CY_DFU_FLOW == CY_DFU_BASIC_FLOW) || (DFU_NVM_META_LOCKED != 0u) */
+
+
+#ifndef CY_IP_M7CPUSS
+/*******************************************************************************
+* Function Name: NvmSectorSize
+****************************************************************************//**
+*
+* Internal function to get the erase sector size of the NVM region at address.
+* mtb_hal_nvm_erase() erases one such sector.
+*
+* \param address    An address of the region.
+*
+* \return The sector size, CY_NVM_SIZEOF_ROW when no region holds the address
+*
+*******************************************************************************/
+static uint32_t NvmSectorSize(uint32_t address)
+{
+    mtb_hal_nvm_info_t nvm_info;
+    uint32_t sector_size = CY_NVM_SIZEOF_ROW;
+
+    mtb_hal_nvm_get_info(&nvm_obj, &nvm_info);
+    for (uint32_t block_num = 0U; block_num < nvm_info.region_count; block_num++)
+    {
+        const mtb_hal_nvm_region_info_t *block = &nvm_info.regions[block_num];
+        if ((block->start_address <= address) && ((address - block->start_address) < block->size))
+        {
+            sector_size = block->sector_size;
+            break;
+        }
+    }
+
+    return sector_size;
+}
+#endif /* CY_IP_M7CPUSS */
+
+
+/*******************************************************************************
+* Function Name: NvmRangesBuild
+****************************************************************************//**
+*
+* Internal function to build the address range table from the flash layout,
+* the bank mode and, in the basic flow, the running and golden applications.
+* In the MCUBoot flow the metadata row of the image slot is written through
+* dfu_nvm_meta_write() only, with DFU_NVM_META_LOCKED. The layout does not
+* change during a DFU session, so AddressValid() only searches the table.
 *
 *******************************************************************************/
-static bool AddressValid(uint32_t address, cy_stc_dfu_params_t *params)
+static void NvmRangesBuild(void)
 {
-    bool addrValid = true;
-    uint32_t bank_mode;
+    nvm_range_count = 0U;
 
 #if CY_DFU_FLOW == CY_DFU_BASIC_FLOW
-    addrValid = ((((CY_FLASH_BASE + CY_DFU_APP0_VERIFY_LENGTH)) <= address) &&
-                                (address < (CY_FLASH_BASE + CY_FLASH_SIZE))) ||
-                ((CY_EM_EEPROM_BASE <= address) &&
-                        (address < (CY_EM_EEPROM_BASE + CY_EM_EEPROM_SIZE)));
-    CY_UNUSED_PARAMETER(params);
+    uint32_t startAddress;
+    uint32_t endAddress;
+
+    NvmRangeAdd(CY_FLASH_BASE + CY_DFU_APP0_VERIFY_LENGTH, CY_FLASH_SIZE - CY_DFU_APP0_VERIFY_LENGTH,
+                NvmSectorSize(CY_FLASH_BASE), DFU_NVM_RANGE_READ | DFU_NVM_RANGE_WRITE);
+    NvmRangeAdd(CY_EM_EEPROM_BASE, CY_EM_EEPROM_SIZE, NvmSectorSize(CY_EM_EEPROM_BASE),
+                DFU_NVM_RANGE_READ | DFU_NVM_RANGE_WRITE);
+
+    /* It is forbidden to overwrite the currently running application */
+    GetStartEndAddress(Cy_DFU_GetRunningApp(), &startAddress, &endAddress);
+    NvmRangeCarve(startAddress, endAddress, DFU_NVM_RANGE_WRITE, 0U, 0U);
+
+    #if CY_DFU_OPT_GOLDEN_IMAGE
+    {
+        uint8_t goldenImages[] = { CY_DFU_GOLDEN_IMAGE_IDS() };
+        uint32_t count = sizeof(goldenImages) / sizeof(goldenImages[0]);
+        for (uint32_t idx = 0U; idx < count; ++idx)
+        {
+            GetStartEndAddress(goldenImages[idx], &startAddress, &endAddress);
+            NvmRangeCarve(startAddress, endAddress, 0U, DFU_NVM_RANGE_GOLDEN, goldenImages[idx]);
+        }
+    }
+    #endif /* #if CY_DFU_OPT_GOLDEN_IMAGE != 0 */
 #else /* MCUBoot flow*/
     #ifdef CY_IP_M7CPUSS
-        blocks_sector_size = 0U;
-        for (uint32_t block_num = 0U; block_num < blocks_count; block_num++)
+        mtb_hal_nvm_info_t nvm_info;
+
+        /* Get NVM characteristics */
+        mtb_hal_nvm_get_info(&nvm_obj, &nvm_info);
+        for (uint32_t block_num = 0U; block_num < nvm_info.region_count; block_num++)
         {
-            uint32_t flash_start_address = (&blocks_info[block_num])->start_address;
-            uint32_t flash_size = (&blocks_info[block_num])->size;
-            if ((flash_start_address <= address) && (address < flash_start_address + flash_size))
-            {
-                blocks_sector_size = (&blocks_info[0])->sector_size;
-                break;
-            }
+            const mtb_hal_nvm_region_info_t *block = &nvm_info.regions[block_num];
+            NvmRangeAdd(block->start_address, block->size, block->sector_size,
+                        DFU_NVM_RANGE_READ | DFU_NVM_RANGE_WRITE);
         }
-        addrValid = (blocks_sector_size > 0U);
     #else
         #if defined CY_FLASH_BASE
-            bank_mode = _FLD2VAL(FLASHC_FLASH_CTL_BANK_MODE, FLASHC_FLASH_CTL);
-            if (bank_mode == 0)
+            if (_FLD2VAL(FLASHC_FLASH_CTL_BANK_MODE, FLASHC_FLASH_CTL) == 0U)
             {
-                addrValid = (CY_FLASH_BASE <= address) &&
-                                (address < (CY_FLASH_BASE + CY_FLASH_SIZE));
+                NvmRangeAdd(CY_FLASH_BASE, CY_FLASH_SIZE, NvmSectorSize(CY_FLASH_BASE),
+                            DFU_NVM_RANGE_READ | DFU_NVM_RANGE_WRITE);
             }
             else
             {
-                addrValid = ((CY_FLASH_BASE <= address) && (address < (CY_FLASH_BASE + CY_DUAL_FLASH_S_SIZE))) ||
-                            ((CY_DUAL_FLASH_S_SBUS_BASE <= address) && (address < (CY_DUAL_FLASH_S_SBUS_BASE + CY_DUAL_FLASH_S_SIZE)));
+                NvmRangeAdd(CY_FLASH_BASE, CY_DUAL_FLASH_S_SIZE, NvmSectorSize(CY_FLASH_BASE),
+                            DFU_NVM_RANGE_READ | DFU_NVM_RANGE_WRITE);
+                NvmRangeAdd(CY_DUAL_FLASH_S_SBUS_BASE, CY_DUAL_FLASH_S_SIZE, NvmSectorSize(CY_DUAL_FLASH_S_SBUS_BASE),
+                            DFU_NVM_RANGE_READ | DFU_NVM_RANGE_WRITE);
             }
-            #else
-                CY_DFU_LOG_WRN("Address validation skipped");
-                CY_UNUSED_PARAMETER(address);
-            #endif /* defined CY_FLASH_BASE */
-            CY_UNUSED_PARAMETER(params);
+        #else
+            CY_DFU_LOG_WRN("Address validation skipped");
+            nvm_ranges[0].start = 0U;
+            nvm_ranges[0].last = 0xFFFFFFFFU;
+            nvm_ranges[0].sector_size = NvmSectorSize(0U);
+            nvm_ranges[0].flags = DFU_NVM_RANGE_READ | DFU_NVM_RANGE_WRITE;
+            nvm_ranges[0].app = 0U;
+            nvm_range_count = 1U;
+        #endif /* defined CY_FLASH_BASE */
     #endif /* CY_IP_M7CPUSS */
+
+    #if (DFU_NVM_META_LOCKED != 0u)
+        NvmRangeCarve(FLASH_ADDR(IMAGE_META_OFFSET), FLASH_ADDR(IMAGE_SLOT_SIZE),
+                      DFU_NVM_RANGE_WRITE, DFU_NVM_RANGE_META, 0U);
+    #endif /* DFU_NVM_META_LOCKED */
 #endif /* CY_DFU_FLOW == CY_DFU_BASIC_FLOW */
 
-    return addrValid;
+    nvm_ranges_built = true;
 }
 
 
-#if CY_DFU_FLOW == CY_DFU_BASIC_FLOW
-    /*******************************************************************************
-    * Function Name: GetStartEndAddress
-    ****************************************************************************//**
-    *
-    * This internal function returns start and end address of application
-    *
-    * \param appId          The application number
-    * \param startAddress   The pointer to a variable where an application start
-    *                       address is stored
-    * \param endAddress     The pointer to a variable where a size of application
-    *                       area is stored.
-    *
-    *******************************************************************************/
-    static void GetStartEndAddress(uint32_t appId, uint32_t *startAddress, uint32_t *endAddress)
+/*******************************************************************************
+* Function Name: AddressValid
+****************************************************************************//**
+*
+* Internal function to validate address. Binary search of the address range
+* table, O(log n) with one compare per step.
+*
+* \param address    The address to check.
+* \param access     DFU_NVM_RANGE_READ or DFU_NVM_RANGE_WRITE.
+* \param range      Set to the range of the address, can be NULL.
+*
+* \return True - address valid
+*
+*******************************************************************************/
+static bool AddressValid(uint32_t address, uint32_t access, const dfu_nvm_range_t **range)
+{
+    uint32_t lo = 0U;
+    uint32_t count;
+
+    if (!nvm_ranges_built)
     {
-        uint32_t verifyStart;
-        uint32_t verifySize;
+        NvmRangesBuild();
+    }
 
-        (void)Cy_DFU_GetAppMetadata(appId, &verifyStart, &verifySize);
+    /* Last range that starts at or below the address */
+    for (count = nvm_range_count; count > 1U; count -= count / 2U)
+    {
+        uint32_t mid = lo + (count / 2U);
+        lo = (nvm_ranges[mid].start <= address) ? mid : lo;
+    }
 
-    #if (CY_DFU_APP_FORMAT == CY_DFU_SIMPLIFIED_APP)
-        *startAddress = verifyStart - CY_DFU_SIGNATURE_SIZE;
-        *endAddress = verifyStart + verifySize;
-    #else
-        *startAddress = verifyStart;
-        *endAddress = verifyStart + verifySize + CY_DFU_SIGNATURE_SIZE;
-    #endif
+    const dfu_nvm_range_t *found = &nvm_ranges[lo];
+    bool addrValid = (nvm_range_count != 0U) && (found->start <= address) && (address <= found->last) &&
+                     ((found->flags & access) == access);
+
+    if (range != NULL)
+    {
+        *range = found;
     }
-#endif /* CY_DFU_FLOW == CY_DFU_BASIC_FLOW */
+
+    return addrValid;
+}
 
 
+#if (DFU_APP_CMD_ENABLE != 0u) || (DFU_TRANSPORT_LISTEN != 0u)
 /*******************************************************************************
-* Function Name: Cy_DFU_WriteData
+* Function Name: PacketChecksum
 ****************************************************************************//**
 *
-* This function documentation is part of the DFU SDK API, see the
-* cy_dfu.h file or DFU SDK API Reference Manual for details.
+* Internal function to compute the DFU packet checksum: the two's complement
+* of the 16-bit sum of the packet bytes ahead of the checksum.
+*
+* \param data       The packet, starting with the start of packet byte.
+* \param length     The number of bytes ahead of the checksum.
+*
+* \return The checksum
 *
 *******************************************************************************/
-cy_en_dfu_status_t Cy_DFU_WriteData (uint32_t address, uint32_t length, uint32_t ctl,
-                                               cy_stc_dfu_params_t *params)
+static uint16_t PacketChecksum(const uint8_t data[], uint32_t length)
 {
-    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    uint16_t sum = 0U;
 
-    /* Check if the address is inside the valid range */
-    if(!AddressValid(address, params))
+    for (uint32_t idx = 0U; idx < length; idx++)
     {
-        status = CY_DFU_ERROR_ADDRESS;
+        sum += data[idx];
     }
 
-    /* Check if the length is valid
-     * Note Length = 0 is valid for erase command */
-    if ( (IsMultipleOf(address, CY_NVM_SIZEOF_ROW) == false) ||
-         ( (length != CY_NVM_SIZEOF_ROW) && ( (ctl & CY_DFU_IOCTL_ERASE) == 0U) ) )
-    {
-        status = CY_DFU_ERROR_LENGTH;
-    }
+    return (uint16_t)(1U + (uint16_t)~sum);
+}
+#endif /* (DFU_APP_CMD_ENABLE != 0u) || (DFU_TRANSPORT_LISTEN != 0u) */
 
-#if CY_DFU_FLOW == CY_DFU_BASIC_FLOW
-    uint32_t app = Cy_DFU_GetRunningApp();
-    uint32_t startAddress;
-    uint32_t endAddress;
 
-    GetStartEndAddress(app, &startAddress, &endAddress);
+#if (DFU_APP_CMD_ENABLE != 0u)
+/*******************************************************************************
+* Function Name: GetU32
+****************************************************************************//**
+*
+* Internal function to read a little endian 32-bit value of a packet.
+*
+* \param data   The pointer to the first byte.
+*
+* \return The value
+*
+*******************************************************************************/
+static uint32_t GetU32(const uint8_t data[])
+{
+    return ((uint32_t)data[0]) | ((uint32_t)data[1] << 8U) |
+           ((uint32_t)data[2] << 16U) | ((uint32_t)data[3] << 24U);
+}
+
 
-    /* Refuse to write to a row within a range of the current application */
-    if ( (startAddress <= address) && (address < endAddress) )
-    {   /* It is forbidden to overwrite the currently running application */
-        status = CY_DFU_ERROR_ADDRESS;
+/*******************************************************************************
+* Function Name: AppCmdRangeDigest
+****************************************************************************//**
+*
+* Internal function to handle DFU_APP_CMD_RANGE_DIGEST: the CRC32C or SHA-256
+* of whole rows of the image slot, so the host checks a whole slot in one
+* round trip instead of a compare per row. Other memory and parts of a row
+* are not digested, a digest of a few bytes would read them out. Only starts
+* the digest, dfu_app_digest_run() computes it in slices and answers.
+*
+* \param data       The command data: address, length and algorithm.
+* \param length     The command data length.
+* \param rsp        The response data.
+* \param rspLength  The response data length.
+*
+* \return CY_DFU_SUCCESS - the digest is started
+*
+*******************************************************************************/
+static cy_en_dfu_status_t AppCmdRangeDigest(const uint8_t data[], uint32_t length,
+                                            uint8_t rsp[], uint32_t *rspLength)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    uint32_t address;
+    uint32_t offset;
+    uint32_t size;
+
+    if (length != 9U)
+    {
+        status = CY_DFU_ERROR_LENGTH;
     }
+    else
+    {
+        address = GetU32(&data[0]);
+        size = GetU32(&data[4]);
 
-    #if CY_DFU_OPT_GOLDEN_IMAGE
-        if (status == CY_DFU_SUCCESS)
-        {
-            uint8_t goldenImages[] = { CY_DFU_GOLDEN_IMAGE_IDS() };
-            uint32_t count = sizeof(goldenImages) / sizeof(goldenImages[0]);
-            uint32_t idx;
-            for (idx = 0U; idx < count; ++idx)
-            {
-                app = goldenImages[idx];
-                GetStartEndAddress(app, &startAddress, &endAddress);
+        /* Rows still programming would be digested stale, a failed row shows in the digest */
+    #if (DFU_NVM_ASYNC != 0u)
+        (void) NvmWait();
+    #endif /* DFU_NVM_ASYNC */
 
-                if ( (startAddress <= address) && (address < endAddress) )
-                {
-                    status = Cy_DFU_ValidateApp(app, params);
-                    status = (status == CY_DFU_SUCCESS) ? CY_DFU_ERROR_ADDRESS : CY_DFU_SUCCESS;
-                    break;
-                }
-            }
+        offset = address - FLASH_ADDR(0u);
+        if ((size == 0U) || !IsMultipleOf(size, CY_NVM_SIZEOF_ROW))
+        {
+            status = CY_DFU_ERROR_LENGTH;
         }
-    #endif /* #if CY_DFU_OPT_GOLDEN_IMAGE != 0 */
-#endif /*CY_DFU_FLOW == CY_DFU_BASIC_FLOW*/
+        else if ((address < FLASH_ADDR(0u)) || !IsMultipleOf(offset, CY_NVM_SIZEOF_ROW) ||
+                 (offset >= IMAGE_SLOT_SIZE) || (size > (IMAGE_SLOT_SIZE - offset)))
+        {
+            status = CY_DFU_ERROR_ADDRESS;
+        }
+        else
+        {
+            /* Whole rows of the slot */
+        }
+    }
+
+    CY_UNUSED_PARAMETER(rsp);
+    CY_UNUSED_PARAMETER(rspLength);
 
     if (status == CY_DFU_SUCCESS)
     {
-        if ((ctl & CY_DFU_IOCTL_ERASE) != 0U)
+        if (data[8] == DFU_APP_DIGEST_CRC32C)
+        {
+            app_digest_crc = 0U;
+        }
+    #if defined(MCUBOOT_IMAGE)
+        else if (data[8] == DFU_APP_DIGEST_SHA256)
+        {
+            (void) psa_hash_abort(&app_digest_op);
+            status = (psa_hash_setup(&app_digest_op, PSA_ALG_SHA_256) == PSA_SUCCESS) ?
+                     CY_DFU_SUCCESS : CY_DFU_ERROR_DATA;
+        }
+    #endif /* MCUBOOT_IMAGE */
+        else
         {
-            (void) memset(params->dataBuffer, 0, CY_NVM_SIZEOF_ROW);
+            status = CY_DFU_ERROR_DATA;
         }
+    }
 
-        cy_rslt_t fstatus = CY_RSLT_SUCCESS;
+    if (status == CY_DFU_SUCCESS)
+    {
+        app_digest_pending = true;
+        app_digest_next = address;
+        app_digest_end = address + size;
+        app_digest_alg = data[8];
+    }
 
-        #ifdef CY_IP_M7CPUSS
-            uint32_t int_status;
-            int_status = mtb_hal_system_critical_section_enter();
-            if(address % blocks_sector_size == 0U)
-            {
-                fstatus = mtb_hal_nvm_erase(&nvm_obj, address);
-            }
-            if(fstatus == CY_RSLT_SUCCESS)
+    return status;
+}
+
+
+#if (DFU_NVM_JOURNAL != 0u)
+/*******************************************************************************
+* Function Name: AppCmdResumeQuery
+****************************************************************************//**
+*
+* Internal function to handle DFU_APP_CMD_RESUME_QUERY: bind the row journal
+* to the image tag of the host and report the completed rows. A journal of
+* another tag, in RAM or in the metadata row, is restarted empty.
+*
+* \param data       The command data: the image tag.
+* \param length     The command data length.
+* \param rsp        The response data.
+* \param rspLength  The response data length.
+*
+* \return CY_DFU_SUCCESS - rsp holds the slot, row size, row count and bitmap
+*
+*******************************************************************************/
+static cy_en_dfu_status_t AppCmdResumeQuery(const uint8_t data[], uint32_t length,
+                                            uint8_t rsp[], uint32_t *rspLength)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    uint32_t tag = 0U;
+
+    if (length != 4U)
+    {
+        status = CY_DFU_ERROR_LENGTH;
+    }
+    else
+    {
+        tag = GetU32(&data[0]);
+
+        /* The journal row is read back, and the last row may complete */
+    #if (DFU_NVM_ASYNC != 0u)
+        (void) NvmWait();
+    #endif /* DFU_NVM_ASYNC */
+    }
+
+    if (status == CY_DFU_SUCCESS)
+    {
+        if ((tag == 0U) || ((tag != nvm_journal.tag) && !NvmJournalLoad(tag)))
+        {
+            (void) memset(&nvm_journal, 0, sizeof(nvm_journal));
+            nvm_journal.tag = tag;
+            nvm_journal_pending = 0U;
+        }
+        nvm_journal_queried = (tag != 0U);
+
+        rsp[0] = (uint8_t)FLASH_ADDR(0u);
+        rsp[1] = (uint8_t)(FLASH_ADDR(0u) >> 8U);
+        rsp[2] = (uint8_t)(FLASH_ADDR(0u) >> 16U);
+        rsp[3] = (uint8_t)(FLASH_ADDR(0u) >> 24U);
+        rsp[4] = (uint8_t)CY_NVM_SIZEOF_ROW;
+        rsp[5] = (uint8_t)(CY_NVM_SIZEOF_ROW >> 8U);
+        rsp[6] = (uint8_t)DFU_NVM_JOURNAL_ROWS;
+        rsp[7] = (uint8_t)(DFU_NVM_JOURNAL_ROWS >> 8U);
+        for (uint32_t idx = 0U; idx < (4U * DFU_NVM_JOURNAL_WORDS); idx++)
+        {
+            rsp[8U + idx] = (uint8_t)(nvm_journal.done[idx / 4U] >> (8U * (idx % 4U)));
+        }
+        *rspLength = 8U + (4U * DFU_NVM_JOURNAL_WORDS);
+    }
+
+    return status;
+}
+#endif /* DFU_NVM_JOURNAL */
+
+
+/*******************************************************************************
+* Function Name: AppCmdGetCaps
+****************************************************************************//**
+*
+* Internal function to handle DFU_APP_CMD_GET_CAPS: the packet and write
+* sizes the device buffers and the optional features it has.
+*
+* \param data       The command data, none.
+* \param length     The command data length.
+* \param rsp        The response data.
+* \param rspLength  The response data length.
+*
+* \return CY_DFU_SUCCESS - rsp holds the capabilities
+*
+*******************************************************************************/
+static cy_en_dfu_status_t AppCmdGetCaps(const uint8_t data[], uint32_t length,
+                                        uint8_t rsp[], uint32_t *rspLength)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    uint32_t flags = 0U;
+    uint32_t writeMax = (CY_DFU_SIZEOF_DATA_BUFFER / CY_NVM_SIZEOF_ROW) * CY_NVM_SIZEOF_ROW;
+
+    CY_UNUSED_PARAMETER(data);
+
+#if (DFU_NVM_ASYNC != 0u)
+    flags |= DFU_APP_CAP_PIPELINE;
+#endif /* DFU_NVM_ASYNC */
+#if (DFU_NVM_PRE_ERASE != 0u)
+    flags |= DFU_APP_CAP_PRE_ERASE;
+#endif /* DFU_NVM_PRE_ERASE */
+#if (DFU_NVM_JOURNAL != 0u)
+    flags |= DFU_APP_CAP_RESUME;
+#endif /* DFU_NVM_JOURNAL */
+#if defined(MCUBOOT_IMAGE)
+    flags |= DFU_APP_CAP_SHA256;
+#endif /* MCUBOOT_IMAGE */
+#if (DFU_APP_WINDOW != 0u)
+    flags |= DFU_APP_CAP_WINDOW;
+#endif /* DFU_APP_WINDOW */
+
+    if (length != 0U)
+    {
+        status = CY_DFU_ERROR_LENGTH;
+    }
+    else
+    {
+        rsp[0] = DFU_APP_CAPS_VERSION;
+        rsp[1] = (uint8_t)flags;
+        rsp[2] = (uint8_t)CY_NVM_SIZEOF_ROW;
+        rsp[3] = (uint8_t)(CY_NVM_SIZEOF_ROW >> 8U);
+        rsp[4] = (uint8_t)CY_DFU_SIZEOF_CMD_BUFFER;
+        rsp[5] = (uint8_t)(CY_DFU_SIZEOF_CMD_BUFFER >> 8U);
+        rsp[6] = (uint8_t)writeMax;
+        rsp[7] = (uint8_t)(writeMax >> 8U);
+        *rspLength = 8U;
+    }
+
+    return status;
+}
+
+
+#if (DFU_APP_WINDOW != 0u)
+/*******************************************************************************
+* Function Name: AppCmdWindowOpen
+****************************************************************************//**
+*
+* Internal function to handle DFU_APP_CMD_WINDOW_OPEN: windowed writes start
+* over at sequence number 0.
+*
+* \param data       The command data, none.
+* \param length     The command data length.
+* \param rsp        The response data.
+* \param rspLength  The response data length.
+*
+* \return CY_DFU_SUCCESS - rsp holds the window and the largest write
+*
+*******************************************************************************/
+static cy_en_dfu_status_t AppCmdWindowOpen(const uint8_t data[], uint32_t length,
+                                           uint8_t rsp[], uint32_t *rspLength)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+
+    CY_UNUSED_PARAMETER(data);
+
+    if (length != 0U)
+    {
+        status = CY_DFU_ERROR_LENGTH;
+    }
+    else if (!app_window_enabled)
+    {
+        /* Outside of a DFU session */
+        status = CY_DFU_ERROR_CMD;
+    }
+    else
+    {
+        app_window_open = true;
+        app_window_next = 0U;
+        app_window_result = CY_DFU_SUCCESS;
+        (void) memset(app_window_written, 0, sizeof(app_window_written));
+
+        rsp[0] = (uint8_t)DFU_APP_WINDOW_MAX;
+        rsp[1] = (uint8_t)(DFU_APP_WINDOW_MAX >> 8U);
+        rsp[2] = (uint8_t)DFU_APP_WINDOW_WRITE_MAX;
+        rsp[3] = (uint8_t)(DFU_APP_WINDOW_WRITE_MAX >> 8U);
+        *rspLength = 4U;
+    }
+
+    return status;
+}
+
+
+/*******************************************************************************
+* Function Name: AppCmdWindowData
+****************************************************************************//**
+*
+* Internal function to handle DFU_APP_CMD_WINDOW_DATA: writes the rows of the
+* packet with the next sequence number, drops the others, and answers with
+* the next sequence number when the host asks for it. A row that fails in the
+* background takes the sequence number back to its packet.
+*
+* \param data       The command data: sequence number, flags, address, CRC32C
+*                   and rows.
+* \param length     The command data length.
+* \param rsp        The response data.
+* \param rspLength  The response data length, 0 for no response.
+*
+* \return CY_DFU_SUCCESS - the packet is handled, the write result is kept
+*         for the response
+*
+*******************************************************************************/
+static cy_en_dfu_status_t AppCmdWindowData(const uint8_t data[], uint32_t length,
+                                           uint8_t rsp[], uint32_t *rspLength)
+{
+    uint32_t rowsLength = length - DFU_APP_WINDOW_HEADER;
+    uint32_t address;
+    uint32_t failed;
+    uint16_t seq;
+
+    if ((length < DFU_APP_WINDOW_HEADER) || !app_window_open)
+    {
+        return CY_DFU_ERROR_CMD;
+    }
+
+    seq = (uint16_t)((uint32_t)data[0] | ((uint32_t)data[1] << 8U));
+    app_window_active = true;
+
+    if (seq == app_window_next)
+    {
+        if (GetU32(&data[8]) != crc32c_update(0U, &data[DFU_APP_WINDOW_HEADER], rowsLength))
+        {
+            app_window_result = CY_DFU_ERROR_CHECKSUM;
+        }
+        else
+        {
+            address = GetU32(&data[4]);
+            app_window_written[1] = app_window_written[0];
+            app_window_written[0].seq = seq;
+            app_window_written[0].start = address;
+            app_window_written[0].end = address + rowsLength;
+
+            /* The rows follow the 4-byte aligned header, as the DFU data buffer */
+            app_window_result = WriteRows(address, rowsLength, &data[DFU_APP_WINDOW_HEADER], 0U,
+                                          DFU_NVM_RANGE_WRITE, NULL);
+        }
+
+        if (app_window_result == CY_DFU_SUCCESS)
+        {
+            app_window_next++;
+        }
+    }
+    else if ((uint16_t)(seq - app_window_next) < 0x8000U)
+    {
+        /* Ahead of a missing packet, keep the status of a failed one */
+        if (app_window_result == CY_DFU_SUCCESS)
+        {
+            app_window_result = CY_DFU_ERROR_DATA;
+        }
+    }
+    else
+    {
+        /* Written before, sent again after a lost acknowledgement */
+    }
+
+    if ((data[2] & DFU_APP_WINDOW_ACK_REQ) != 0U)
+    {
+        /* Acknowledge programmed rows only, the host does not send acknowledged packets again */
+        (void) dfu_nvm_flush();
+    }
+
+    if (NvmRowFailed(&failed))
+    {
+        /* The newest packet that wrote the row, its rows are sent again */
+        uint32_t idx = 0U;
+        while ((idx < 2U) && ((failed - app_window_written[idx].start) >=
+                              (app_window_written[idx].end - app_window_written[idx].start)))
+        {
+            idx++;
+        }
+
+        app_window_result = CY_DFU_ERROR_DATA;
+        if (idx < 2U)
+        {
+            app_window_next = app_window_written[idx].seq;
+        }
+        else
+        {
+            /* Not a row of this window, the host cannot send it again */
+            app_window_open = false;
+        }
+    }
+
+    if ((data[2] & DFU_APP_WINDOW_ACK_REQ) != 0U)
+    {
+        rsp[0] = (uint8_t)app_window_next;
+        rsp[1] = (uint8_t)(app_window_next >> 8U);
+        rsp[2] = (uint8_t)app_window_result;
+        *rspLength = 3U;
+    }
+
+    return CY_DFU_SUCCESS;
+}
+#endif /* DFU_APP_WINDOW */
+
+
+/*******************************************************************************
+* Function Name: AppCmdProcess
+****************************************************************************//**
+*
+* Internal function to answer a received packet that holds an application
+* command. Other packets are left to the DFU middleware.
+*
+* \param packet     The received packet.
+* \param count      The number of received bytes.
+*
+* \return True - the packet was an application command and is answered
+*
+*******************************************************************************/
+static bool AppCmdProcess(const uint8_t packet[], uint32_t count)
+{
+    cy_en_dfu_status_t status = CY_DFU_ERROR_CMD;
+    dfu_app_cmd_handler_t handler = NULL;
+    uint32_t rspLength = 0U;
+    uint32_t length;
+
+    if ((count < DFU_PACKET_OVERHEAD) || (packet[0] != DFU_PACKET_SOP))
+    {
+        return false;
+    }
+
+    for (uint32_t idx = 0U; idx < (sizeof(app_cmds) / sizeof(app_cmds[0])); idx++)
+    {
+        if (app_cmds[idx].cmd == packet[1])
+        {
+            handler = app_cmds[idx].handler;
+            break;
+        }
+    }
+
+    if (handler == NULL)
+    {
+        return false;
+    }
+
+    length = (uint32_t)packet[2] | ((uint32_t)packet[3] << 8U);
+    if ((count < (length + DFU_PACKET_OVERHEAD)) || (packet[length + 6U] != DFU_PACKET_EOP))
+    {
+        status = CY_DFU_ERROR_LENGTH;
+    }
+    else if (PacketChecksum(packet, length + 4U) !=
+             (uint16_t)((uint32_t)packet[length + 4U] | ((uint32_t)packet[length + 5U] << 8U)))
+    {
+        status = CY_DFU_ERROR_CHECKSUM;
+    }
+    else
+    {
+        status = handler(&packet[4], length, &app_cmd_rsp[4], &rspLength);
+    }
+
+#if (DFU_APP_WINDOW != 0u)
+    /* Windowed data is answered on request only, a corrupted packet not at all */
+    if ((packet[1] == DFU_APP_CMD_WINDOW_DATA) && ((status != CY_DFU_SUCCESS) || (rspLength == 0U)))
+    {
+        return true;
+    }
+#endif /* DFU_APP_WINDOW */
+
+    if ((packet[1] == DFU_APP_CMD_RANGE_DIGEST) && (status == CY_DFU_SUCCESS))
+    {
+        /* Answered by dfu_app_digest_run() once the digest is done */
+        return true;
+    }
+
+    AppCmdRespond(status, rspLength);
+
+    return true;
+}
+
+
+/*******************************************************************************
+* Function Name: AppCmdRespond
+****************************************************************************//**
+*
+* Internal function to frame and send the response to an application command.
+*
+* \param status     The command status.
+* \param rspLength  The response data length, the data is in app_cmd_rsp.
+*
+*******************************************************************************/
+static void AppCmdRespond(cy_en_dfu_status_t status, uint32_t rspLength)
+{
+    uint32_t written;
+    uint16_t checksum;
+
+    if (status != CY_DFU_SUCCESS)
+    {
+        rspLength = 0U;
+    }
+
+    app_cmd_rsp[0] = DFU_PACKET_SOP;
+    app_cmd_rsp[1] = (uint8_t)status;
+    app_cmd_rsp[2] = (uint8_t)rspLength;
+    app_cmd_rsp[3] = (uint8_t)(rspLength >> 8U);
+    checksum = PacketChecksum(app_cmd_rsp, rspLength + 4U);
+    app_cmd_rsp[rspLength + 4U] = (uint8_t)checksum;
+    app_cmd_rsp[rspLength + 5U] = (uint8_t)(checksum >> 8U);
+    app_cmd_rsp[rspLength + 6U] = DFU_PACKET_EOP;
+
+    (void)Cy_DFU_TransportWrite(app_cmd_rsp, rspLength + DFU_PACKET_OVERHEAD, &written, DFU_APP_CMD_TIMEOUT_MS);
+}
+#endif /* DFU_APP_CMD_ENABLE */
+
+
+/*******************************************************************************
+* Function Name: dfu_app_window_enable
+****************************************************************************//**
+*
+* Accept windowed writes in a DFU session or stop accepting them, see
+* dfu_app_cmd.h.
+*
+*******************************************************************************/
+void dfu_app_window_enable(bool enable)
+{
+#if (DFU_APP_WINDOW != 0u)
+    app_window_enabled = enable;
+    app_window_open = false;
+    app_window_active = false;
+#else
+    CY_UNUSED_PARAMETER(enable);
+#endif /* DFU_APP_WINDOW */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_app_window_active
+****************************************************************************//**
+*
+* Tell whether windowed data packets arrived since the last call, see
+* dfu_app_cmd.h.
+*
+*******************************************************************************/
+bool dfu_app_window_active(void)
+{
+    bool active = false;
+
+#if (DFU_APP_WINDOW != 0u)
+    active = app_window_active;
+    app_window_active = false;
+#endif /* DFU_APP_WINDOW */
+
+    return active;
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_app_digest_pending
+****************************************************************************//**
+*
+* Tell whether a range digest is in progress, see dfu_app_cmd.h.
+*
+*******************************************************************************/
+bool dfu_app_digest_pending(void)
+{
+#if (DFU_APP_CMD_ENABLE != 0u)
+    return app_digest_pending;
+#else
+    return false;
+#endif /* DFU_APP_CMD_ENABLE */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_app_digest_run
+****************************************************************************//**
+*
+* Digest the next slice of the range, and answer the host once the range is
+* done, see dfu_app_cmd.h.
+*
+*******************************************************************************/
+void dfu_app_digest_run(uint32_t budget)
+{
+#if (DFU_APP_CMD_ENABLE != 0u)
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    uint32_t rspLength = 0U;
+    uint32_t size = app_digest_end - app_digest_next;
+    const uint8_t *data = (const uint8_t *)(uintptr_t)app_digest_next;
+
+    if (!app_digest_pending || (budget == 0U))
+    {
+        return;
+    }
+
+    if (size > budget)
+    {
+        size = budget;
+    }
+
+    if (app_digest_alg == DFU_APP_DIGEST_CRC32C)
+    {
+        app_digest_crc = crc32c_update(app_digest_crc, data, size);
+    }
+#if defined(MCUBOOT_IMAGE)
+    else if (psa_hash_update(&app_digest_op, data, size) != PSA_SUCCESS)
+    {
+        status = CY_DFU_ERROR_DATA;
+    }
+#endif /* MCUBOOT_IMAGE */
+    else
+    {
+        /* Started for the algorithms above only */
+    }
+
+    app_digest_next += size;
+    if ((status == CY_DFU_SUCCESS) && (app_digest_next != app_digest_end))
+    {
+        return;
+    }
+
+    app_digest_pending = false;
+    if (status != CY_DFU_SUCCESS)
+    {
+    #if defined(MCUBOOT_IMAGE)
+        (void) psa_hash_abort(&app_digest_op);
+    #endif /* MCUBOOT_IMAGE */
+    }
+    else if (app_digest_alg == DFU_APP_DIGEST_CRC32C)
+    {
+        app_cmd_rsp[4] = (uint8_t)app_digest_crc;
+        app_cmd_rsp[5] = (uint8_t)(app_digest_crc >> 8U);
+        app_cmd_rsp[6] = (uint8_t)(app_digest_crc >> 16U);
+        app_cmd_rsp[7] = (uint8_t)(app_digest_crc >> 24U);
+        rspLength = 4U;
+    }
+    else
+    {
+    #if defined(MCUBOOT_IMAGE)
+        size_t hashLength = 0U;
+        status = (psa_hash_finish(&app_digest_op, &app_cmd_rsp[4], DFU_APP_RSP_DATA_MAX, &hashLength) == PSA_SUCCESS) ?
+                 CY_DFU_SUCCESS : CY_DFU_ERROR_DATA;
+        rspLength = (uint32_t)hashLength;
+    #endif /* MCUBOOT_IMAGE */
+    }
+
+    AppCmdRespond(status, rspLength);
+#else
+    CY_UNUSED_PARAMETER(budget);
+#endif /* DFU_APP_CMD_ENABLE */
+}
+
+
+/*******************************************************************************
+* Function Name: NvmCriticalEnter
+****************************************************************************//**
+*
+* Internal function to mask interrupts for an NVM operation on the row at
+* address. With DFU_NVM_RWW, rows of the inactive bank are written with
+* interrupts enabled: the running code is fetched from the other bank.
+*
+* \param address    The row address.
+*
+* \return The value for NvmCriticalExit(), DFU_NVM_UNMASKED when interrupts
+*         were left enabled
+*
+*******************************************************************************/
+static uint32_t NvmCriticalEnter(uint32_t address)
+{
+    uint32_t int_status = DFU_NVM_UNMASKED;
+    bool inactive_bank = false;
+
+#if (DFU_NVM_RWW != 0u) && defined(CY_DUAL_FLASH_S_SBUS_BASE)
+    inactive_bank = (_FLD2VAL(FLASHC_FLASH_CTL_BANK_MODE, FLASHC_FLASH_CTL) != 0U) &&
+                    (CY_DUAL_FLASH_S_SBUS_BASE <= address) &&
+                    (address < (CY_DUAL_FLASH_S_SBUS_BASE + CY_DUAL_FLASH_S_SIZE));
+#else
+    CY_UNUSED_PARAMETER(address);
+#endif /* DFU_NVM_RWW */
+
+    if (!inactive_bank)
+    {
+        int_status = mtb_hal_system_critical_section_enter();
+    #if (DFU_NVM_IRQ_PROBE != 0u)
+        nvm_irq_masked_start = DWT->CYCCNT;
+    #endif /* DFU_NVM_IRQ_PROBE */
+    }
+
+    return int_status;
+}
+
+
+/*******************************************************************************
+* Function Name: NvmCriticalExit
+****************************************************************************//**
+*
+* Internal function to restore interrupts after NvmCriticalEnter().
+*
+* \param int_status The value returned by NvmCriticalEnter().
+*
+*******************************************************************************/
+static void NvmCriticalExit(uint32_t int_status)
+{
+    if (int_status != DFU_NVM_UNMASKED)
+    {
+    #if (DFU_NVM_IRQ_PROBE != 0u)
+        uint32_t masked = DWT->CYCCNT - nvm_irq_masked_start;
+        if (masked > nvm_irq_masked_max)
+        {
+            nvm_irq_masked_max = masked;
+        }
+    #endif /* DFU_NVM_IRQ_PROBE */
+        mtb_hal_system_critical_section_exit(int_status);
+    }
+}
+
+
+#if (DFU_NVM_IRQ_PROBE != 0u)
+/*******************************************************************************
+* Function Name: dfu_nvm_irq_masked_max
+****************************************************************************//**
+*
+* Longest interval the NVM write path kept interrupts masked, see dfu_nvm.h.
+*
+*******************************************************************************/
+uint32_t dfu_nvm_irq_masked_max(bool reset)
+{
+    uint32_t masked = nvm_irq_masked_max;
+
+    if (reset)
+    {
+        nvm_irq_masked_max = 0U;
+    }
+
+    return masked;
+}
+#endif /* DFU_NVM_IRQ_PROBE */
+
+
+/*******************************************************************************
+* Function Name: NvmRowTake
+****************************************************************************//**
+*
+* Internal function to record that the row at address is written in this
+* session.
+*
+* \param address    The row address.
+*
+* \return True - the row is erased, it only needs programming
+*
+*******************************************************************************/
+static bool NvmRowTake(uint32_t address)
+{
+    bool blank = false;
+
+#if (DFU_NVM_PRE_ERASE != 0u)
+    uint32_t offset = address - nvm_erase_base;
+
+    if ((address >= nvm_erase_base) && (offset < nvm_erase_size))
+    {
+        uint32_t row = offset / CY_NVM_SIZEOF_ROW;
+        uint32_t mask = 1UL << (row % 32U);
+
+        blank = ((nvm_row_blank[row / 32U] & mask) != 0U);
+        nvm_row_blank[row / 32U] &= ~mask;
+        nvm_row_written[row / 32U] |= mask;
+    }
+#else
+    CY_UNUSED_PARAMETER(address);
+#endif /* DFU_NVM_PRE_ERASE */
+
+    return blank;
+}
+
+
+#if (DFU_APP_WINDOW != 0u)
+/*******************************************************************************
+* Function Name: NvmRowFailed
+****************************************************************************//**
+*
+* Internal function to get the row that failed in the background and was not
+* written again since. A row that is written again is not reported while it
+* is programming.
+*
+* \param address    Set to the row address.
+*
+* \return True - the row at address failed
+*
+*******************************************************************************/
+static bool NvmRowFailed(uint32_t *address)
+{
+    bool failed = false;
+
+#if (DFU_NVM_ASYNC != 0u)
+    failed = nvm_failed && !(nvm_busy && !nvm_busy_erase && (nvm_busy_addr == nvm_failed_addr));
+    *address = nvm_failed_addr;
+#else
+    *address = 0U;
+#endif /* DFU_NVM_ASYNC */
+
+    return failed;
+}
+#endif /* DFU_APP_WINDOW */
+
+
+#if (DFU_NVM_JOURNAL != 0u)
+/*******************************************************************************
+* Function Name: NvmJournalLoad
+****************************************************************************//**
+*
+* Internal function to take the completed rows from the journal row when it
+* is intact and belongs to the image tag. The flash must be idle.
+*
+* \param tag        The image tag of the host.
+*
+* \return True - the journal is loaded
+*
+*******************************************************************************/
+static bool NvmJournalLoad(uint32_t tag)
+{
+    const dfu_nvm_journal_t *rec = (const dfu_nvm_journal_t *)DFU_NVM_JOURNAL_ADDR;
+    bool valid = (rec->magic == DFU_NVM_JOURNAL_MAGIC) && (rec->tag == tag) &&
+                 (rec->base == FLASH_ADDR(0u)) && (rec->rows == DFU_NVM_JOURNAL_ROWS) &&
+                 (rec->crc == crc32c_update(0U, (const uint8_t *)rec, offsetof(dfu_nvm_journal_t, crc)));
+
+    if (valid)
+    {
+        (void) memcpy(&nvm_journal, rec, sizeof(nvm_journal));
+        (void) memcpy(nvm_journal_saved, rec->done, sizeof(nvm_journal_saved));
+        nvm_journal_pending = 0U;
+    }
+
+    return valid;
+}
+
+
+/*******************************************************************************
+* Function Name: NvmJournalInFlash
+****************************************************************************//**
+*
+* Internal function to check the metadata row for a journal of any image tag.
+* The flash must be idle.
+*
+* \return True - the metadata row holds a journal
+*
+*******************************************************************************/
+static bool NvmJournalInFlash(void)
+{
+    return (((const dfu_nvm_journal_t *)DFU_NVM_JOURNAL_ADDR)->magic == DFU_NVM_JOURNAL_MAGIC);
+}
+
+
+/*******************************************************************************
+* Function Name: NvmJournalWrite
+****************************************************************************//**
+*
+* Internal function to write the completed rows to the journal row, or to
+* clear the row. Waits for the pending row first, so every row in the journal
+* is programmed, and for the journal row itself. A write torn by a power
+* failure leaves a row that fails the CRC check and nothing is resumed.
+*
+* \param keep       Write the journal, otherwise write a row of zeros.
+*
+*******************************************************************************/
+static void NvmJournalWrite(bool keep)
+{
+    cy_en_dfu_status_t status;
+    bool blank;
+
+    if (!nvm_journal_owned)
+    {
+        return;
+    }
+
+#if (DFU_NVM_ASYNC != 0u)
+    (void) NvmWait();
+
+    /* A failed journal row is not a row of the image, keep the failed row of the image */
+    bool failed = nvm_failed;
+    uint32_t failed_addr = nvm_failed_addr;
+#endif /* DFU_NVM_ASYNC */
+
+    (void) memset(nvm_journal_row, 0, sizeof(nvm_journal_row));
+    if (keep)
+    {
+        nvm_journal.magic = DFU_NVM_JOURNAL_MAGIC;
+        nvm_journal.base = FLASH_ADDR(0u);
+        nvm_journal.rows = DFU_NVM_JOURNAL_ROWS;
+        nvm_journal.crc = crc32c_update(0U, (const uint8_t *)&nvm_journal, offsetof(dfu_nvm_journal_t, crc));
+        (void) memcpy(nvm_journal_row, &nvm_journal, sizeof(nvm_journal));
+    }
+
+#if (DFU_NVM_ASYNC != 0u)
+    blank = NvmRowTake(DFU_NVM_JOURNAL_ADDR);
+    status = NvmStartWrite(DFU_NVM_JOURNAL_ADDR, nvm_journal_row, blank);
+    if (status == CY_DFU_SUCCESS)
+    {
+        status = NvmWait();
+    }
+    nvm_failed = failed;
+    nvm_failed_addr = failed_addr;
+#else
+    uint32_t int_status = NvmCriticalEnter(DFU_NVM_JOURNAL_ADDR);
+    blank = NvmRowTake(DFU_NVM_JOURNAL_ADDR);
+    cy_rslt_t fstatus = blank ? mtb_hal_nvm_program(&nvm_obj, DFU_NVM_JOURNAL_ADDR, (uint32_t*)nvm_journal_row) :
+                                mtb_hal_nvm_write(&nvm_obj, DFU_NVM_JOURNAL_ADDR, (uint32_t*)nvm_journal_row);
+    NvmCriticalExit(int_status);
+    status = (fstatus == CY_RSLT_SUCCESS) ? CY_DFU_SUCCESS : CY_DFU_ERROR_DATA;
+#endif /* DFU_NVM_ASYNC */
+
+    for (uint32_t idx = 0U; idx < DFU_NVM_JOURNAL_WORDS; idx++)
+    {
+        uint32_t done = keep ? nvm_journal.done[idx] : 0U;
+
+        /* The row content is unknown after a failure */
+        nvm_journal_saved[idx] = (status == CY_DFU_SUCCESS) ? done : (nvm_journal_saved[idx] | done);
+    }
+
+    if (status == CY_DFU_SUCCESS)
+    {
+        nvm_journal_pending = 0U;
+    }
+    else
+    {
+        CY_DFU_LOG_WRN("NVM journal write failed");
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: NvmJournalPrepare
+****************************************************************************//**
+*
+* Internal function to update the journal before the row at address is
+* written. A completed row that is written again is dropped from the journal
+* row first, it is not intact while it is reprogrammed. The journal row is
+* written every DFU_NVM_RESUME_INTERVAL completed rows. When the metadata row
+* is written as image data, the journal is kept in RAM only.
+*
+* \param address    The row address.
+*
+*******************************************************************************/
+static void NvmJournalPrepare(uint32_t address)
+{
+    uint32_t offset = address - FLASH_ADDR(0u);
+    bool write = (nvm_journal_pending >= DFU_NVM_RESUME_INTERVAL);
+
+    if (address == DFU_NVM_JOURNAL_ADDR)
+    {
+        nvm_journal_owned = false;
+    }
+    else if ((nvm_journal.tag != 0U) && (address >= FLASH_ADDR(0u)) && (offset < IMAGE_SLOT_SIZE))
+    {
+        uint32_t row = offset / CY_NVM_SIZEOF_ROW;
+        uint32_t mask = 1UL << (row % 32U);
+
+        nvm_journal.done[row / 32U] &= ~mask;
+        write = write || ((nvm_journal_saved[row / 32U] & mask) != 0U);
+    }
+    else
+    {
+        /* Rows outside the slot are not journaled */
+    }
+
+    if (write && (nvm_journal.tag != 0U))
+    {
+        NvmJournalWrite(true);
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: NvmJournalRowDone
+****************************************************************************//**
+*
+* Internal function to record that the row at address is programmed.
+*
+* \param address    The row address.
+*
+*******************************************************************************/
+static void NvmJournalRowDone(uint32_t address)
+{
+    uint32_t offset = address - FLASH_ADDR(0u);
+
+    /* The journal row itself is not a row of the image */
+    if ((nvm_journal.tag != 0U) && (address >= FLASH_ADDR(0u)) && (offset < IMAGE_SLOT_SIZE) &&
+        !(nvm_journal_owned && (address == DFU_NVM_JOURNAL_ADDR)))
+    {
+        uint32_t row = offset / CY_NVM_SIZEOF_ROW;
+        uint32_t mask = 1UL << (row % 32U);
+
+        if ((nvm_journal.done[row / 32U] & mask) == 0U)
+        {
+            nvm_journal.done[row / 32U] |= mask;
+            nvm_journal_pending++;
+        }
+    }
+}
+#endif /* DFU_NVM_JOURNAL */
+
+
+#if (DFU_NVM_PRE_ERASE != 0u)
+/*******************************************************************************
+* Function Name: NvmSectorWritten
+****************************************************************************//**
+*
+* Internal function to check the pre-erase sector at offset for rows written
+* in this session. Erasing it would lose them.
+*
+* \param offset     The sector offset in the pre-erased slot.
+*
+* \return True - a row of the sector is written
+*
+*******************************************************************************/
+static bool NvmSectorWritten(uint32_t offset)
+{
+    uint32_t first = offset / CY_NVM_SIZEOF_ROW;
+    uint32_t end = first + (nvm_erase_sector_size / CY_NVM_SIZEOF_ROW);
+    bool written = false;
+
+    for (uint32_t row = first; (row < end) && !written; row++)
+    {
+        written = ((nvm_row_written[row / 32U] & (1UL << (row % 32U))) != 0U);
+    }
+
+    return written;
+}
+
+
+/*******************************************************************************
+* Function Name: NvmSectorSetBlank
+****************************************************************************//**
+*
+* Internal function to mark the rows of an erased pre-erase sector as blank.
+*
+* \param offset     The sector offset in the pre-erased slot.
+*
+*******************************************************************************/
+static void NvmSectorSetBlank(uint32_t offset)
+{
+    uint32_t first = offset / CY_NVM_SIZEOF_ROW;
+    uint32_t end = first + (nvm_erase_sector_size / CY_NVM_SIZEOF_ROW);
+
+    for (uint32_t row = first; row < end; row++)
+    {
+        nvm_row_blank[row / 32U] |= (1UL << (row % 32U));
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: NvmSectorErase
+****************************************************************************//**
+*
+* Internal function to erase a pre-erase sector and wait for it.
+*
+* \param offset     The sector offset in the pre-erased slot.
+*
+* \return CY_DFU_SUCCESS - the sector is erased, its rows are marked blank
+*
+*******************************************************************************/
+static cy_en_dfu_status_t NvmSectorErase(uint32_t offset)
+{
+    cy_en_dfu_status_t status;
+
+#if (DFU_NVM_ASYNC != 0u)
+    /* NvmWait() marks the rows blank */
+    status = NvmStartErase(nvm_erase_base + offset);
+    if (status == CY_DFU_SUCCESS)
+    {
+        status = NvmWait();
+    }
+#else
+    uint32_t int_status = NvmCriticalEnter(nvm_erase_base + offset);
+    cy_rslt_t fstatus = mtb_hal_nvm_erase(&nvm_obj, nvm_erase_base + offset);
+    NvmCriticalExit(int_status);
+    if (fstatus == CY_RSLT_SUCCESS)
+    {
+        status = CY_DFU_SUCCESS;
+        NvmSectorSetBlank(offset);
+    }
+    else
+    {
+        status = CY_DFU_ERROR_DATA;
+        CY_DFU_LOG_WRN("NVM pre-erase at 0x%X failed: 0x%X",
+                            (unsigned int)(nvm_erase_base + offset), (unsigned int)fstatus);
+    }
+#endif /* DFU_NVM_ASYNC */
+
+    return status;
+}
+
+
+/*******************************************************************************
+* Function Name: NvmEraseAhead
+****************************************************************************//**
+*
+* Internal function to erase the sector of a row before the row is written,
+* when dfu_nvm_pre_erase_run() has not reached it yet and the sector has no
+* rows of this session. The row and the rest of the sector then only need
+* programming. A failed erase leaves the rows to be erased one by one.
+*
+* \param address    The row address.
+*
+*******************************************************************************/
+static void NvmEraseAhead(uint32_t address)
+{
+    uint32_t offset = address - nvm_erase_base;
+
+    if ((address >= nvm_erase_base) && (offset < nvm_erase_size))
+    {
+        uint32_t row = offset / CY_NVM_SIZEOF_ROW;
+        uint32_t sector = offset - (offset % nvm_erase_sector_size);
+
+        if (((nvm_row_blank[row / 32U] & (1UL << (row % 32U))) == 0U) && !NvmSectorWritten(sector))
+        {
+            (void) NvmSectorErase(sector);
+        }
+    }
+}
+#endif /* DFU_NVM_PRE_ERASE */
+
+
+#if (DFU_NVM_ASYNC != 0u)
+/*******************************************************************************
+* Function Name: NvmWait
+****************************************************************************//**
+*
+* Internal function to wait for the row started by NvmStartWrite() or the
+* sector started by NvmStartErase(). A row that failed in the background is
+* written once more with a blocking write, its data is still in the pipeline
+* buffer, or in the buffer it was written from with DFU_NVM_ZERO_COPY. A
+* sector that failed stays unerased, its rows are erased as they are written.
+* A row that fails the retry as well is kept in nvm_failed_addr until it is
+* written again.
+*
+* \return CY_DFU_SUCCESS - no row is pending or the pending row is programmed
+*
+*******************************************************************************/
+static cy_en_dfu_status_t NvmWait(void)
+{
+    cy_en_flashdrv_status_t fstatus = CY_FLASH_DRV_SUCCESS;
+
+    if (nvm_busy)
+    {
+        do
+        {
+            fstatus = Cy_Flash_IsOperationComplete();
+        } while (fstatus == CY_FLASH_DRV_OPCODE_BUSY);
+    }
+
+    return NvmComplete(fstatus);
+}
+
+
+#if (DFU_NVM_ZERO_COPY != 0u)
+/*******************************************************************************
+* Function Name: NvmRowIn
+****************************************************************************//**
+*
+* Internal function to check if the row in flight is programmed from a buffer.
+*
+* \param buffer     The buffer.
+* \param size       The size of the buffer in bytes.
+*
+* \return True - a row is programming from the buffer
+*
+*******************************************************************************/
+static bool NvmRowIn(const uint8_t buffer[], uint32_t size)
+{
+    return nvm_busy && !nvm_busy_erase &&
+           (((uintptr_t)nvm_busy_row - (uintptr_t)buffer) < (uintptr_t)size);
+}
+#endif /* DFU_NVM_ZERO_COPY */
+
+
+/*******************************************************************************
+* Function Name: NvmComplete
+****************************************************************************//**
+*
+* Internal function to finish the operation NvmWait() or a poll saw complete.
+* The flash driver reports the result of an operation once, the poll that
+* sees it complete passes it here.
+*
+* \param fstatus    The result of the operation in flight.
+*
+* \return CY_DFU_SUCCESS - no row is pending or the pending row is programmed
+*
+*******************************************************************************/
+static cy_en_dfu_status_t NvmComplete(cy_en_flashdrv_status_t fstatus)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+
+    if (nvm_busy)
+    {
+        nvm_busy = false;
+
+        if (nvm_busy_erase)
+        {
+        #if (DFU_NVM_PRE_ERASE != 0u)
+            if (fstatus == CY_FLASH_DRV_SUCCESS)
+            {
+                NvmSectorSetBlank(nvm_busy_addr - nvm_erase_base);
+            }
+            else
+            {
+                CY_DFU_LOG_WRN("NVM pre-erase at 0x%X failed: 0x%X",
+                                    (unsigned int)nvm_busy_addr, (unsigned int)fstatus);
+            }
+        #endif /* DFU_NVM_PRE_ERASE */
+        }
+        else
+        {
+            if (fstatus != CY_FLASH_DRV_SUCCESS)
             {
-                fstatus = mtb_hal_nvm_program(&nvm_obj, address, (uint32_t*)params->dataBuffer);
-                if(fstatus != CY_RSLT_SUCCESS)
+                CY_DFU_LOG_WRN("NVM write at 0x%X failed in background: 0x%X, retrying",
+                                    (unsigned int)nvm_busy_addr, (unsigned int)fstatus);
+
+            #if defined(MCUBOOT_IMAGE)
+                /* The row was hashed from RAM when it started, the flash may not hold it */
+                img_hash_stream_reset();
+            #endif /* MCUBOOT_IMAGE */
+
+                uint32_t int_status = NvmCriticalEnter(nvm_busy_addr);
+                cy_rslt_t result = mtb_hal_nvm_write(&nvm_obj, nvm_busy_addr, (const uint32_t*)nvm_busy_row);
+                NvmCriticalExit(int_status);
+                if (result != CY_RSLT_SUCCESS)
                 {
                     status = CY_DFU_ERROR_DATA;
-                    CY_DFU_LOG_ERR("NVM program failed: module=0x%X code=0x%X",
-                                        (unsigned int)CY_RSLT_GET_MODULE(fstatus),
-                                        (unsigned int)CY_RSLT_GET_CODE(fstatus));
+                    CY_DFU_LOG_ERR("NVM write failed: fstatus 0x%X ", (unsigned int)result);
                 }
             }
+
+            if (status != CY_DFU_SUCCESS)
+            {
+                /* The row stays bad until the host writes it again */
+                nvm_failed = true;
+                nvm_failed_addr = nvm_busy_addr;
+            }
             else
+            {
+                if (nvm_failed && (nvm_failed_addr == nvm_busy_addr))
+                {
+                    nvm_failed = false;
+                }
+            #if (DFU_NVM_JOURNAL != 0u)
+                NvmJournalRowDone(nvm_busy_addr);
+            #endif /* DFU_NVM_JOURNAL */
+            }
+        }
+    }
+
+    return status;
+}
+
+
+/*******************************************************************************
+* Function Name: NvmStartWrite
+****************************************************************************//**
+*
+* Internal function to start erasing and programming a row without waiting
+* for it. The row buffer must not change until NvmWait() returns.
+*
+* \param address        The row address.
+* \param row            The row data, CY_NVM_SIZEOF_ROW bytes.
+* \param programOnly    The row is erased already, skip the erase.
+*
+* \return CY_DFU_SUCCESS - the row is being programmed
+*
+*******************************************************************************/
+static cy_en_dfu_status_t NvmStartWrite(uint32_t address, const uint8_t *row, bool programOnly)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    cy_en_flashdrv_status_t fstatus;
+
+    /* Only the start sequence runs here, the flash works on in the background */
+    uint32_t int_status = NvmCriticalEnter(address);
+    if (programOnly)
+    {
+        fstatus = Cy_Flash_StartProgram(address, (const uint32_t*)row);
+    }
+    else
+    {
+        fstatus = Cy_Flash_StartWrite(address, (const uint32_t*)row);
+    }
+    NvmCriticalExit(int_status);
+
+    if ((fstatus == CY_FLASH_DRV_OPERATION_STARTED) || (fstatus == CY_FLASH_DRV_SUCCESS))
+    {
+        nvm_busy = true;
+        nvm_busy_erase = false;
+        nvm_busy_addr = address;
+        nvm_busy_row = row;
+    }
+    else
+    {
+        status = CY_DFU_ERROR_DATA;
+        CY_DFU_LOG_ERR("NVM write start failed: fstatus 0x%X ", (unsigned int)fstatus);
+    }
+
+    return status;
+}
+
+
+#if (DFU_NVM_PRE_ERASE != 0u)
+/*******************************************************************************
+* Function Name: NvmStartErase
+****************************************************************************//**
+*
+* Internal function to start erasing a pre-erase sector without waiting for it.
+*
+* \param address    The sector address.
+*
+* \return CY_DFU_SUCCESS - the sector is being erased
+*
+*******************************************************************************/
+static cy_en_dfu_status_t NvmStartErase(uint32_t address)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+
+    uint32_t int_status = NvmCriticalEnter(address);
+    cy_en_flashdrv_status_t fstatus = Cy_Flash_StartEraseSector(address);
+    NvmCriticalExit(int_status);
+
+    if ((fstatus == CY_FLASH_DRV_OPERATION_STARTED) || (fstatus == CY_FLASH_DRV_SUCCESS))
+    {
+        nvm_busy = true;
+        nvm_busy_erase = true;
+        nvm_busy_addr = address;
+    }
+    else
+    {
+        status = CY_DFU_ERROR_DATA;
+        CY_DFU_LOG_WRN("NVM pre-erase start failed: fstatus 0x%X ", (unsigned int)fstatus);
+    }
+
+    return status;
+}
+#endif /* DFU_NVM_PRE_ERASE */
+#endif /* DFU_NVM_ASYNC */
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_flush
+****************************************************************************//**
+*
+* Wait for the row that is programmed in the background, see dfu_nvm.h.
+*
+*******************************************************************************/
+cy_en_dfu_status_t dfu_nvm_flush(void)
+{
+#if (DFU_NVM_ASYNC != 0u)
+    (void) NvmWait();
+
+    return nvm_failed ? CY_DFU_ERROR_DATA : CY_DFU_SUCCESS;
+#else
+    return CY_DFU_SUCCESS;
+#endif /* DFU_NVM_ASYNC */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_pre_erase_start
+****************************************************************************//**
+*
+* Start erasing a slot ahead of a DFU session, see dfu_nvm.h.
+*
+*******************************************************************************/
+void dfu_nvm_pre_erase_start(uint32_t address, uint32_t size)
+{
+#if (DFU_NVM_ASYNC != 0u)
+    /* A sector of the last session may still be erasing, a row it failed is sent again by the host */
+    (void) NvmWait();
+    nvm_failed = false;
+#endif /* DFU_NVM_ASYNC */
+
+#if defined(MCUBOOT_IMAGE)
+    /* A previously verified image is about to change */
+    image_auth_cache_invalidate(address);
+#endif /* MCUBOOT_IMAGE */
+
+#if (DFU_NVM_PRE_ERASE != 0u)
+    const dfu_nvm_range_t *range;
+    uint32_t sector;
+
+    nvm_erase_size = 0U;
+    (void) memset(nvm_row_blank, 0, sizeof(nvm_row_blank));
+    (void) memset(nvm_row_written, 0, sizeof(nvm_row_written));
+
+    if ((size == 0U) || (size > IMAGE_SLOT_SIZE) || !AddressValid(address, DFU_NVM_RANGE_WRITE, &range))
+    {
+        CY_DFU_LOG_WRN("Pre-erase skipped for 0x%X", (unsigned int)address);
+        return;
+    }
+
+    sector = range->sector_size;
+    if ((DFU_NVM_META_LOCKED != 0u) && (sector >= CY_NVM_SIZEOF_ROW) &&
+        ((range->last + 1U) == FLASH_ADDR(IMAGE_META_OFFSET)) && ((size - 1U) > (range->last - address)))
+    {
+        /* The locked metadata row ends the range, the sector that holds it is erased as its rows are written */
+        size = (FLASH_ADDR(IMAGE_META_OFFSET) - address) / sector * sector;
+    }
+    if ((size == 0U) || ((size - 1U) > (range->last - address)) || (sector < CY_NVM_SIZEOF_ROW) ||
+        !IsMultipleOf(sector, CY_NVM_SIZEOF_ROW) || !IsMultipleOf(address - range->start, sector) ||
+        !IsMultipleOf(size, sector))
+    {
+        CY_DFU_LOG_WRN("Pre-erase skipped for 0x%X", (unsigned int)address);
+        return;
+    }
+
+    nvm_erase_base = address;
+    nvm_erase_size = size;
+    nvm_erase_next = 0U;
+    nvm_erase_sector_size = sector;
+#else
+    CY_UNUSED_PARAMETER(address);
+    CY_UNUSED_PARAMETER(size);
+#endif /* DFU_NVM_PRE_ERASE */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_pre_erase_run
+****************************************************************************//**
+*
+* Erase the next sector of the pre-erased slot, see dfu_nvm.h.
+*
+*******************************************************************************/
+void dfu_nvm_pre_erase_run(void)
+{
+#if (DFU_NVM_PRE_ERASE != 0u)
+    if (dfu_nvm_busy())
+    {
+        return;
+    }
+
+    /* Sectors with rows of this session keep them, sectors erased by NvmEraseAhead() are done */
+    while ((nvm_erase_next < nvm_erase_size) &&
+           (NvmSectorWritten(nvm_erase_next) ||
+            ((nvm_row_blank[(nvm_erase_next / CY_NVM_SIZEOF_ROW) / 32U] &
+              (1UL << ((nvm_erase_next / CY_NVM_SIZEOF_ROW) % 32U))) != 0U)))
+    {
+        nvm_erase_next += nvm_erase_sector_size;
+    }
+
+    if (nvm_erase_next < nvm_erase_size)
+    {
+        uint32_t offset = nvm_erase_next;
+        nvm_erase_next += nvm_erase_sector_size;
+
+    #if (DFU_NVM_ASYNC != 0u)
+        (void) NvmStartErase(nvm_erase_base + offset);
+    #else
+        (void) NvmSectorErase(offset);
+    #endif /* DFU_NVM_ASYNC */
+    }
+#endif /* DFU_NVM_PRE_ERASE */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_pre_erase_pending
+****************************************************************************//**
+*
+* Tell whether sectors of the slot are left to erase, see dfu_nvm.h.
+*
+*******************************************************************************/
+bool dfu_nvm_pre_erase_pending(void)
+{
+#if (DFU_NVM_PRE_ERASE != 0u)
+    return (nvm_erase_next < nvm_erase_size);
+#else
+    return false;
+#endif /* DFU_NVM_PRE_ERASE */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_busy
+****************************************************************************//**
+*
+* Tell whether a row or an erase is still in flight, see dfu_nvm.h.
+*
+*******************************************************************************/
+bool dfu_nvm_busy(void)
+{
+#if (DFU_NVM_ASYNC != 0u)
+    if (nvm_busy)
+    {
+        cy_en_flashdrv_status_t fstatus = Cy_Flash_IsOperationComplete();
+
+        if (fstatus == CY_FLASH_DRV_OPCODE_BUSY)
+        {
+            return true;
+        }
+
+        /* Keep a row failure for the next write */
+        (void) NvmComplete(fstatus);
+    }
+#endif /* DFU_NVM_ASYNC */
+
+    return false;
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_resume_start
+****************************************************************************//**
+*
+* Bind the row journal to a new DFU session, see dfu_nvm.h.
+*
+*******************************************************************************/
+void dfu_nvm_resume_start(void)
+{
+#if (DFU_NVM_JOURNAL != 0u)
+    #if (DFU_NVM_ASYNC != 0u)
+        /* The metadata row is read back */
+        (void) NvmWait();
+    #endif /* DFU_NVM_ASYNC */
+
+    nvm_journal_owned = true;
+    if (!nvm_journal_queried)
+    {
+        /* The host does not resume, its rows replace the journaled ones */
+        (void) memset(&nvm_journal, 0, sizeof(nvm_journal));
+        nvm_journal_pending = 0U;
+    }
+    nvm_journal_queried = false;
+
+    if (nvm_journal.tag != 0U)
+    {
+    #if (DFU_NVM_PRE_ERASE != 0u)
+        /* Completed rows keep their sectors from being pre-erased */
+        for (uint32_t idx = 0U; idx < DFU_NVM_JOURNAL_WORDS; idx++)
+        {
+            nvm_row_written[idx] |= nvm_journal.done[idx];
+        }
+    #endif /* DFU_NVM_PRE_ERASE */
+
+        /* Replace a journal of another image before its rows are overwritten */
+        NvmJournalWrite(true);
+    }
+    else if (NvmJournalInFlash())
+    {
+        NvmJournalWrite(false);
+    }
+    else
+    {
+        /* No journal */
+    }
+#endif /* DFU_NVM_JOURNAL */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_resume_checkpoint
+****************************************************************************//**
+*
+* Write the completed rows to the journal, see dfu_nvm.h.
+*
+*******************************************************************************/
+void dfu_nvm_resume_checkpoint(void)
+{
+#if (DFU_NVM_JOURNAL != 0u)
+    if (nvm_journal.tag != 0U)
+    {
+        /* The pending row may complete, so check the count afterwards */
+        #if (DFU_NVM_ASYNC != 0u)
+            (void) NvmWait();
+        #endif /* DFU_NVM_ASYNC */
+
+        if (nvm_journal_pending != 0U)
+        {
+            NvmJournalWrite(true);
+        }
+    }
+#endif /* DFU_NVM_JOURNAL */
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_resume_drop
+****************************************************************************//**
+*
+* Forget the completed rows, see dfu_nvm.h.
+*
+*******************************************************************************/
+void dfu_nvm_resume_drop(void)
+{
+#if (DFU_NVM_JOURNAL != 0u)
+    #if (DFU_NVM_ASYNC != 0u)
+        (void) NvmWait();
+    #endif /* DFU_NVM_ASYNC */
+
+    (void) memset(&nvm_journal, 0, sizeof(nvm_journal));
+    nvm_journal_pending = 0U;
+    nvm_journal_queried = false;
+
+    /* The image trailer or the verification cache may have replaced it already */
+    if (NvmJournalInFlash())
+    {
+        nvm_journal_owned = true;
+        NvmJournalWrite(false);
+    }
+#endif /* DFU_NVM_JOURNAL */
+}
+
+
+#if CY_DFU_FLOW == CY_DFU_BASIC_FLOW
+    /*******************************************************************************
+    * Function Name: GetStartEndAddress
+    ****************************************************************************//**
+    *
+    * This internal function returns start and end address of application
+    *
+    * \param appId          The application number
+    * \param startAddress   The pointer to a variable where an application start
+    *                       address is stored
+    * \param endAddress     The pointer to a variable where a size of application
+    *                       area is stored.
+    *
+    *******************************************************************************/
+    static void GetStartEndAddress(uint32_t appId, uint32_t *startAddress, uint32_t *endAddress)
+    {
+        uint32_t verifyStart;
+        uint32_t verifySize;
+
+        (void)Cy_DFU_GetAppMetadata(appId, &verifyStart, &verifySize);
+
+    #if (CY_DFU_APP_FORMAT == CY_DFU_SIMPLIFIED_APP)
+        *startAddress = verifyStart - CY_DFU_SIGNATURE_SIZE;
+        *endAddress = verifyStart + verifySize;
+    #else
+        *startAddress = verifyStart;
+        *endAddress = verifyStart + verifySize + CY_DFU_SIGNATURE_SIZE;
+    #endif
+    }
+#endif /* CY_DFU_FLOW == CY_DFU_BASIC_FLOW */
+
+
+/*******************************************************************************
+* Function Name: WriteRow
+****************************************************************************//**
+*
+* Internal function to write one row of a Cy_DFU_WriteData() request. While
+* a row of the session is failed, only a request that holds it is written.
+*
+* \param address    The row address.
+* \param end        The address past the last row of the request.
+* \param data       The row data, CY_NVM_SIZEOF_ROW bytes.
+* \param range      The address range of the row.
+*
+* \return CY_DFU_SUCCESS - the row is programmed or is programming
+*
+*******************************************************************************/
+static cy_en_dfu_status_t WriteRow(uint32_t address, uint32_t end, const uint8_t data[],
+                                   const dfu_nvm_range_t *range)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    cy_rslt_t fstatus = CY_RSLT_SUCCESS;
+
+    /* Row the hash and sector checks below read */
+    const uint8_t *row = data;
+    bool blank;
+
+    #if defined(MCUBOOT_IMAGE)
+        /* A previously verified image is about to change */
+        image_auth_cache_invalidate(address);
+    #endif /* MCUBOOT_IMAGE */
+
+    #if (DFU_NVM_JOURNAL != 0u)
+        NvmJournalPrepare(address);
+    #endif /* DFU_NVM_JOURNAL */
+
+    #if (DFU_NVM_ASYNC != 0u)
+        CY_UNUSED_PARAMETER(fstatus);
+        CY_UNUSED_PARAMETER(range);
+
+    #if (DFU_NVM_ZERO_COPY != 0u)
+        /* Programmed from the caller's buffer, Cy_DFU_TransportRead() keeps the next packet out of it */
+        CY_ASSERT(((uintptr_t)data % 4U) == 0U);
+    #else
+        /* Copy the row while the previous one is still programming */
+        (void) memcpy(nvm_row_buf[nvm_row_next], data, CY_NVM_SIZEOF_ROW);
+        row = nvm_row_buf[nvm_row_next];
+    #endif /* DFU_NVM_ZERO_COPY */
+
+        (void) NvmWait();
+        if (nvm_failed && ((nvm_failed_addr < address) || (nvm_failed_addr >= end)))
+        {
+            /* A row of this session is bad, only a request that writes it again goes on */
+            status = CY_DFU_ERROR_DATA;
+            CY_DFU_LOG_ERR("NVM row at 0x%X failed, write it again", (unsigned int)nvm_failed_addr);
+        }
+        else
+        {
+        #if (DFU_NVM_PRE_ERASE != 0u)
+            NvmEraseAhead(address);
+        #endif /* DFU_NVM_PRE_ERASE */
+            blank = NvmRowTake(address);
+            status = NvmStartWrite(address, row, blank);
+        #if (DFU_NVM_ZERO_COPY == 0u)
+            nvm_row_next = (nvm_row_next + 1U) % DFU_WRITE_PIPELINE_DEPTH;
+        #endif /* DFU_NVM_ZERO_COPY */
+        }
+    #elif defined(CY_IP_M7CPUSS)
+        uint32_t int_status;
+        CY_UNUSED_PARAMETER(end);
+    #if (DFU_NVM_PRE_ERASE != 0u)
+        NvmEraseAhead(address);
+    #endif /* DFU_NVM_PRE_ERASE */
+        int_status = NvmCriticalEnter(address);
+        blank = NvmRowTake(address);
+        if(!blank && (address % range->sector_size == 0U))
+        {
+            fstatus = mtb_hal_nvm_erase(&nvm_obj, address);
+        }
+        if(fstatus == CY_RSLT_SUCCESS)
+        {
+            fstatus = mtb_hal_nvm_program(&nvm_obj, address, (const uint32_t*)data);
+            if(fstatus != CY_RSLT_SUCCESS)
             {
                 status = CY_DFU_ERROR_DATA;
-                CY_DFU_LOG_ERR("NVM erase failed: module=0x%X code=0x%X",
+                CY_DFU_LOG_ERR("NVM program failed: module=0x%X code=0x%X",
                                     (unsigned int)CY_RSLT_GET_MODULE(fstatus),
                                     (unsigned int)CY_RSLT_GET_CODE(fstatus));
             }
-            mtb_hal_system_critical_section_exit(int_status);
+        }
+        else
+        {
+            status = CY_DFU_ERROR_DATA;
+            CY_DFU_LOG_ERR("NVM erase failed: module=0x%X code=0x%X",
+                                (unsigned int)CY_RSLT_GET_MODULE(fstatus),
+                                (unsigned int)CY_RSLT_GET_CODE(fstatus));
+        }
+        NvmCriticalExit(int_status);
+    #else
+        #if defined COMPONENT_CAT1B && defined COMPONENT_NON_SECURE_DEVICE
+            #error "Add custom non-secure application NVM erase and NVM write calls"
         #else
-            #if defined COMPONENT_CAT1B && defined COMPONENT_NON_SECURE_DEVICE
-                #error "Add custom non-secure application NVM erase and NVM write calls"
-            #else
-                uint32_t int_status = mtb_hal_system_critical_section_enter();
-                fstatus = mtb_hal_nvm_write(&nvm_obj, address, (uint32_t*)params->dataBuffer);
-                mtb_hal_system_critical_section_exit(int_status);
-                if(fstatus != CY_RSLT_SUCCESS)
-                {
-                    status = CY_DFU_ERROR_DATA;
-                    CY_DFU_LOG_ERR("NVM write failed: fstatus 0x%X ", (unsigned int)fstatus);
-                }
-            #endif /* defined COMPONENT_CAT1B && defined COMPONENT_NON_SECURE_DEVICE */
-        #endif /* CY_IP_M7CPUSS */
+            CY_UNUSED_PARAMETER(range);
+            CY_UNUSED_PARAMETER(end);
+        #if (DFU_NVM_PRE_ERASE != 0u)
+            NvmEraseAhead(address);
+        #endif /* DFU_NVM_PRE_ERASE */
+            uint32_t int_status = NvmCriticalEnter(address);
+            blank = NvmRowTake(address);
+            if (blank)
+            {
+                /* Erased ahead by dfu_nvm_pre_erase_run() */
+                fstatus = mtb_hal_nvm_program(&nvm_obj, address, (const uint32_t*)data);
+            }
+            else
+            {
+                fstatus = mtb_hal_nvm_write(&nvm_obj, address, (const uint32_t*)data);
+            }
+            NvmCriticalExit(int_status);
+            if(fstatus != CY_RSLT_SUCCESS)
+            {
+                status = CY_DFU_ERROR_DATA;
+                CY_DFU_LOG_ERR("NVM write failed: fstatus 0x%X ", (unsigned int)fstatus);
+            }
+        #if (DFU_NVM_JOURNAL != 0u)
+            else
+            {
+                NvmJournalRowDone(address);
+            }
+        #endif /* DFU_NVM_JOURNAL */
+        #endif /* defined COMPONENT_CAT1B && defined COMPONENT_NON_SECURE_DEVICE */
+    #endif /* DFU_NVM_ASYNC */
+
+    #if defined(MCUBOOT_IMAGE)
+        if (status == CY_DFU_SUCCESS)
+        {
+            /* Hash the row while it is still in RAM, and in flight to the flash */
+            img_hash_stream_update(address, row, CY_NVM_SIZEOF_ROW);
+
+            /* Report bad sectors as soon as they are known, so only those are sent again */
+            if (img_sector_update(address, row, CY_NVM_SIZEOF_ROW) != 0)
+            {
+                status = CY_DFU_ERROR_VERIFY;
+                CY_DFU_LOG_ERR("Image sector hash mismatch, bad sectors 0x%08X", (unsigned int)img_sector_bad_map());
+            }
+        }
+    #else
+        CY_UNUSED_PARAMETER(row);
+    #endif /* MCUBOOT_IMAGE */
+
+    return status;
+}
+
+
+/*******************************************************************************
+* Function Name: WriteRows
+****************************************************************************//**
+*
+* Internal function to check and write the contiguous rows of a
+* Cy_DFU_WriteData() request or of a windowed data packet.
+*
+* \param address    The address of the first row.
+* \param length     The length of the rows, 0 for an erase.
+* \param data       The rows.
+* \param ctl        The CY_DFU_IOCTL_* flags of the request.
+* \param access     DFU_NVM_RANGE_WRITE, or DFU_NVM_RANGE_META for the metadata
+*                   row.
+* \param params     The DFU parameters, NULL outside of the DFU middleware:
+*                   a golden image is not written then.
+*
+* \return CY_DFU_SUCCESS - the rows are programmed or are programming
+*
+*******************************************************************************/
+static cy_en_dfu_status_t WriteRows(uint32_t address, uint32_t length, const uint8_t data[], uint32_t ctl,
+                                    uint32_t access, cy_stc_dfu_params_t *params)
+{
+    cy_en_dfu_status_t status = CY_DFU_SUCCESS;
+    const dfu_nvm_range_t *range;
+    uint32_t rows = ((ctl & CY_DFU_IOCTL_ERASE) != 0U) ? 1U : (length / CY_NVM_SIZEOF_ROW);
+
+    /* Check if the address is inside the valid range.
+     * The running application is not writable in the basic flow. */
+    if(!AddressValid(address, access, &range))
+    {
+        status = CY_DFU_ERROR_ADDRESS;
+    }
+    /* All rows must lie in the same range */
+    else if (((rows * CY_NVM_SIZEOF_ROW) - 1U) > (range->last - address))
+    {
+        status = CY_DFU_ERROR_ADDRESS;
+    }
+    else
+    {
+        /* Valid address */
+    }
+
+    /* Check if the length is valid: whole rows that fit the data buffer
+     * Note Length = 0 is valid for erase command */
+    if ( (IsMultipleOf(address, CY_NVM_SIZEOF_ROW) == false) ||
+         ( ( (rows == 0U) || (IsMultipleOf(length, CY_NVM_SIZEOF_ROW) == false) ||
+             (length > CY_DFU_SIZEOF_DATA_BUFFER) ) && ( (ctl & CY_DFU_IOCTL_ERASE) == 0U) ) )
+    {
+        status = CY_DFU_ERROR_LENGTH;
+    }
+
+#if (CY_DFU_FLOW == CY_DFU_BASIC_FLOW) && CY_DFU_OPT_GOLDEN_IMAGE
+    /* A golden image can only be overwritten while it is invalid */
+    if ((status == CY_DFU_SUCCESS) && ((range->flags & DFU_NVM_RANGE_GOLDEN) != 0U))
+    {
+        status = (params != NULL) ? Cy_DFU_ValidateApp(range->app, params) : CY_DFU_SUCCESS;
+        status = (status == CY_DFU_SUCCESS) ? CY_DFU_ERROR_ADDRESS : CY_DFU_SUCCESS;
+    }
+#else
+    CY_UNUSED_PARAMETER(params);
+#endif /* (CY_DFU_FLOW == CY_DFU_BASIC_FLOW) && CY_DFU_OPT_GOLDEN_IMAGE */
+
+    /* Contiguous rows of one request are written in order */
+    for (uint32_t idx = 0U; (idx < rows) && (status == CY_DFU_SUCCESS); idx++)
+    {
+        status = WriteRow(address + (idx * CY_NVM_SIZEOF_ROW), address + (rows * CY_NVM_SIZEOF_ROW),
+                          &data[idx * CY_NVM_SIZEOF_ROW], range);
     }
 
     if (CY_DFU_SUCCESS != status)
@@ -341,6 +2687,54 @@ cy_en_dfu_status_t Cy_DFU_WriteData (uint32_t address, uint32_t length, uint32_t
 }
 
 
+/*******************************************************************************
+* Function Name: Cy_DFU_WriteData
+****************************************************************************//**
+*
+* This function documentation is part of the DFU SDK API, see the
+* cy_dfu.h file or DFU SDK API Reference Manual for details.
+*
+*******************************************************************************/
+cy_en_dfu_status_t Cy_DFU_WriteData (uint32_t address, uint32_t length, uint32_t ctl,
+                                               cy_stc_dfu_params_t *params)
+{
+    if ((ctl & CY_DFU_IOCTL_ERASE) != 0U)
+    {
+        /* An erase writes a row of zeros */
+        (void) memset(params->dataBuffer, 0, CY_NVM_SIZEOF_ROW);
+    }
+
+    return WriteRows(address, length, params->dataBuffer, ctl, DFU_NVM_RANGE_WRITE, params);
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_nvm_meta_write
+****************************************************************************//**
+*
+* Write the image metadata row of the slot, see dfu_nvm.h.
+*
+*******************************************************************************/
+cy_en_dfu_status_t dfu_nvm_meta_write(uint32_t address, const uint8_t row[])
+{
+    cy_en_dfu_status_t status = CY_DFU_ERROR_ADDRESS;
+
+    if (address == FLASH_ADDR(IMAGE_META_OFFSET))
+    {
+        status = WriteRows(address, CY_NVM_SIZEOF_ROW, row, 0U,
+                           (DFU_NVM_META_LOCKED != 0u) ? DFU_NVM_RANGE_META : DFU_NVM_RANGE_WRITE, NULL);
+    }
+
+    /* The caller reuses the row */
+    if (status == CY_DFU_SUCCESS)
+    {
+        status = dfu_nvm_flush();
+    }
+
+    return status;
+}
+
+
 /*******************************************************************************
 * Function Name: Cy_DFU_ReadData
 ****************************************************************************//**
@@ -354,6 +2748,11 @@ cy_en_dfu_status_t Cy_DFU_ReadData (uint32_t address, uint32_t length, uint32_t
 {
     cy_en_dfu_status_t status = CY_DFU_SUCCESS;
 
+#if (DFU_NVM_ASYNC != 0u)
+    /* Rows still programming would read back stale */
+    (void) NvmWait();
+#endif /* DFU_NVM_ASYNC */
+
     /* Check if the length is valid */
     if (IsMultipleOf(length, CY_NVM_SIZEOF_ROW) == 0U)
     {
@@ -361,11 +2760,19 @@ cy_en_dfu_status_t Cy_DFU_ReadData (uint32_t address, uint32_t length, uint32_t
     }
 
     /* Check if the address is inside the valid range */
-    if(!AddressValid(address, params))
+    if(!AddressValid(address, DFU_NVM_RANGE_READ, NULL))
     {
         status = CY_DFU_ERROR_ADDRESS;
     }
 
+#if (DFU_NVM_ASYNC != 0u)
+    /* Only the row that failed in the background fails, the host finds it with a compare */
+    if ((status == CY_DFU_SUCCESS) && nvm_failed && ((nvm_failed_addr - address) < length))
+    {
+        status = CY_DFU_ERROR_DATA;
+    }
+#endif /* DFU_NVM_ASYNC */
+
     /* Read or Compare */
     if (status == CY_DFU_SUCCESS)
     {
@@ -381,7 +2788,7 @@ cy_en_dfu_status_t Cy_DFU_ReadData (uint32_t address, uint32_t length, uint32_t
         }
         else
         {
-            status = ( memcmp(params->dataBuffer, (const void *)address, length) == 0 )
+            status = ( memcmp(params->dataBuffer, (const void *)(uintptr_t)address, length) == 0 )
                     ? CY_DFU_SUCCESS : CY_DFU_ERROR_VERIFY;
         }
     }
@@ -389,104 +2796,397 @@ cy_en_dfu_status_t Cy_DFU_ReadData (uint32_t address, uint32_t length, uint32_t
 }
 
 
+#if (DFU_TRANSPORT_DIRECT == 0u)
 /*******************************************************************************
-* Function Name: Cy_DFU_TransportStart
-****************************************************************************//**
+* Function Name: TransportNoneControl
+********************************************************************************
+* Summary:
+*  Start, stop and reset of transport_none: nothing to do.
 *
-* This function documentation is part of the DFU SDK API, see the
-* cy_dfu.h file or DFU SDK API Reference Manual for details.
+*******************************************************************************/
+static void TransportNoneControl(void)
+{
+}
+
+
+/*******************************************************************************
+* Function Name: TransportNoneData
+********************************************************************************
+* Summary:
+*  Read and write of transport_none: no data moves.
+*
+* Return:
+*  CY_DFU_ERROR_UNKNOWN
 *
 *******************************************************************************/
-void Cy_DFU_TransportStart(cy_en_dfu_transport_t transport)
+static cy_en_dfu_status_t TransportNoneData(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout)
+{
+    CY_UNUSED_PARAMETER(buffer);
+    CY_UNUSED_PARAMETER(size);
+    CY_UNUSED_PARAMETER(count);
+    CY_UNUSED_PARAMETER(timeout);
+
+    return CY_DFU_ERROR_UNKNOWN;
+}
+
+
+/*******************************************************************************
+* Function Name: TransportSelect
+********************************************************************************
+* Summary:
+*  Looks up the operations of a transport: a registered transport first, then
+*  the transports built with COMPONENT_DFU_*.
+*
+* Parameters:
+*  transport - Transport ID passed to Cy_DFU_TransportStart()
+*
+* Return:
+*  Transport operations, transport_none for a transport that is not built
+*
+*******************************************************************************/
+static const dfu_transport_t *TransportSelect(cy_en_dfu_transport_t transport)
 {
-    selectedInterface = transport;
+    const dfu_transport_t *ops = &transport_none;
 
+#if (DFU_TRANSPORT_REGISTER != 0u)
+    if ((transport_registered != NULL) && (transport == transport_registered_id))
+    {
+        ops = transport_registered;
+    }
+    else
+#endif /* DFU_TRANSPORT_REGISTER */
+    {
+        switch (transport)
+        {
+        #ifdef COMPONENT_DFU_I2C
+            case CY_DFU_I2C:
+                ops = &transport_i2c;
+                break;
+        #endif /* COMPONENT_DFU_I2C */
+
+        #ifdef COMPONENT_DFU_UART
+            case CY_DFU_UART:
+                ops = &transport_uart;
+                break;
+        #endif /* COMPONENT_DFU_UART */
+        #ifdef COMPONENT_DFU_SPI
+            case CY_DFU_SPI:
+                ops = &transport_spi;
+                break;
+        #endif /* COMPONENT_DFU_SPI */
+        #ifdef COMPONENT_DFU_CANFD
+            case CY_DFU_CANFD:
+                ops = &transport_canfd;
+                break;
+        #endif /* COMPONENT_DFU_CANFD */
+
+            default:
+                /* Selected interface in not applicable */
+                CY_ASSERT(false);
+                break;
+        }
+    }
+
+    return ops;
+}
+#endif /* DFU_TRANSPORT_DIRECT */
+
+
+#if (DFU_TRANSPORT_REGISTER != 0u)
+/*******************************************************************************
+* Function Name: dfu_transport_register
+********************************************************************************
+* Summary:
+*  Registers a transport for a transport ID, see dfu_transport.h.
+*
+* Parameters:
+*  id - Transport ID passed to Cy_DFU_TransportStart()
+*  transport - Transport operations, NULL restores the built-in transports
+*
+*******************************************************************************/
+void dfu_transport_register(cy_en_dfu_transport_t id, const dfu_transport_t *transport)
+{
+    transport_registered_id = id;
+    transport_registered = transport;
+}
+#endif /* DFU_TRANSPORT_REGISTER */
+
+
+/*******************************************************************************
+* Function Name: TransportPrepare
+********************************************************************************
+* Summary:
+*  Sets up the NVM for a session, ahead of starting the transports.
+*
+*******************************************************************************/
+static void TransportPrepare(void)
+{
 #if defined COMPONENT_CAT1B && defined COMPONENT_NON_SECURE_DEVICE
     #error "Add custom non-secure application NVM initialization call"
 #endif /* defined COMPONENT_CAT1B && defined COMPONENT_NON_SECURE_DEVICE */
 
 #ifdef CY_IP_M7CPUSS
-    mtb_hal_nvm_info_t nvm_info;
     /* Enable code flash write function */
     Cy_Flashc_MainWriteEnable();
-
-    /* Get NVM characteristics */
-    ntb_hal_nvm_get_info(&nvm_obj, &nvm_info);
-    blocks_info = nvm_info.regions;
-    blocks_count = nvm_info.region_count;
 #endif
 
-    switch (transport)
+    /* The layout is fixed for the session, look addresses up in a table */
+    NvmRangesBuild();
+
+#if (DFU_NVM_IRQ_PROBE != 0u)
+    /* Start the cycle counter for the interrupt mask measurement */
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    nvm_irq_masked_max = 0U;
+#endif /* DFU_NVM_IRQ_PROBE */
+}
+
+
+#if (DFU_TRANSPORT_LISTEN != 0u)
+/*******************************************************************************
+* Function Name: PacketValid
+********************************************************************************
+* Summary:
+*  Checks the framing and checksum of a received DFU packet.
+*
+* Parameters:
+*  packet - The received packet
+*  count - The number of received bytes
+*
+* Return:
+*  True when the packet is a whole DFU packet
+*
+*******************************************************************************/
+static bool PacketValid(const uint8_t packet[], uint32_t count)
+{
+    uint32_t length;
+
+    if ((count < DFU_PACKET_OVERHEAD) || (packet[0] != DFU_PACKET_SOP))
     {
-    #ifdef COMPONENT_DFU_I2C
-        case CY_DFU_I2C:
-            I2C_I2cCyBtldrCommStart();
-            break;
-    #endif /* COMPONENT_DFU_I2C */
+        return false;
+    }
 
-    #ifdef COMPONENT_DFU_UART
-        case CY_DFU_UART:
-            UART_UartCyBtldrCommStart();
-            break;
-    #endif /* COMPONENT_DFU_UART */
-    #ifdef COMPONENT_DFU_SPI
-        case CY_DFU_SPI:
-            SPI_SpiCyBtldrCommStart();
-            break;
-    #endif /* COMPONENT_DFU_EMUSB_HID */
-    #ifdef COMPONENT_DFU_CANFD
-        case CY_DFU_CANFD:
-            CANFD_CanfdCyBtldrCommStart();
-            break;
-    #endif /* COMPONENT_DFU_CANFD */
+    length = (uint32_t)packet[2] | ((uint32_t)packet[3] << 8U);
 
-        default:
-            /* Selected interface in not applicable */
-            CY_ASSERT(false);
-            break;
+    return (count >= (length + DFU_PACKET_OVERHEAD)) &&
+           (packet[length + 6U] == DFU_PACKET_EOP) &&
+           (PacketChecksum(packet, length + 4U) ==
+            (uint16_t)((uint32_t)packet[length + 4U] | ((uint32_t)packet[length + 5U] << 8U)));
+}
+
+
+/*******************************************************************************
+* Function Name: TransportListenStop
+********************************************************************************
+* Summary:
+*  Stop of transport_listen: stops all transports listened on.
+*
+*******************************************************************************/
+static void TransportListenStop(void)
+{
+    for (uint32_t idx = 0U; idx < transport_listen_count; idx++)
+    {
+        transport_listen_set[idx].ops->stop();
     }
 }
 
 
 /*******************************************************************************
-* Function Name: Cy_DFU_TransportStop
+* Function Name: TransportListenReset
+********************************************************************************
+* Summary:
+*  Reset of transport_listen: resets all transports listened on.
+*
+*******************************************************************************/
+static void TransportListenReset(void)
+{
+    for (uint32_t idx = 0U; idx < transport_listen_count; idx++)
+    {
+        transport_listen_set[idx].ops->reset();
+    }
+}
+
+
+/*******************************************************************************
+* Function Name: TransportListenRead
+********************************************************************************
+* Summary:
+*  Read of transport_listen: reads each transport in turn, skipping those
+*  whose pending() reports nothing. The first one to receive a valid packet
+*  becomes the active transport and the others are stopped, so later reads
+*  go to it alone.
+*
+* Parameters:
+*  buffer - The buffer for the packet
+*  size - The size of the buffer
+*  count - The number of bytes received
+*  timeout - Spread over passes of DFU_TRANSPORT_LISTEN_SLICE_MS per transport
+*
+* Return:
+*  CY_DFU_SUCCESS - a transport locked, buffer holds its packet
+*  CY_DFU_ERROR_TIMEOUT - no valid packet on any transport
+*
+*******************************************************************************/
+static cy_en_dfu_status_t TransportListenRead(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout)
+{
+    uint32_t passes = timeout / (DFU_TRANSPORT_LISTEN_SLICE_MS * transport_listen_count);
+
+    *count = 0U;
+
+    for (uint32_t idx = 0U; idx < (transport_listen_count * ((passes > 0U) ? passes : 1U)); idx++)
+    {
+        const dfu_transport_t *ops = transport_listen_set[idx % transport_listen_count].ops;
+        uint32_t received = 0U;
+
+        if (((ops->pending == NULL) || ops->pending()) &&
+            (ops->read(buffer, size, &received, DFU_TRANSPORT_LISTEN_SLICE_MS) == CY_DFU_SUCCESS) &&
+            PacketValid(buffer, received))
+        {
+            for (uint32_t other = 0U; other < transport_listen_count; other++)
+            {
+                if (transport_listen_set[other].ops != ops)
+                {
+                    transport_listen_set[other].ops->stop();
+                }
+            }
+
+            transport_locked_id = transport_listen_set[idx % transport_listen_count].id;
+            transport_locked = true;
+            transport_active = ops;
+            *count = received;
+
+            return CY_DFU_SUCCESS;
+        }
+    }
+
+    return CY_DFU_ERROR_TIMEOUT;
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_transport_listen
+********************************************************************************
+* Summary:
+*  Starts all transports and listens on them, see dfu_transport.h.
+*
+*******************************************************************************/
+void dfu_transport_listen(void)
+{
+#if (DFU_TRANSPORT_REGISTER != 0u)
+    bool registered = false;
+#endif /* DFU_TRANSPORT_REGISTER */
+
+    /* Releases the locked transport, or all of them when still listening */
+    transport_active->stop();
+
+    TransportPrepare();
+
+    transport_listen_count = 0U;
+#if (DFU_TRANSPORT_COUNT > 0u)
+    for (uint32_t idx = 0U; idx < DFU_TRANSPORT_COUNT; idx++)
+    {
+        /* TransportSelect() gives a registered transport for a built-in ID */
+        transport_listen_set[transport_listen_count].id = transport_builtin_ids[idx];
+        transport_listen_set[transport_listen_count].ops = TransportSelect(transport_builtin_ids[idx]);
+        transport_listen_count++;
+    #if (DFU_TRANSPORT_REGISTER != 0u)
+        registered = registered || (transport_builtin_ids[idx] == transport_registered_id);
+    #endif /* DFU_TRANSPORT_REGISTER */
+    }
+#endif /* DFU_TRANSPORT_COUNT > 0u */
+
+#if (DFU_TRANSPORT_REGISTER != 0u)
+    if ((transport_registered != NULL) && !registered)
+    {
+        transport_listen_set[transport_listen_count].id = transport_registered_id;
+        transport_listen_set[transport_listen_count].ops = transport_registered;
+        transport_listen_count++;
+    }
+#endif /* DFU_TRANSPORT_REGISTER */
+
+    for (uint32_t idx = 0U; idx < transport_listen_count; idx++)
+    {
+        transport_listen_set[idx].ops->start();
+    }
+
+    transport_locked = false;
+    transport_active = &transport_listen;
+}
+
+
+/*******************************************************************************
+* Function Name: dfu_transport_locked
+********************************************************************************
+* Summary:
+*  Gets the transport the DFU locked onto, see dfu_transport.h.
+*
+* Parameters:
+*  id - The ID of the transport, set when locked
+*
+* Return:
+*  True when a transport received the first valid packet
+*
+*******************************************************************************/
+bool dfu_transport_locked(cy_en_dfu_transport_t *id)
+{
+    if (transport_locked)
+    {
+        *id = transport_locked_id;
+    }
+
+    return transport_locked;
+}
+#endif /* DFU_TRANSPORT_LISTEN */
+
+
+/*******************************************************************************
+* Function Name: Cy_DFU_TransportStart
 ****************************************************************************//**
 *
 * This function documentation is part of the DFU SDK API, see the
 * cy_dfu.h file or DFU SDK API Reference Manual for details.
 *
 *******************************************************************************/
-void Cy_DFU_TransportStop(void)
+void Cy_DFU_TransportStart(cy_en_dfu_transport_t transport)
 {
-    switch (selectedInterface)
+    TransportPrepare();
+
+#if (DFU_TRANSPORT_DIRECT != 0u)
+    /* The only transport built */
+    CY_ASSERT(transport == DFU_TRANSPORT_ID);
+    CY_UNUSED_PARAMETER(transport);
+    DFU_TRANSPORT_FN(Start)();
+#else
+    /* Selected once, the other transport functions call it through the table */
+#if (DFU_TRANSPORT_LISTEN != 0u)
+    if (transport_active == &transport_listen)
     {
-    #ifdef COMPONENT_DFU_I2C
-        case CY_DFU_I2C:
-            I2C_I2cCyBtldrCommStop();
-            break;
-    #endif /* COMPONENT_DFU_I2C */
+        /* Ends listening on the other transports */
+        transport_active->stop();
+    }
+    transport_locked = false;
+#endif /* DFU_TRANSPORT_LISTEN */
+    transport_active = TransportSelect(transport);
+    transport_active->start();
+#endif /* DFU_TRANSPORT_DIRECT */
+}
 
-    #ifdef COMPONENT_DFU_UART
-        case CY_DFU_UART:
-            UART_UartCyBtldrCommStop();
-            break;
-    #endif /* COMPONENT_DFU_UART */
-    #ifdef COMPONENT_DFU_SPI
-        case CY_DFU_SPI:
-            SPI_SpiCyBtldrCommStop();
-            break;
-    #endif /* COMPONENT_DFU_SPI */
-    #ifdef COMPONENT_DFU_CANFD
-        case CY_DFU_CANFD:
-            CANFD_CanfdCyBtldrCommStop();
-            break;
-    #endif /* COMPONENT_DFU_CANFD */
 
-        default:
-            /* Selected interface in not applicable */
-            CY_ASSERT(false);
-            break;
-    }
+/*******************************************************************************
+* Function Name: Cy_DFU_TransportStop
+****************************************************************************//**
+*
+* This function documentation is part of the DFU SDK API, see the
+* cy_dfu.h file or DFU SDK API Reference Manual for details.
+*
+*******************************************************************************/
+void Cy_DFU_TransportStop(void)
+{
+#if (DFU_TRANSPORT_DIRECT != 0u)
+    DFU_TRANSPORT_FN(Stop)();
+#else
+    transport_active->stop();
+#endif /* DFU_TRANSPORT_DIRECT */
 }
 
 
@@ -500,35 +3200,27 @@ void Cy_DFU_TransportStop(void)
 *******************************************************************************/
 void Cy_DFU_TransportReset(void)
 {
-    switch (selectedInterface)
-    {
-    #ifdef COMPONENT_DFU_I2C
-        case CY_DFU_I2C:
-            I2C_I2cCyBtldrCommReset();
-            break;
-    #endif /* COMPONENT_DFU_I2C */
+#if (DFU_TRANSPORT_DIRECT != 0u)
+    DFU_TRANSPORT_FN(Reset)();
+#else
+    transport_active->reset();
+#endif /* DFU_TRANSPORT_DIRECT */
+}
 
-    #ifdef COMPONENT_DFU_UART
-        case CY_DFU_UART:
-            UART_UartCyBtldrCommReset();
-            break;
-    #endif /* COMPONENT_DFU_UART */
-    #ifdef COMPONENT_DFU_SPI
-        case CY_DFU_SPI:
-            SPI_SpiCyBtldrCommReset();
-            break;
-    #endif /* COMPONENT_DFU_EMUSB_HID */
-    #ifdef COMPONENT_DFU_CANFD
-        case CY_DFU_CANFD:
-            CANFD_CanfdCyBtldrCommReset();
-            break;
-    #endif /* COMPONENT_DFU_CANFD */
 
-        default:
-            /* Selected interface in not applicable */
-            CY_ASSERT(false);
-            break;
-    }
+/*******************************************************************************
+* Function Name: dfu_transport_read_limit
+********************************************************************************
+* Summary:
+*  Caps the read timeout of Cy_DFU_TransportRead(), see dfu_transport.h.
+*
+* Parameters:
+*  timeout - Longest read timeout in milliseconds, 0 for none
+*
+*******************************************************************************/
+void dfu_transport_read_limit(uint32_t timeout)
+{
+    transport_read_limit = timeout;
 }
 
 
@@ -542,37 +3234,57 @@ void Cy_DFU_TransportReset(void)
 *******************************************************************************/
 cy_en_dfu_status_t Cy_DFU_TransportRead(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout)
 {
-    cy_en_dfu_status_t status = CY_DFU_ERROR_UNKNOWN;
+    /* Buffer the packet is received in */
+    uint8_t *packet = buffer;
 
-    switch (selectedInterface)
+#if (DFU_NVM_ASYNC != 0u) && (DFU_NVM_ZERO_COPY != 0u)
+    if (NvmRowIn(buffer, size))
     {
-    #ifdef COMPONENT_DFU_I2C
-        case CY_DFU_I2C:
-            status = I2C_I2cCyBtldrCommRead(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_I2C */
+    #if (DFU_APP_WINDOW != 0u)
+        if (size <= sizeof(nvm_packet_buf))
+        {
+            /* A windowed row programs from this buffer, receive into the other one meanwhile */
+            packet = nvm_packet_buf;
+        }
+        else
+    #endif /* DFU_APP_WINDOW */
+        {
+            (void) NvmWait();
+        }
+    }
+#endif /* (DFU_NVM_ASYNC != 0u) && (DFU_NVM_ZERO_COPY != 0u) */
 
-    #ifdef COMPONENT_DFU_UART
-        case CY_DFU_UART:
-            status = UART_UartCyBtldrCommRead(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_UART */
-    #ifdef COMPONENT_DFU_SPI
-        case CY_DFU_SPI:
-            status = SPI_SpiCyBtldrCommRead(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_EMUSB_HID */
-    #ifdef COMPONENT_DFU_CANFD
-        case CY_DFU_CANFD:
-            status = CANFD_CanfdCyBtldrCommRead(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_CANFD */
+    if ((transport_read_limit != 0U) && (timeout > transport_read_limit))
+    {
+        timeout = transport_read_limit;
+    }
 
-        default:
-            /* Selected interface in not applicable */
-            CY_ASSERT(false);
-            break;
+#if (DFU_TRANSPORT_DIRECT != 0u)
+    cy_en_dfu_status_t status = DFU_TRANSPORT_FN(Read)(packet, size, count, timeout);
+#else
+    cy_en_dfu_status_t status = transport_active->read(packet, size, count, timeout);
+#endif /* DFU_TRANSPORT_DIRECT */
+
+#if (DFU_APP_CMD_ENABLE != 0u)
+    if ((status == CY_DFU_SUCCESS) && AppCmdProcess(packet, *count))
+    {
+        /* Answered here, the middleware keeps waiting for its next command */
+        *count = 0U;
+        status = CY_DFU_ERROR_TIMEOUT;
+    }
+#endif /* DFU_APP_CMD_ENABLE */
+
+#if (DFU_NVM_ASYNC != 0u) && (DFU_NVM_ZERO_COPY != 0u)
+    if (status == CY_DFU_SUCCESS)
+    {
+        /* The packet is in, the middleware copies it over the row's buffer next */
+        (void) NvmWait();
+        if (packet != buffer)
+        {
+            (void) memcpy(buffer, packet, *count);
+        }
     }
+#endif /* (DFU_NVM_ASYNC != 0u) && (DFU_NVM_ZERO_COPY != 0u) */
 
     return status;
 }
@@ -588,39 +3300,11 @@ cy_en_dfu_status_t Cy_DFU_TransportRead(uint8_t buffer[], uint32_t size, uint32_
 *******************************************************************************/
 cy_en_dfu_status_t Cy_DFU_TransportWrite(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout)
 {
-    cy_en_dfu_status_t status = CY_DFU_ERROR_UNKNOWN;
-
-    switch (selectedInterface)
-    {
-    #ifdef COMPONENT_DFU_I2C
-        case CY_DFU_I2C:
-            status = I2C_I2cCyBtldrCommWrite(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_I2C */
-
-    #ifdef COMPONENT_DFU_UART
-        case CY_DFU_UART:
-            status = UART_UartCyBtldrCommWrite(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_UART */
-    #ifdef COMPONENT_DFU_SPI
-        case CY_DFU_SPI:
-            status = SPI_SpiCyBtldrCommWrite(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_SPI */
-    #ifdef COMPONENT_DFU_CANFD
-        case CY_DFU_CANFD:
-            status = CANFD_CanfdCyBtldrCommWrite(buffer, size, count, timeout);
-            break;
-    #endif /* COMPONENT_DFU_CANFD */
-
-        default:
-            /* Selected interface in not applicable */
-            CY_ASSERT(false);
-            break;
-    }
-
-    return status;
+#if (DFU_TRANSPORT_DIRECT != 0u)
+    return DFU_TRANSPORT_FN(Write)(buffer, size, count, timeout);
+#else
+    return transport_active->write(buffer, size, count, timeout);
+#endif /* DFU_TRANSPORT_DIRECT */
 }
 
 
@@ -0,0 +1,359 @@
+/*****************************************************************************
+ * File Name:   dfu_event_bench.c
+ *
+ * Description: Host benchmark of the main loop wake-up. A thread plays the
+ *              transport interrupt: it receives packets at random intervals
+ *              and signals DFU_EVENT_RX through dfu_event.c. The main thread
+ *              runs the loop of main.c in both modes and takes the packets:
+ *              polling, where the transport read checks for a packet every
+ *              millisecond for up to DFU_SESSION_TIMEOUT_MS and the loop
+ *              waits 1 ms per pass, and DFU_EVENT_LOOP, where the loop sleeps
+ *              in dfu_event_wait(). Prints the latency from the interrupt to
+ *              the loop and the CPU time of the loop as CSV on stdout. A
+ *              last pass checks dfu_event_wait() for lost wake-ups: each
+ *              packet is signalled as soon as the loop took the previous one,
+ *              and a packet not taken within BENCH_LOST_MS counts as lost, as
+ *              does the end of a pass the loop is not woken for.
+ *
+ *              Build:
+ *                gcc -O2 -pthread -DDFU_USER_HOST -I. -Ihost dfu_event.c \
+ *                    host/dfu_event_host.c host/dfu_event_bench.c -o dfu_event_bench
+ *
+ *              Usage:
+ *                dfu_event_bench [-n <packets>] [-i <us>]
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dfu_user_host.h"
+#include "dfu_event.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+/* Timeout of Cy_DFU_Continue() in main.c */
+#define BENCH_SESSION_TIMEOUT_MS    (20u)
+
+/* Set by the interrupt thread after its last packet */
+#define BENCH_EVENT_DONE            (DFU_EVENT_APP)
+
+#define BENCH_PACKETS_MAX           (100000u)
+
+/* A packet of the wake-up check not taken within this time was not woken for */
+#define BENCH_LOST_MS               (1000u)
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static uint64_t bench_now_ns(uint32_t clock);
+static void bench_spin_us(uint32_t us);
+static void *bench_isr(void *arg);
+static void *bench_isr_back_to_back(void *arg);
+static void bench_finish(void);
+static bool bench_take(void);
+static void bench_loop_poll(void);
+static void bench_loop_event(void);
+static int bench_ns_cmp(const void *a, const void *b);
+static void bench_run(const char *name, void *(*isr)(void *), void (*loop)(void));
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+static uint32_t bench_packets = 2000u;
+static uint32_t bench_interval_us = 2000u;
+
+/* Interrupt time of each packet, published by bench_received */
+static uint64_t bench_irq_ns[BENCH_PACKETS_MAX];
+static uint32_t bench_received;
+static bool bench_done;
+static bool bench_stopped;
+
+/* Packets taken by the loop, and the latency of each */
+static uint32_t bench_taken;
+static uint64_t bench_latency_ns[BENCH_PACKETS_MAX];
+static uint32_t bench_lost;
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static uint64_t bench_now_ns(uint32_t clock)
+{
+    struct timespec ts;
+
+    (void)clock_gettime((clockid_t)clock, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+/* Cy_SysLib_Delay() busy-waits */
+static void bench_spin_us(uint32_t us)
+{
+    uint64_t end = bench_now_ns(CLOCK_MONOTONIC) + ((uint64_t)us * 1000u);
+
+    while (bench_now_ns(CLOCK_MONOTONIC) < end)
+    {
+    }
+}
+
+/*******************************************************************************
+* Function Name: bench_isr
+********************************************************************************
+* Summary:
+*  The transport interrupt: a packet every 0.5 to 1.5 bench_interval_us, each
+*  time stamped and signalled as DFU_EVENT_RX.
+*
+*******************************************************************************/
+static void *bench_isr(void *arg)
+{
+    uint32_t seed = 1u;
+    uint32_t idx;
+
+    (void)arg;
+
+    for (idx = 0u; idx < bench_packets; idx++)
+    {
+        uint64_t us;
+        struct timespec ts;
+
+        seed = (seed * 1103515245u) + 12345u;
+        us = (bench_interval_us / 2u) + ((uint64_t)(seed >> 8u) % (bench_interval_us + 1u));
+        ts.tv_sec = (time_t)(us / 1000000u);
+        ts.tv_nsec = (long)((us % 1000000u) * 1000u);
+        (void)nanosleep(&ts, NULL);
+
+        bench_irq_ns[idx] = bench_now_ns(CLOCK_MONOTONIC);
+        __atomic_store_n(&bench_received, idx + 1u, __ATOMIC_RELEASE);
+        dfu_event_signal(DFU_EVENT_RX);
+    }
+
+    bench_finish();
+
+    return NULL;
+}
+
+/* The interrupt for the wake-up check: the next packet once the loop took this one */
+static void *bench_isr_back_to_back(void *arg)
+{
+    uint32_t idx;
+
+    (void)arg;
+
+    for (idx = 0u; idx < bench_packets; idx++)
+    {
+        uint64_t lost_ns;
+
+        bench_irq_ns[idx] = bench_now_ns(CLOCK_MONOTONIC);
+        __atomic_store_n(&bench_received, idx + 1u, __ATOMIC_RELEASE);
+        dfu_event_signal(DFU_EVENT_RX);
+
+        lost_ns = bench_irq_ns[idx] + ((uint64_t)BENCH_LOST_MS * 1000000u);
+        while (__atomic_load_n(&bench_taken, __ATOMIC_ACQUIRE) <= idx)
+        {
+            if (bench_now_ns(CLOCK_MONOTONIC) > lost_ns)
+            {
+                /* The next signal wakes the loop again */
+                bench_lost++;
+                break;
+            }
+        }
+    }
+
+    bench_finish();
+
+    return NULL;
+}
+
+/* Signals the end until the loop stops, a signal it is not woken for counts as lost */
+static void bench_finish(void)
+{
+    __atomic_store_n(&bench_done, true, __ATOMIC_RELEASE);
+
+    while (!__atomic_load_n(&bench_stopped, __ATOMIC_ACQUIRE))
+    {
+        uint64_t lost_ns = bench_now_ns(CLOCK_MONOTONIC) + ((uint64_t)BENCH_LOST_MS * 1000000u);
+
+        dfu_event_signal(BENCH_EVENT_DONE);
+        while (!__atomic_load_n(&bench_stopped, __ATOMIC_ACQUIRE))
+        {
+            if (bench_now_ns(CLOCK_MONOTONIC) > lost_ns)
+            {
+                bench_lost++;
+                break;
+            }
+        }
+    }
+}
+
+/* Takes the packets received so far, as one Cy_DFU_Continue() call */
+static bool bench_take(void)
+{
+    uint32_t received = __atomic_load_n(&bench_received, __ATOMIC_ACQUIRE);
+    uint64_t now = bench_now_ns(CLOCK_MONOTONIC);
+    bool taken = (bench_taken < received);
+
+    for (; bench_taken < received; __atomic_store_n(&bench_taken, bench_taken + 1u, __ATOMIC_RELEASE))
+    {
+        bench_latency_ns[bench_taken] = now - bench_irq_ns[bench_taken];
+    }
+
+    return taken;
+}
+
+/* main.c with DFU_EVENT_LOOP 0 */
+static void bench_loop_poll(void)
+{
+    while (!__atomic_load_n(&bench_done, __ATOMIC_ACQUIRE) || (bench_taken < bench_packets))
+    {
+        uint32_t ms;
+
+        /* Cy_DFU_Continue(): the transport read checks for a packet every millisecond */
+        for (ms = 0u; (ms < BENCH_SESSION_TIMEOUT_MS) && !bench_take(); ms++)
+        {
+            bench_spin_us(1000u);
+        }
+
+        /* Cy_SysLib_Delay(1) */
+        bench_spin_us(1000u);
+    }
+}
+
+/* main.c with DFU_EVENT_LOOP */
+static void bench_loop_event(void)
+{
+    uint32_t events = 0u;
+
+    while (((events & BENCH_EVENT_DONE) == 0u) || (bench_taken < bench_packets))
+    {
+        events |= dfu_event_wait(DFU_EVENT_RX | BENCH_EVENT_DONE);
+        (void)bench_take();
+    }
+}
+
+static int bench_ns_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*******************************************************************************
+* Function Name: bench_run
+********************************************************************************
+* Summary:
+*  Runs one loop against the interrupt thread and prints its CSV line.
+*
+*******************************************************************************/
+static void bench_run(const char *name, void *(*isr)(void *), void (*loop)(void))
+{
+    pthread_t thread;
+    uint64_t wall;
+    uint64_t cpu;
+
+    bench_received = 0u;
+    bench_done = false;
+    bench_stopped = false;
+    bench_taken = 0u;
+    bench_lost = 0u;
+    (void)dfu_event_take(DFU_EVENT_RX | BENCH_EVENT_DONE);
+
+    wall = bench_now_ns(CLOCK_MONOTONIC);
+    cpu = bench_now_ns(CLOCK_THREAD_CPUTIME_ID);
+    if (pthread_create(&thread, NULL, isr, NULL) != 0)
+    {
+        perror("pthread_create");
+        exit(1);
+    }
+    loop();
+    cpu = bench_now_ns(CLOCK_THREAD_CPUTIME_ID) - cpu;
+    wall = bench_now_ns(CLOCK_MONOTONIC) - wall;
+    __atomic_store_n(&bench_stopped, true, __ATOMIC_RELEASE);
+    (void)pthread_join(thread, NULL);
+
+    qsort(bench_latency_ns, bench_taken, sizeof(bench_latency_ns[0]), bench_ns_cmp);
+    printf("%s,%u,%u,%u,%.1f,%.1f,%.1f,%.1f\n", name, (unsigned int)bench_packets, (unsigned int)bench_taken,
+           (unsigned int)bench_lost,
+           (double)bench_latency_ns[bench_taken / 2u] / 1e3,
+           (double)bench_latency_ns[(bench_taken * 99u) / 100u] / 1e3,
+           (double)bench_latency_ns[bench_taken - 1u] / 1e3,
+           100.0 * (double)cpu / (double)wall);
+}
+
+int main(int argc, char *argv[])
+{
+    int arg;
+
+    for (arg = 1; (arg + 1) < argc; arg += 2)
+    {
+        if (strcmp(argv[arg], "-n") == 0)
+        {
+            bench_packets = (uint32_t)strtoul(argv[arg + 1], NULL, 0);
+        }
+        else if (strcmp(argv[arg], "-i") == 0)
+        {
+            bench_interval_us = (uint32_t)strtoul(argv[arg + 1], NULL, 0);
+        }
+        else
+        {
+            break;
+        }
+    }
+    if ((arg != argc) || (bench_packets == 0u) || (bench_packets > BENCH_PACKETS_MAX) || (bench_interval_us == 0u))
+    {
+        fprintf(stderr, "usage: %s [-n <packets>] [-i <us>]\n"
+                        "  -n  Packets, at most %u (default 2000)\n"
+                        "  -i  Mean interval between packets (default 2000)\n",
+                argv[0], (unsigned int)BENCH_PACKETS_MAX);
+        return 2;
+    }
+
+    printf("loop,packets,taken,lost,latency_median_us,latency_p99_us,latency_max_us,cpu_pct\n");
+    bench_run("poll", bench_isr, bench_loop_poll);
+    bench_run("event", bench_isr, bench_loop_event);
+    bench_run("event_back_to_back", bench_isr_back_to_back, bench_loop_event);
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,87 @@
+/*****************************************************************************
+ * File Name:   dfu_event_host.c
+ *
+ * Description: This file provides the interrupt masking and sleep of
+ *              dfu_event.c for host (Linux) builds with DFU_USER_HOST. The
+ *              interrupt handlers are threads that call dfu_event_signal():
+ *              masking interrupts holds a mutex they need, and the sleep of
+ *              the CPU waits on a condition they signal, releasing the mutex
+ *              as WFI lets a pending interrupt end it with interrupts masked.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <pthread.h>
+#include "dfu_user_host.h"
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+/* Held while interrupts are masked */
+static pthread_mutex_t event_host_mask = PTHREAD_MUTEX_INITIALIZER;
+
+/* Raised by an interrupt, ends the sleep */
+static pthread_cond_t event_host_irq = PTHREAD_COND_INITIALIZER;
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+uint32_t dfu_event_host_enter(void)
+{
+    (void)pthread_mutex_lock(&event_host_mask);
+    return 0u;
+}
+
+void dfu_event_host_exit(uint32_t state)
+{
+    (void)state;
+    (void)pthread_mutex_unlock(&event_host_mask);
+}
+
+void dfu_event_host_sleep(void)
+{
+    (void)pthread_cond_wait(&event_host_irq, &event_host_mask);
+}
+
+void dfu_event_host_wake(void)
+{
+    (void)pthread_cond_broadcast(&event_host_irq);
+}
+
+/* [] END OF FILE */
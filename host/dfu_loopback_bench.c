@@ -0,0 +1,627 @@
+/*****************************************************************************
+ * File Name:   dfu_loopback_bench.c
+ *
+ * Description: Host loopback benchmark of the DFU packet size. A host thread
+ *              sends a slot image to a device thread over a socket pair with
+ *              DFU send data / program data packets, for devices that buffer
+ *              1 to 16 rows per program data command. The host reads the
+ *              packet and write sizes with DFU_APP_CMD_GET_CAPS first, as a
+ *              real host would. Per packet size it prints the packets and
+ *              wire bytes needed, the measured loopback throughput and the
+ *              throughput projected for an I2C bus, as CSV on stdout.
+ *
+ *              Build:
+ *                gcc -O2 -pthread -I. host/dfu_loopback_bench.c crc32c.c \
+ *                    -o dfu_loopback_bench
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include "crc32c.h"
+#include "dfu_app_cmd.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+#define BENCH_ROW_SIZE              (512u)
+#define BENCH_SLOT_SIZE             (0x20000u)
+#define BENCH_SLOT_ADDR             (0x32800000u)
+
+/* DFU middleware commands and status */
+#define BENCH_CMD_ENTER             (0x38u)
+#define BENCH_CMD_SEND_DATA         (0x37u)
+#define BENCH_CMD_PROGRAM_DATA      (0x49u)
+#define BENCH_CMD_EXIT              (0x3Bu)
+#define BENCH_STATUS_SUCCESS        (0x00u)
+#define BENCH_STATUS_LENGTH         (0x03u)
+#define BENCH_STATUS_DATA           (0x04u)
+#define BENCH_STATUS_CMD            (0x05u)
+#define BENCH_STATUS_CHECKSUM       (0x08u)
+
+/* Program data command payload ahead of the data: address and CRC-32C */
+#define BENCH_PROGRAM_HEADER        (8u)
+
+/* Buffer sizes of the Makefile for DFU_WRITE_ROWS rows */
+#define BENCH_DATA_BUFFER(rows)     (((rows) * BENCH_ROW_SIZE) + 16u)
+#define BENCH_CMD_BUFFER(rows)      (((rows) * BENCH_ROW_SIZE) + 32u)
+
+#define BENCH_MAX_ROWS              (16u)
+
+/* I2C transaction: start, address byte, stop, in bit times */
+#define BENCH_I2C_FRAME_BITS        (11u)
+
+/* I2C byte on the wire: 8 data bits and the acknowledge bit */
+#define BENCH_I2C_BITS_PER_BYTE     (9u)
+
+/*******************************************************************************
+* Type Definitions
+*******************************************************************************/
+
+/* Device side of the loopback */
+struct bench_device
+{
+    int fd;
+    uint32_t rows;                  /* Rows per program data command */
+    uint8_t *flash;                 /* Slot image */
+    uint8_t *data;                  /* CY_DFU_SIZEOF_DATA_BUFFER */
+    uint32_t data_len;
+    uint32_t rows_written;
+    bool failed;
+};
+
+/* Host side counters of one run */
+struct bench_run
+{
+    uint32_t packets;
+    uint64_t tx_bytes;              /* Host to device */
+    uint64_t rx_bytes;              /* Device to host */
+    double usec;
+};
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static double now_usec(void);
+static uint16_t checksum(const uint8_t *data, uint32_t len);
+static bool read_full(int fd, uint8_t *buf, uint32_t len);
+static bool write_full(int fd, const uint8_t *buf, uint32_t len);
+static uint32_t packet_build(uint8_t *pkt, uint8_t cmd, const uint8_t *data, uint32_t len);
+static bool packet_read(int fd, uint8_t *pkt, uint32_t max, uint8_t *cmd, uint32_t *len);
+static void *device_thread(void *arg);
+static bool host_command(int fd, struct bench_run *run, uint8_t cmd, const uint8_t *data, uint32_t len,
+                         uint8_t *rsp, uint32_t *rsp_len);
+static bool host_download(int fd, const uint8_t *image, uint32_t host_packet_max, struct bench_run *run,
+                          uint32_t *write_rows);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static double now_usec(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
+
+static uint16_t checksum(const uint8_t *data, uint32_t len)
+{
+    uint16_t sum = 0u;
+    uint32_t idx;
+
+    for (idx = 0u; idx < len; idx++)
+    {
+        sum += data[idx];
+    }
+
+    return (uint16_t)(1u + (uint16_t)~sum);
+}
+
+static bool read_full(int fd, uint8_t *buf, uint32_t len)
+{
+    while (len > 0u)
+    {
+        ssize_t n = read(fd, buf, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= (uint32_t)n;
+    }
+
+    return true;
+}
+
+static bool write_full(int fd, const uint8_t *buf, uint32_t len)
+{
+    while (len > 0u)
+    {
+        ssize_t n = write(fd, buf, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        buf += n;
+        len -= (uint32_t)n;
+    }
+
+    return true;
+}
+
+/*******************************************************************************
+* Function Name: packet_build
+********************************************************************************
+* Summary:
+*  Frames a command or response: start, command or status, length, data,
+*  checksum, end.
+*
+* Return:
+*  Packet length in bytes
+*
+*******************************************************************************/
+static uint32_t packet_build(uint8_t *pkt, uint8_t cmd, const uint8_t *data, uint32_t len)
+{
+    uint16_t sum;
+
+    pkt[0] = DFU_PACKET_SOP;
+    pkt[1] = cmd;
+    pkt[2] = (uint8_t)len;
+    pkt[3] = (uint8_t)(len >> 8u);
+    if (len > 0u)
+    {
+        memcpy(&pkt[4], data, len);
+    }
+    sum = checksum(pkt, len + 4u);
+    pkt[len + 4u] = (uint8_t)sum;
+    pkt[len + 5u] = (uint8_t)(sum >> 8u);
+    pkt[len + 6u] = DFU_PACKET_EOP;
+
+    return len + DFU_PACKET_OVERHEAD;
+}
+
+/*******************************************************************************
+* Function Name: packet_read
+********************************************************************************
+* Summary:
+*  Reads one framed packet of at most max bytes and checks its framing.
+*
+* Return:
+*  false on a closed socket, a bad frame or a packet larger than max
+*
+*******************************************************************************/
+static bool packet_read(int fd, uint8_t *pkt, uint32_t max, uint8_t *cmd, uint32_t *len)
+{
+    uint32_t n;
+
+    if (!read_full(fd, pkt, 4u) || (pkt[0] != DFU_PACKET_SOP))
+    {
+        return false;
+    }
+
+    n = (uint32_t)pkt[2] | ((uint32_t)pkt[3] << 8u);
+    if (((n + DFU_PACKET_OVERHEAD) > max) || !read_full(fd, &pkt[4], n + 3u) ||
+        (pkt[n + 6u] != DFU_PACKET_EOP) ||
+        (checksum(pkt, n + 4u) != (uint16_t)((uint32_t)pkt[n + 4u] | ((uint32_t)pkt[n + 5u] << 8u))))
+    {
+        return false;
+    }
+
+    *cmd = pkt[1];
+    *len = n;
+    return true;
+}
+
+/*******************************************************************************
+* Function Name: device_thread
+********************************************************************************
+* Summary:
+*  Device side: a command buffer of CY_DFU_SIZEOF_CMD_BUFFER bytes, send data
+*  collects into the data buffer, program data checks the CRC-32C of the
+*  collected data and writes its rows to the slot image in one call, like
+*  Cy_DFU_WriteData() with contiguous rows.
+*
+*******************************************************************************/
+static void *device_thread(void *arg)
+{
+    struct bench_device *dev = (struct bench_device *)arg;
+    uint32_t cmd_max = BENCH_CMD_BUFFER(dev->rows);
+    uint32_t data_max = BENCH_DATA_BUFFER(dev->rows);
+    uint8_t *pkt = malloc(cmd_max);
+    uint8_t rsp[64];
+    uint8_t caps[8];
+    uint32_t write_max = (data_max / BENCH_ROW_SIZE) * BENCH_ROW_SIZE;
+    uint8_t cmd;
+    uint32_t len;
+
+    for (;;)
+    {
+        uint8_t status = BENCH_STATUS_SUCCESS;
+        uint32_t rsp_len = 0u;
+        const uint8_t *rsp_data = NULL;
+
+        if (!packet_read(dev->fd, pkt, cmd_max, &cmd, &len))
+        {
+            dev->failed = true;
+            break;
+        }
+
+        if (cmd == BENCH_CMD_EXIT)
+        {
+            break;
+        }
+        else if (cmd == BENCH_CMD_ENTER)
+        {
+            dev->data_len = 0u;
+        }
+        else if (cmd == DFU_APP_CMD_GET_CAPS)
+        {
+            caps[0] = DFU_APP_CAPS_VERSION;
+            caps[1] = DFU_APP_CAP_PIPELINE | DFU_APP_CAP_PRE_ERASE;
+            caps[2] = (uint8_t)BENCH_ROW_SIZE;
+            caps[3] = (uint8_t)(BENCH_ROW_SIZE >> 8u);
+            caps[4] = (uint8_t)cmd_max;
+            caps[5] = (uint8_t)(cmd_max >> 8u);
+            caps[6] = (uint8_t)write_max;
+            caps[7] = (uint8_t)(write_max >> 8u);
+            rsp_data = caps;
+            rsp_len = sizeof(caps);
+        }
+        else if (cmd == BENCH_CMD_SEND_DATA)
+        {
+            if ((dev->data_len + len) > data_max)
+            {
+                status = BENCH_STATUS_LENGTH;
+                dev->data_len = 0u;
+            }
+            else
+            {
+                memcpy(&dev->data[dev->data_len], &pkt[4], len);
+                dev->data_len += len;
+            }
+        }
+        else if ((cmd == BENCH_CMD_PROGRAM_DATA) && (len >= BENCH_PROGRAM_HEADER))
+        {
+            uint32_t addr = (uint32_t)pkt[4] | ((uint32_t)pkt[5] << 8u) | ((uint32_t)pkt[6] << 16u) |
+                            ((uint32_t)pkt[7] << 24u);
+            uint32_t crc = (uint32_t)pkt[8] | ((uint32_t)pkt[9] << 8u) | ((uint32_t)pkt[10] << 16u) |
+                           ((uint32_t)pkt[11] << 24u);
+            uint32_t chunk = len - BENCH_PROGRAM_HEADER;
+            uint32_t off = addr - BENCH_SLOT_ADDR;
+
+            if ((dev->data_len + chunk) > data_max)
+            {
+                status = BENCH_STATUS_LENGTH;
+            }
+            else
+            {
+                memcpy(&dev->data[dev->data_len], &pkt[12], chunk);
+                dev->data_len += chunk;
+
+                if (crc32c_update(0u, dev->data, dev->data_len) != crc)
+                {
+                    status = BENCH_STATUS_CHECKSUM;
+                }
+                else if (((dev->data_len % BENCH_ROW_SIZE) != 0u) || (dev->data_len == 0u) ||
+                         (addr < BENCH_SLOT_ADDR) || (off > (BENCH_SLOT_SIZE - dev->data_len)) ||
+                         ((off % BENCH_ROW_SIZE) != 0u))
+                {
+                    status = BENCH_STATUS_DATA;
+                }
+                else
+                {
+                    memcpy(&dev->flash[off], dev->data, dev->data_len);
+                    dev->rows_written += dev->data_len / BENCH_ROW_SIZE;
+                }
+            }
+            dev->data_len = 0u;
+        }
+        else
+        {
+            status = BENCH_STATUS_CMD;
+        }
+
+        len = packet_build(rsp, status, rsp_data, rsp_len);
+        if (!write_full(dev->fd, rsp, len))
+        {
+            dev->failed = true;
+            break;
+        }
+    }
+
+    free(pkt);
+    return NULL;
+}
+
+/*******************************************************************************
+* Function Name: host_command
+********************************************************************************
+* Summary:
+*  Sends one command and waits for its response.
+*
+* Return:
+*  true when the device answered with success
+*
+*******************************************************************************/
+static bool host_command(int fd, struct bench_run *run, uint8_t cmd, const uint8_t *data, uint32_t len,
+                         uint8_t *rsp, uint32_t *rsp_len)
+{
+    static uint8_t pkt[BENCH_CMD_BUFFER(BENCH_MAX_ROWS)];
+    uint8_t rbuf[64];
+    uint8_t status;
+    uint32_t n = packet_build(pkt, cmd, data, len);
+    uint32_t rlen;
+
+    run->packets++;
+    run->tx_bytes += n;
+    if (!write_full(fd, pkt, n) || !packet_read(fd, rbuf, sizeof(rbuf), &status, &rlen))
+    {
+        return false;
+    }
+    run->rx_bytes += rlen + DFU_PACKET_OVERHEAD;
+
+    if ((rsp != NULL) && (rsp_len != NULL))
+    {
+        memcpy(rsp, &rbuf[4], rlen);
+        *rsp_len = rlen;
+    }
+
+    return (status == BENCH_STATUS_SUCCESS);
+}
+
+/*******************************************************************************
+* Function Name: host_download
+********************************************************************************
+* Summary:
+*  Host side: reads the device capabilities, then sends the slot as program
+*  data commands of the largest write, each split into send data packets of
+*  the largest packet both sides handle.
+*
+* Return:
+*  true when every command succeeded
+*
+*******************************************************************************/
+static bool host_download(int fd, const uint8_t *image, uint32_t host_packet_max, struct bench_run *run,
+                          uint32_t *write_rows)
+{
+    static uint8_t payload[BENCH_CMD_BUFFER(BENCH_MAX_ROWS)];
+    uint8_t caps[64];
+    uint32_t caps_len = 0u;
+    uint32_t packet_max;
+    uint32_t write_max;
+    uint32_t off;
+    double start = now_usec();
+
+    if (!host_command(fd, run, BENCH_CMD_ENTER, NULL, 0u, NULL, NULL) ||
+        !host_command(fd, run, DFU_APP_CMD_GET_CAPS, NULL, 0u, caps, &caps_len) || (caps_len < 8u))
+    {
+        return false;
+    }
+
+    packet_max = (uint32_t)caps[4] | ((uint32_t)caps[5] << 8u);
+    write_max = (uint32_t)caps[6] | ((uint32_t)caps[7] << 8u);
+    if ((host_packet_max != 0u) && (host_packet_max < packet_max))
+    {
+        packet_max = host_packet_max;
+    }
+    if (packet_max > sizeof(payload))
+    {
+        packet_max = sizeof(payload);
+    }
+    *write_rows = write_max / BENCH_ROW_SIZE;
+
+    for (off = 0u; off < BENCH_SLOT_SIZE; off += write_max)
+    {
+        uint32_t len = ((BENCH_SLOT_SIZE - off) < write_max) ? (BENCH_SLOT_SIZE - off) : write_max;
+        uint32_t crc = crc32c_update(0u, &image[off], len);
+        uint32_t addr = BENCH_SLOT_ADDR + off;
+        uint32_t sent = 0u;
+
+        /* Send data until the rest fits a program data command */
+        while ((len - sent) > (packet_max - DFU_PACKET_OVERHEAD - BENCH_PROGRAM_HEADER))
+        {
+            uint32_t chunk = packet_max - DFU_PACKET_OVERHEAD;
+            if (chunk > (len - sent))
+            {
+                chunk = len - sent;
+            }
+            if (!host_command(fd, run, BENCH_CMD_SEND_DATA, &image[off + sent], chunk, NULL, NULL))
+            {
+                return false;
+            }
+            sent += chunk;
+        }
+
+        payload[0] = (uint8_t)addr;
+        payload[1] = (uint8_t)(addr >> 8u);
+        payload[2] = (uint8_t)(addr >> 16u);
+        payload[3] = (uint8_t)(addr >> 24u);
+        payload[4] = (uint8_t)crc;
+        payload[5] = (uint8_t)(crc >> 8u);
+        payload[6] = (uint8_t)(crc >> 16u);
+        payload[7] = (uint8_t)(crc >> 24u);
+        memcpy(&payload[BENCH_PROGRAM_HEADER], &image[off + sent], len - sent);
+        if (!host_command(fd, run, BENCH_CMD_PROGRAM_DATA, payload, BENCH_PROGRAM_HEADER + (len - sent),
+                          NULL, NULL))
+        {
+            return false;
+        }
+    }
+
+    run->usec = now_usec() - start;
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    static const uint32_t rows_list[] = { 1u, 2u, 4u, 8u, 16u };
+    uint8_t *image = malloc(BENCH_SLOT_SIZE);
+    double bitrate = 400000.0;
+    double turnaround = 200.0;
+    double program = 1000.0;
+    uint32_t host_packet_max = 0u;
+    uint32_t idx;
+    int arg;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((arg + 1) >= argc)
+        {
+            arg = argc;
+            break;
+        }
+        else if (strcmp(argv[arg], "-b") == 0)
+        {
+            bitrate = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-l") == 0)
+        {
+            turnaround = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-p") == 0)
+        {
+            program = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-m") == 0)
+        {
+            host_packet_max = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if ((arg < argc) || (image == NULL) || (bitrate <= 0.0) ||
+        ((host_packet_max != 0u) && (host_packet_max <= (DFU_PACKET_OVERHEAD + BENCH_PROGRAM_HEADER))))
+    {
+        fprintf(stderr, "usage: %s [-b <bit/s>] [-l <us>] [-p <us>] [-m <bytes>]\n"
+                        "  -b  I2C bit rate of the projection (default 400000)\n"
+                        "  -l  Host turnaround per packet (default 200)\n"
+                        "  -p  Row program time, pre-erased and pipelined (default 1000)\n"
+                        "  -m  Largest packet the host sends (default: the device limit)\n", argv[0]);
+        return 2;
+    }
+
+    for (idx = 0u; idx < BENCH_SLOT_SIZE; idx++)
+    {
+        image[idx] = (uint8_t)((idx * 13u) ^ (idx >> 9u));
+    }
+
+    printf("device_rows,write_rows,packet_max,packets,tx_bytes,rx_bytes,loopback_ms,loopback_mb_per_s,"
+           "bus_ms,bus_kb_per_s,projected_kb_per_s\n");
+
+    for (idx = 0u; idx < (sizeof(rows_list) / sizeof(rows_list[0])); idx++)
+    {
+        struct bench_device dev;
+        struct bench_run run;
+        pthread_t thread;
+        int fds[2];
+        uint32_t write_rows = 0u;
+        uint32_t packet_max;
+        double bus_us;
+        double flash_us;
+        bool ok;
+
+        memset(&dev, 0, sizeof(dev));
+        memset(&run, 0, sizeof(run));
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+        {
+            perror("socketpair");
+            return 1;
+        }
+
+        dev.fd = fds[1];
+        dev.rows = rows_list[idx];
+        dev.flash = calloc(1u, BENCH_SLOT_SIZE);
+        dev.data = malloc(BENCH_DATA_BUFFER(dev.rows));
+        (void)pthread_create(&thread, NULL, device_thread, &dev);
+
+        ok = host_download(fds[0], image, host_packet_max, &run, &write_rows);
+
+        (void)packet_build(dev.data, BENCH_CMD_EXIT, NULL, 0u);
+        (void)write_full(fds[0], dev.data, DFU_PACKET_OVERHEAD);
+        (void)pthread_join(thread, NULL);
+        (void)close(fds[0]);
+        (void)close(fds[1]);
+
+        if (!ok || dev.failed || (memcmp(dev.flash, image, BENCH_SLOT_SIZE) != 0))
+        {
+            fprintf(stderr, "download with %u device rows failed\n", (unsigned int)dev.rows);
+            return 1;
+        }
+
+        /* Each packet is an I2C write of the command and an I2C read of the response */
+        bus_us = ((((double)(run.tx_bytes + run.rx_bytes + (2u * run.packets)) * BENCH_I2C_BITS_PER_BYTE) +
+                   ((double)run.packets * 2.0 * BENCH_I2C_FRAME_BITS)) * 1e6 / bitrate) +
+                 ((double)run.packets * turnaround);
+        flash_us = (double)(BENCH_SLOT_SIZE / BENCH_ROW_SIZE) * program;
+
+        packet_max = BENCH_CMD_BUFFER(dev.rows);
+        if ((host_packet_max != 0u) && (host_packet_max < packet_max))
+        {
+            packet_max = host_packet_max;
+        }
+
+        printf("%u,%u,%u,%u,%llu,%llu,%.3f,%.1f,%.1f,%.2f,%.2f\n", (unsigned int)dev.rows,
+               (unsigned int)write_rows, (unsigned int)packet_max, (unsigned int)run.packets,
+               (unsigned long long)run.tx_bytes, (unsigned long long)run.rx_bytes, run.usec / 1000.0,
+               ((double)BENCH_SLOT_SIZE / 1048576.0) / (run.usec / 1e6), bus_us / 1000.0,
+               ((double)BENCH_SLOT_SIZE / 1024.0) / (bus_us / 1e6),
+               ((double)BENCH_SLOT_SIZE / 1024.0) / (((bus_us > flash_us) ? bus_us : flash_us) / 1e6));
+
+        free(dev.flash);
+        free(dev.data);
+    }
+
+    free(image);
+    return 0;
+}
+
+/* [] END OF FILE */
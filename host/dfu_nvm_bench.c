@@ -0,0 +1,622 @@
+/*****************************************************************************
+ * File Name:   dfu_nvm_bench.c
+ *
+ * Description: Host benchmark of the DFU write path. Runs dfu_user.c against
+ *              the simulated NVM of host/mtb_hal_nvm_sim.c: a full slot
+ *              update through Cy_DFU_WriteData() as the DFU middleware calls
+ *              it, with the packet transfer times of an I2C bus and the erase
+ *              and program times of the flash passing on a simulated clock.
+ *              Checks the slot against the image afterwards and prints the
+ *              rows per second, the NVM operations and the host CPU time of
+ *              the device calls per row (median of the writes) as CSV on
+ *              stdout.
+ *              Failures injected into the NVM are retried as a DFU host
+ *              retries a packet.
+ *
+ *              With -W, the image is sent as windowed writes instead
+ *              (DFU_APP_CMD_WINDOW_* in dfu_app_cmd.h): host/dfu_window_host.c
+ *              sends the packets through a loopback transport to
+ *              Cy_DFU_TransportRead(), which hands them to the application
+ *              commands of dfu_user.c. Only the acknowledged packets pay the
+ *              response and the host turnaround. -D corrupts packets on the
+ *              loopback to exercise the go-back-N path.
+ *
+ *              Build (the write path settings of dfu_nvm.h may be added as
+ *              -D options, e.g. -DDFU_WRITE_PIPELINE=0):
+ *                gcc -O2 -DDFU_USER_HOST -DDFU_TRANSPORT_REGISTER=1 -I. -Ihost \
+ *                    dfu_user.c crc32c.c host/mtb_hal_nvm_sim.c host/dfu_window_host.c \
+ *                    host/dfu_nvm_bench.c -o dfu_nvm_bench
+ *
+ *              Usage:
+ *                dfu_nvm_bench [-f <file>] [-i <image.bin>] [-w <rows>] [-b <bit/s>]
+ *                              [-l <us>] [-p <us>] [-r <us>] [-e <us>] [-s <bytes>]
+ *                              [-S] [-M] [-F <n>] [-E <n>] [-O <wpe>] [-W <n>] [-D <n>]
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dfu_user_host.h"
+#include "dfu_nvm.h"
+#include "dfu_transport.h"
+#include "dfu_app_cmd.h"
+#include "image_auth.h"
+#include "mtb_hal_nvm_sim.h"
+#include "dfu_window_host.h"
+
+#if (DFU_TRANSPORT_REGISTER == 0u)
+#error "Build with DFU_TRANSPORT_REGISTER=1"
+#endif
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+#define BENCH_ROWS                  (IMAGE_SLOT_SIZE / CY_NVM_SIZEOF_ROW)
+
+/* Program data command payload ahead of the data: address and CRC-32C */
+#define BENCH_PROGRAM_HEADER        (8u)
+
+/* I2C byte on the wire: 8 data bits and the acknowledge bit */
+#define BENCH_I2C_BITS_PER_BYTE     (9u)
+
+/* Attempts of the host per write */
+#define BENCH_WRITE_ATTEMPTS        (3u)
+
+/* Time the host waits for a missing acknowledgement */
+#define BENCH_ACK_TIMEOUT_US        (5000u)
+
+/* Writes whose host CPU time is kept */
+#define BENCH_SAMPLES               (4096u)
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static void bench_transport_control(void);
+static cy_en_dfu_status_t bench_transport_read(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+static cy_en_dfu_status_t bench_transport_write(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+static uint64_t bench_packet_us(uint32_t data_len);
+static uint64_t bench_bus_us(uint32_t bytes);
+static uint64_t bench_ns(void);
+static void bench_sample(uint64_t ns);
+static int bench_sample_cmp(const void *a, const void *b);
+static uint32_t bench_loopback(const uint8_t *pkt, uint32_t len);
+static bool bench_window(const uint8_t *image, uint32_t write_rows, uint32_t window, uint32_t drop_every,
+                         uint32_t *packets, uint32_t *retries);
+static void usage(const char *prog);
+
+/*******************************************************************************
+* Global Variables
+*******************************************************************************/
+
+/* Brings up the NVM ranges, and carries the windowed writes over a loopback */
+static const dfu_transport_t bench_transport =
+{
+    bench_transport_control, bench_transport_control, bench_transport_control,
+    bench_transport_read, bench_transport_write, NULL
+};
+
+static double bench_bitrate = 400000.0;
+static uint32_t bench_turnaround_us = 200u;
+
+/* Loopback: the packet the device reads next and the response it wrote */
+static const uint8_t *bench_rx;
+static uint32_t bench_rx_len;
+static uint8_t bench_tx[64];
+static uint32_t bench_tx_len;
+
+/* Send data frame the middleware receives, its data is not part of the bench */
+static const uint8_t bench_data_frame[] = { DFU_PACKET_SOP, 0x37u, 0x00u, 0x00u, 0xC8u, 0xFFu, DFU_PACKET_EOP };
+
+/* Host CPU time of the device calls of each write: its packets and main loop passes */
+static uint64_t bench_write_ns[BENCH_SAMPLES];
+static uint32_t bench_writes;
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static void bench_transport_control(void)
+{
+}
+
+static cy_en_dfu_status_t bench_transport_read(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout)
+{
+    (void)timeout;
+    *count = 0u;
+    if ((bench_rx == NULL) || (bench_rx_len > size))
+    {
+        return CY_DFU_ERROR_TIMEOUT;
+    }
+    memcpy(buffer, bench_rx, bench_rx_len);
+    *count = bench_rx_len;
+    bench_rx = NULL;
+    return CY_DFU_SUCCESS;
+}
+
+static cy_en_dfu_status_t bench_transport_write(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout)
+{
+    (void)timeout;
+    *count = 0u;
+    if (size > sizeof(bench_tx))
+    {
+        return CY_DFU_ERROR_LENGTH;
+    }
+    memcpy(bench_tx, buffer, size);
+    bench_tx_len = size;
+    *count = size;
+    return CY_DFU_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: bench_packet_us
+********************************************************************************
+* Summary:
+*  Transfer time of one command packet and its response: the bytes on the
+*  bus plus the host turnaround.
+*
+*******************************************************************************/
+static uint64_t bench_packet_us(uint32_t data_len)
+{
+    return bench_bus_us(data_len + (2u * DFU_PACKET_OVERHEAD)) + bench_turnaround_us;
+}
+
+/* Time of bytes on the I2C bus */
+static uint64_t bench_bus_us(uint32_t bytes)
+{
+    return (uint64_t)(((double)bytes * BENCH_I2C_BITS_PER_BYTE * 1e6) / bench_bitrate);
+}
+
+/* Host monotonic clock */
+static uint64_t bench_ns(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000000u) + (uint64_t)ts.tv_nsec;
+}
+
+static void bench_sample(uint64_t ns)
+{
+    if (bench_writes < BENCH_SAMPLES)
+    {
+        bench_write_ns[bench_writes++] = ns;
+    }
+}
+
+static int bench_sample_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+/*******************************************************************************
+* Function Name: bench_loopback
+********************************************************************************
+* Summary:
+*  Hands a packet to the device as one pass of the main loop does: a DFU read
+*  that the application commands of dfu_user.c take, then a pre-erase step.
+*
+* Return:
+*  Length of the response the device wrote, 0 for none
+*
+*******************************************************************************/
+static uint32_t bench_loopback(const uint8_t *pkt, uint32_t len)
+{
+    CY_ALIGN(4) static uint8_t packet[CY_DFU_SIZEOF_CMD_BUFFER];
+    uint32_t count = 0u;
+    uint64_t start;
+    cy_en_dfu_status_t status;
+
+    bench_rx = pkt;
+    bench_rx_len = len;
+    bench_tx_len = 0u;
+    start = bench_ns();
+    status = Cy_DFU_TransportRead(packet, sizeof(packet), &count, 0u);
+    dfu_nvm_pre_erase_run();
+    bench_sample(bench_ns() - start);
+    if (status == CY_DFU_SUCCESS)
+    {
+        /* A command for the DFU middleware, which is not part of the bench */
+        fprintf(stderr, "packet 0x%02X not taken by the application commands\n", (unsigned int)pkt[1]);
+    }
+
+    return bench_tx_len;
+}
+
+/*******************************************************************************
+* Function Name: bench_window
+********************************************************************************
+* Summary:
+*  Sends the image as windowed writes: window data packets in flight, only
+*  the last of each waits for the response. Every drop_every-th data packet
+*  is corrupted on the loopback.
+*
+* Return:
+*  true when the device acknowledged every packet
+*
+*******************************************************************************/
+static bool bench_window(const uint8_t *image, uint32_t write_rows, uint32_t window, uint32_t drop_every,
+                         uint32_t *packets, uint32_t *retries)
+{
+    static uint8_t pkt[CY_DFU_SIZEOF_CMD_BUFFER];
+    struct dfu_window_host w;
+    uint32_t write_len = write_rows * CY_NVM_SIZEOF_ROW;
+    uint32_t len;
+    uint32_t rsp_len;
+
+    /* The middleware enters the session */
+    dfu_app_window_enable(true);
+
+    len = dfu_window_host_open_packet(pkt);
+    nvm_sim_advance(bench_bus_us(len));
+    rsp_len = bench_loopback(pkt, len);
+    nvm_sim_advance(bench_bus_us(rsp_len) + bench_turnaround_us);
+    (*packets)++;
+    if ((rsp_len != (DFU_PACKET_OVERHEAD + 4u)) || (bench_tx[1] != CY_DFU_SUCCESS))
+    {
+        fprintf(stderr, "window open failed\n");
+        return false;
+    }
+    if ((window > ((uint32_t)bench_tx[4] | ((uint32_t)bench_tx[5] << 8u))) ||
+        (write_len > ((uint32_t)bench_tx[6] | ((uint32_t)bench_tx[7] << 8u))))
+    {
+        fprintf(stderr, "window %u or write %u above the device limits %u and %u\n",
+                (unsigned int)window, (unsigned int)write_len,
+                (unsigned int)((uint32_t)bench_tx[4] | ((uint32_t)bench_tx[5] << 8u)),
+                (unsigned int)((uint32_t)bench_tx[6] | ((uint32_t)bench_tx[7] << 8u)));
+        return false;
+    }
+
+    dfu_window_host_init(&w, image, FLASH_ADDR(0u), IMAGE_SLOT_SIZE, write_len, window);
+
+    while (!dfu_window_host_done(&w))
+    {
+        bool ack_req = false;
+        int rc;
+
+        len = dfu_window_host_next(&w, pkt, &ack_req);
+        if (len == 0u)
+        {
+            /* Window full without an acknowledgement request in flight: lost */
+            rc = dfu_window_host_timeout(&w);
+        }
+        else
+        {
+            (*packets)++;
+            nvm_sim_advance(bench_bus_us(len));
+            if ((drop_every != 0u) && ((*packets % drop_every) == 0u))
+            {
+                pkt[len - 3u] ^= 0x5Au;
+            }
+            rsp_len = bench_loopback(pkt, len);
+            if (!ack_req)
+            {
+                continue;
+            }
+
+            if (rsp_len > 0u)
+            {
+                nvm_sim_advance(bench_bus_us(rsp_len) + bench_turnaround_us);
+                rc = dfu_window_host_response(&w, bench_tx, rsp_len);
+            }
+            else
+            {
+                nvm_sim_advance(BENCH_ACK_TIMEOUT_US);
+                rc = dfu_window_host_timeout(&w);
+            }
+        }
+
+        if (rc != 0)
+        {
+            fprintf(stderr, "window write of packet %u failed\n", (unsigned int)w.base);
+            return false;
+        }
+    }
+
+    *retries = w.resent;
+    return true;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-f <file>] [-i <image.bin>] [-w <rows>] [-b <bit/s>] [-l <us>] [-p <us>] [-r <us>]\n"
+                    "          [-e <us>] [-s <bytes>] [-S] [-M] [-F <n>] [-E <n>] [-O <wpe>] [-W <n>] [-D <n>]\n"
+                    "  -f  Backing file of the flash banks (default nvm_sim.bin)\n"
+                    "  -i  Slot image, raw binary (default: generated)\n"
+                    "  -w  Rows per write (default: as many as CY_DFU_SIZEOF_DATA_BUFFER holds)\n"
+                    "  -b  I2C bit rate (default 400000)\n"
+                    "  -l  Host turnaround per packet (default 200)\n"
+                    "  -p  Row program time (default 1000)\n"
+                    "  -r  Row erase time ahead of the program (default 3000)\n"
+                    "  -e  Sector erase time (default 4000)\n"
+                    "  -s  Erase sector size (default 4096)\n"
+                    "  -S  Single bank mode\n"
+                    "  -M  Swapped bank mapping\n"
+                    "  -F  Fail the n-th NVM operation of -O (default: none)\n"
+                    "  -E  Fail every n-th operation after that\n"
+                    "  -O  Operations that can fail: w(rite), p(rogram), e(rase) (default wpe)\n"
+                    "  -W  Send windowed writes, n packets in flight (default: one write per response)\n"
+                    "  -D  With -W, corrupt every n-th packet (default: none)\n",
+            prog);
+}
+
+int main(int argc, char *argv[])
+{
+    static uint8_t image[IMAGE_SLOT_SIZE];
+    CY_ALIGN(4) static uint8_t data_buffer[CY_DFU_SIZEOF_DATA_BUFFER];
+    CY_ALIGN(4) static uint8_t packet[CY_DFU_SIZEOF_CMD_BUFFER];
+    uint32_t write_max = CY_DFU_SIZEOF_DATA_BUFFER / CY_NVM_SIZEOF_ROW;
+    uint32_t write_rows = write_max;
+    uint32_t packet_max = CY_DFU_SIZEOF_CMD_BUFFER - DFU_PACKET_OVERHEAD;
+    const char *image_path = NULL;
+    struct nvm_sim_cfg cfg;
+    struct nvm_sim_stats stats;
+    cy_stc_dfu_params_t params;
+    struct timespec t0;
+    struct timespec t1;
+    uint32_t retries = 0u;
+    uint32_t packets = 0u;
+    uint32_t window = 0u;
+    uint32_t drop_every = 0u;
+    uint32_t row;
+    uint64_t sim_us;
+    double cpu_ms;
+    double row_ns = 0.0;
+    bool ok = true;
+    int arg;
+
+    nvm_sim_cfg_default(&cfg);
+    cfg.fail_ops = NVM_SIM_OP_MASK(NVM_SIM_OP_WRITE) | NVM_SIM_OP_MASK(NVM_SIM_OP_PROGRAM) |
+                   NVM_SIM_OP_MASK(NVM_SIM_OP_ERASE);
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        const char *opt = argv[arg];
+        const char *val = ((arg + 1) < argc) ? argv[arg + 1] : NULL;
+
+        if (strcmp(opt, "-S") == 0)
+        {
+            cfg.dual_bank = false;
+            continue;
+        }
+        if (strcmp(opt, "-M") == 0)
+        {
+            cfg.bank_mapping = true;
+            continue;
+        }
+        if ((val == NULL) || (opt[0] != '-') || (opt[1] == '\0') || (opt[2] != '\0'))
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        arg++;
+
+        switch (opt[1])
+        {
+            case 'f': cfg.path = val; break;
+            case 'i': image_path = val; break;
+            case 'w': write_rows = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'b': bench_bitrate = strtod(val, NULL); break;
+            case 'l': bench_turnaround_us = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'p': cfg.program_us = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'r': cfg.row_erase_us = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'e': cfg.sector_erase_us = (uint32_t)strtoul(val, NULL, 0); break;
+            case 's': cfg.sector_size = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'F': cfg.fail_at = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'E': cfg.fail_every = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'W': window = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'D': drop_every = (uint32_t)strtoul(val, NULL, 0); break;
+            case 'O':
+                cfg.fail_ops = ((strchr(val, 'w') != NULL) ? NVM_SIM_OP_MASK(NVM_SIM_OP_WRITE) : 0u) |
+                               ((strchr(val, 'p') != NULL) ? NVM_SIM_OP_MASK(NVM_SIM_OP_PROGRAM) : 0u) |
+                               ((strchr(val, 'e') != NULL) ? NVM_SIM_OP_MASK(NVM_SIM_OP_ERASE) : 0u);
+                break;
+            default:
+                usage(argv[0]);
+                return 2;
+        }
+    }
+
+    if ((write_rows == 0u) || (write_rows > write_max) || ((BENCH_ROWS % write_rows) != 0u) ||
+        (bench_bitrate <= 0.0))
+    {
+        fprintf(stderr, "rows per write must divide %u and be at most %u\n",
+                (unsigned int)BENCH_ROWS, (unsigned int)write_max);
+        return 2;
+    }
+
+    if (image_path != NULL)
+    {
+        FILE *f = fopen(image_path, "rb");
+        size_t n = (f != NULL) ? fread(image, 1u, sizeof(image), f) : 0u;
+        if (f == NULL)
+        {
+            perror(image_path);
+            return 1;
+        }
+        (void)fclose(f);
+        memset(&image[n], 0xFF, sizeof(image) - n);
+    }
+    else
+    {
+        for (row = 0u; row < IMAGE_SLOT_SIZE; row++)
+        {
+            image[row] = (uint8_t)((row * 13u) ^ (row >> 9u));
+        }
+    }
+
+    if (nvm_sim_open(&cfg) != 0)
+    {
+        return 1;
+    }
+    if (!cfg.dual_bank && (FLASH_ADDR(0u) >= (CY_FLASH_BASE + (2u * NVM_SIM_BANK_SIZE))))
+    {
+        fprintf(stderr, "the slot at 0x%08X is mapped in dual bank mode only\n", (unsigned int)FLASH_ADDR(0u));
+        nvm_sim_close();
+        return 2;
+    }
+
+    /* The slot holds an older image, as on a device in the field */
+    for (row = 0u; row < IMAGE_SLOT_SIZE; row++)
+    {
+        ((volatile uint8_t *)(uintptr_t)FLASH_ADDR(0u))[row] = (uint8_t)~image[row];
+    }
+
+    memset(&params, 0, sizeof(params));
+    params.dataBuffer = data_buffer;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &t0);
+
+    /* Session start as in main.c */
+    dfu_transport_register(CY_DFU_I2C, &bench_transport);
+    Cy_DFU_TransportStart(CY_DFU_I2C);
+    dfu_nvm_pre_erase_start(FLASH_ADDR(0u), IMAGE_SLOT_SIZE);
+    dfu_nvm_resume_start();
+
+    if (window != 0u)
+    {
+        ok = bench_window(image, write_rows, window, drop_every, &packets, &retries);
+        if (!ok)
+        {
+            dfu_nvm_resume_checkpoint();
+        }
+    }
+
+    for (row = 0u; ok && (window == 0u) && (row < BENCH_ROWS); row += write_rows)
+    {
+        uint32_t len = write_rows * CY_NVM_SIZEOF_ROW;
+        uint32_t attempt;
+        cy_en_dfu_status_t status = CY_DFU_ERROR_UNKNOWN;
+
+        for (attempt = 0u; (attempt < BENCH_WRITE_ATTEMPTS) && (status != CY_DFU_SUCCESS); attempt++)
+        {
+            uint32_t left = len + BENCH_PROGRAM_HEADER;
+            uint64_t write_ns = 0u;
+
+            /* Send data packets, then the program data packet, each followed by a main loop pass */
+            while (left > 0u)
+            {
+                uint32_t chunk = (left < packet_max) ? left : packet_max;
+                uint32_t count;
+                uint64_t start;
+
+                nvm_sim_advance(bench_packet_us(chunk));
+                packets++;
+                left -= chunk;
+
+                /* The middleware reads each packet, a bare frame on the loopback, and copies its data */
+                bench_rx = bench_data_frame;
+                bench_rx_len = sizeof(bench_data_frame);
+                start = bench_ns();
+                (void)Cy_DFU_TransportRead(packet, sizeof(packet), &count, 0u);
+                if (left == 0u)
+                {
+                    memcpy(data_buffer, &image[row * CY_NVM_SIZEOF_ROW], len);
+                    status = Cy_DFU_WriteData(FLASH_ADDR(row * CY_NVM_SIZEOF_ROW), len, 0u, &params);
+                }
+                dfu_nvm_pre_erase_run();
+                write_ns += bench_ns() - start;
+            }
+            bench_sample(write_ns);
+
+            if (status != CY_DFU_SUCCESS)
+            {
+                retries++;
+            }
+        }
+
+        if (status != CY_DFU_SUCCESS)
+        {
+            fprintf(stderr, "write of row %u failed: 0x%X\n", (unsigned int)row, (unsigned int)status);
+            dfu_nvm_resume_checkpoint();
+            ok = false;
+        }
+    }
+
+    /* Session end as in main.c */
+    if (ok && (dfu_nvm_flush() != CY_DFU_SUCCESS))
+    {
+        fprintf(stderr, "last write failed\n");
+        dfu_nvm_resume_checkpoint();
+        ok = false;
+    }
+    if (ok)
+    {
+        dfu_nvm_resume_drop();
+        ok = (memcmp((const void *)(uintptr_t)FLASH_ADDR(0u), image, IMAGE_SLOT_SIZE) == 0);
+        if (!ok)
+        {
+            fprintf(stderr, "slot does not match the image\n");
+        }
+    }
+    sim_us = nvm_sim_now_us();
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &t1);
+    cpu_ms = ((double)(t1.tv_sec - t0.tv_sec) * 1e3) + ((double)(t1.tv_nsec - t0.tv_nsec) / 1e6);
+    if (bench_writes > 0u)
+    {
+        qsort(bench_write_ns, bench_writes, sizeof(bench_write_ns[0]), bench_sample_cmp);
+        row_ns = (double)bench_write_ns[bench_writes / 2u] / (double)write_rows;
+    }
+
+    nvm_sim_stats_get(&stats);
+    nvm_sim_close();
+
+    printf("rows,rows_per_write,window,packets,retries,sim_ms,rows_per_s,kb_per_s,writes,programs,erases,"
+           "failed,rejected,flash_busy_pct,masked_max_us,host_ms,device_ns_per_row,result\n");
+    printf("%u,%u,%u,%u,%u,%.1f,%.1f,%.2f,%u,%u,%u,%u,%u,%.1f,%llu,%.2f,%.0f,%s\n",
+           (unsigned int)BENCH_ROWS, (unsigned int)write_rows, (unsigned int)window, (unsigned int)packets, (unsigned int)retries,
+           (double)sim_us / 1e3, (double)BENCH_ROWS * 1e6 / (double)sim_us,
+           ((double)IMAGE_SLOT_SIZE / 1024.0) * 1e6 / (double)sim_us,
+           (unsigned int)stats.ops[NVM_SIM_OP_WRITE], (unsigned int)stats.ops[NVM_SIM_OP_PROGRAM],
+           (unsigned int)stats.ops[NVM_SIM_OP_ERASE],
+           (unsigned int)(stats.failed[NVM_SIM_OP_WRITE] + stats.failed[NVM_SIM_OP_PROGRAM] +
+                          stats.failed[NVM_SIM_OP_ERASE]),
+           (unsigned int)stats.rejected, 100.0 * (double)stats.busy_us / (double)sim_us,
+           (unsigned long long)stats.masked_max_us, cpu_ms, row_ns,
+           ok ? "ok" : "fail");
+
+    return ok ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,220 @@
+/*****************************************************************************
+ * File Name:   dfu_user_host.h
+ *
+ * Description: This file provides the subset of the DFU middleware, PDL and
+ *              HAL declarations that dfu_user.c uses, for host (Linux) builds
+ *              with DFU_USER_HOST. The NVM functions are implemented by
+ *              host/mtb_hal_nvm_sim.c.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_USER_HOST_H_
+#define DFU_USER_HOST_H_
+
+#include <assert.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*******************************************************************************
+* Result codes (cy_result.h)
+*******************************************************************************/
+
+typedef uint32_t cy_rslt_t;
+
+#define CY_RSLT_SUCCESS             ((cy_rslt_t)0x00000000u)
+#define CY_RSLT_GET_MODULE(x)       (((x) >> 18u) & 0x3FFFu)
+#define CY_RSLT_GET_CODE(x)         ((x) & 0xFFFFu)
+
+/*******************************************************************************
+* Utilities (cy_utils.h)
+*******************************************************************************/
+
+#define CY_ASSERT(x)                assert(x)
+#define CY_UNUSED_PARAMETER(x)      ((void)(x))
+#define CY_ALIGN(align)             __attribute__((aligned(align)))
+#define CY_SECTION(name)
+#define __USED                      __attribute__((used))
+
+/*******************************************************************************
+* Device (cy_device_headers.h): PSoC Control C3 flash in dual bank mode
+*******************************************************************************/
+
+#define CY_FLASH_BASE               (0x32000000u)
+#define CY_FLASH_SIZE               (0x40000u)
+#define CY_DUAL_FLASH_S_SBUS_BASE   (0x32800000u)
+#define CY_DUAL_FLASH_S_SIZE        (0x20000u)
+
+/* Flash controller register, modeled by mtb_hal_nvm_sim.c */
+extern volatile uint32_t nvm_sim_flash_ctl;
+
+#define FLASHC_FLASH_CTL                    (nvm_sim_flash_ctl)
+#define FLASHC_FLASH_CTL_BANK_MODE_Pos      (12u)
+#define FLASHC_FLASH_CTL_BANK_MODE_Msk      (0x00001000u)
+#define FLASHC_FLASH_CTL_BANK_MAPPING_Pos   (13u)
+#define FLASHC_FLASH_CTL_BANK_MAPPING_Msk   (0x00002000u)
+
+#define _FLD2VAL(field, value)      (((uint32_t)(value) & field ## _Msk) >> field ## _Pos)
+
+/*******************************************************************************
+* DFU middleware (cy_dfu.h, cy_dfu_logging.h)
+*******************************************************************************/
+
+#define CY_NVM_SIZEOF_ROW           (512u)
+
+#ifndef CY_DFU_SIZEOF_CMD_BUFFER
+#define CY_DFU_SIZEOF_CMD_BUFFER    (CY_NVM_SIZEOF_ROW + 32u)
+#endif
+#ifndef CY_DFU_SIZEOF_DATA_BUFFER
+#define CY_DFU_SIZEOF_DATA_BUFFER   (CY_NVM_SIZEOF_ROW + 16u)
+#endif
+
+#define CY_DFU_BASIC_FLOW           (0)
+#define CY_DFU_MCUBOOT_FLOW         (1)
+#define CY_DFU_FLOW                 (CY_DFU_MCUBOOT_FLOW)
+
+#define CY_DFU_IOCTL_COMPARE        (0x01u)
+#define CY_DFU_IOCTL_ERASE          (0x02u)
+
+/* Status codes, with the values sent in the response packets */
+typedef enum
+{
+    CY_DFU_SUCCESS          = 0x00,
+    CY_DFU_ERROR_VERIFY     = 0x02,
+    CY_DFU_ERROR_LENGTH     = 0x03,
+    CY_DFU_ERROR_DATA       = 0x04,
+    CY_DFU_ERROR_CMD        = 0x05,
+    CY_DFU_ERROR_CHECKSUM   = 0x08,
+    CY_DFU_ERROR_ADDRESS    = 0x0A,
+    CY_DFU_ERROR_UNKNOWN    = 0x0F,
+    CY_DFU_ERROR_TIMEOUT    = 0x40,
+    CY_DFU_ERROR_BAD_PARAM  = 0x41
+} cy_en_dfu_status_t;
+
+typedef enum
+{
+    CY_DFU_I2C,
+    CY_DFU_UART,
+    CY_DFU_SPI,
+    CY_DFU_USB_CDC,
+    CY_DFU_CANFD
+} cy_en_dfu_transport_t;
+
+typedef struct
+{
+    uint32_t timeout;
+    uint8_t *dataBuffer;
+    uint8_t *packetBuffer;
+} cy_stc_dfu_params_t;
+
+#define CY_DFU_LOG_ERR(...)         do { (void)fprintf(stderr, "DFU error: " __VA_ARGS__); \
+                                         (void)fputc('\n', stderr); } while (false)
+#define CY_DFU_LOG_WRN(...)         do { (void)fprintf(stderr, "DFU warning: " __VA_ARGS__); \
+                                         (void)fputc('\n', stderr); } while (false)
+#define CY_DFU_LOG_INF(...)         do { } while (false)
+
+cy_en_dfu_status_t Cy_DFU_WriteData(uint32_t address, uint32_t length, uint32_t ctl, cy_stc_dfu_params_t *params);
+cy_en_dfu_status_t Cy_DFU_ReadData(uint32_t address, uint32_t length, uint32_t ctl, cy_stc_dfu_params_t *params);
+void Cy_DFU_TransportStart(cy_en_dfu_transport_t transport);
+void Cy_DFU_TransportStop(void);
+void Cy_DFU_TransportReset(void);
+cy_en_dfu_status_t Cy_DFU_TransportRead(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+cy_en_dfu_status_t Cy_DFU_TransportWrite(uint8_t buffer[], uint32_t size, uint32_t *count, uint32_t timeout);
+
+/*******************************************************************************
+* Flash driver (cy_flash.h)
+*******************************************************************************/
+
+typedef enum
+{
+    CY_FLASH_DRV_SUCCESS,
+    CY_FLASH_DRV_OPERATION_STARTED,
+    CY_FLASH_DRV_OPCODE_BUSY,
+    CY_FLASH_DRV_ERR_UNC
+} cy_en_flashdrv_status_t;
+
+cy_en_flashdrv_status_t Cy_Flash_StartWrite(uint32_t rowAddr, const uint32_t *data);
+cy_en_flashdrv_status_t Cy_Flash_StartProgram(uint32_t rowAddr, const uint32_t *data);
+cy_en_flashdrv_status_t Cy_Flash_StartEraseSector(uint32_t sectorAddr);
+cy_en_flashdrv_status_t Cy_Flash_IsOperationComplete(void);
+
+/*******************************************************************************
+* NVM and system HAL (mtb_hal_nvm.h, mtb_hal_system.h)
+*******************************************************************************/
+
+typedef struct
+{
+    uint32_t unused;
+} mtb_hal_nvm_t;
+
+typedef struct
+{
+    uint32_t start_address;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t sector_size;
+    uint32_t block_size;
+    bool is_erase_required;
+    uint8_t erase_value;
+} mtb_hal_nvm_region_info_t;
+
+typedef struct
+{
+    uint8_t region_count;
+    const mtb_hal_nvm_region_info_t *regions;
+} mtb_hal_nvm_info_t;
+
+void mtb_hal_nvm_get_info(mtb_hal_nvm_t *obj, mtb_hal_nvm_info_t *info);
+cy_rslt_t mtb_hal_nvm_read(mtb_hal_nvm_t *obj, uint32_t address, uint8_t *data, size_t size);
+cy_rslt_t mtb_hal_nvm_write(mtb_hal_nvm_t *obj, uint32_t address, const uint32_t *data);
+cy_rslt_t mtb_hal_nvm_program(mtb_hal_nvm_t *obj, uint32_t address, const uint32_t *data);
+cy_rslt_t mtb_hal_nvm_erase(mtb_hal_nvm_t *obj, uint32_t address);
+
+uint32_t mtb_hal_system_critical_section_enter(void);
+void mtb_hal_system_critical_section_exit(uint32_t old_state);
+
+/*******************************************************************************
+* Interrupt masking and sleep of dfu_event.c, host/dfu_event_host.c models the
+* interrupt handlers as threads
+*******************************************************************************/
+
+uint32_t dfu_event_host_enter(void);
+void dfu_event_host_exit(uint32_t state);
+void dfu_event_host_sleep(void);
+void dfu_event_host_wake(void);
+
+#endif /* DFU_USER_HOST_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,242 @@
+/*****************************************************************************
+ * File Name:   dfu_window_host.c
+ *
+ * Description: This file provides the host side of the windowed DFU writes
+ *              (DFU_APP_CMD_WINDOW_* in dfu_app_cmd.h): builds the data
+ *              packets of an image, at most a window of them ahead of the
+ *              acknowledgements, and goes back to the sequence number the
+ *              device asks for. The caller moves the packets, see
+ *              host/dfu_nvm_bench.c for a loopback to dfu_user.c.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <string.h>
+#include "crc32c.h"
+#include "dfu_app_cmd.h"
+#include "dfu_window_host.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+/* Status of a response packet and result of an acknowledgement: CY_DFU_SUCCESS */
+#define DFU_WINDOW_HOST_SUCCESS     (0x00u)
+
+/* Response data of a data packet: next sequence number and result */
+#define DFU_WINDOW_HOST_ACK_LEN     (3u)
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static uint16_t dfu_window_host_checksum(const uint8_t *data, uint32_t len);
+static uint32_t dfu_window_host_frame(uint8_t *pkt, uint8_t cmd, uint32_t len);
+static int dfu_window_host_rewind(struct dfu_window_host *w);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static uint16_t dfu_window_host_checksum(const uint8_t *data, uint32_t len)
+{
+    uint16_t sum = 0u;
+    uint32_t idx;
+
+    for (idx = 0u; idx < len; idx++)
+    {
+        sum += data[idx];
+    }
+
+    return (uint16_t)(1u + (uint16_t)~sum);
+}
+
+/*******************************************************************************
+* Function Name: dfu_window_host_frame
+********************************************************************************
+* Summary:
+*  Frames len bytes of data already at pkt + 4: start, command, length,
+*  checksum, end.
+*
+* Return:
+*  Packet length in bytes
+*
+*******************************************************************************/
+static uint32_t dfu_window_host_frame(uint8_t *pkt, uint8_t cmd, uint32_t len)
+{
+    uint16_t sum;
+
+    pkt[0] = DFU_PACKET_SOP;
+    pkt[1] = cmd;
+    pkt[2] = (uint8_t)len;
+    pkt[3] = (uint8_t)(len >> 8u);
+    sum = dfu_window_host_checksum(pkt, len + 4u);
+    pkt[len + 4u] = (uint8_t)sum;
+    pkt[len + 5u] = (uint8_t)(sum >> 8u);
+    pkt[len + 6u] = DFU_PACKET_EOP;
+
+    return len + DFU_PACKET_OVERHEAD;
+}
+
+/*******************************************************************************
+* Function Name: dfu_window_host_rewind
+********************************************************************************
+* Summary:
+*  Sends again from the oldest packet not acknowledged, counting the attempts
+*  of that packet.
+*
+* Return:
+*  -1 when the packet failed DFU_WINDOW_HOST_ATTEMPTS times
+*
+*******************************************************************************/
+static int dfu_window_host_rewind(struct dfu_window_host *w)
+{
+    w->attempts++;
+    w->next = w->base;
+
+    return (w->attempts < DFU_WINDOW_HOST_ATTEMPTS) ? 0 : -1;
+}
+
+uint32_t dfu_window_host_open_packet(uint8_t *pkt)
+{
+    return dfu_window_host_frame(pkt, DFU_APP_CMD_WINDOW_OPEN, 0u);
+}
+
+void dfu_window_host_init(struct dfu_window_host *w, const uint8_t *image, uint32_t address,
+                          uint32_t size, uint32_t write_len, uint32_t window)
+{
+    memset(w, 0, sizeof(*w));
+    w->image = image;
+    w->address = address;
+    w->size = size;
+    w->write_len = write_len;
+    w->window = (window > 0u) ? window : 1u;
+    w->count = (size + write_len - 1u) / write_len;
+}
+
+uint32_t dfu_window_host_next(struct dfu_window_host *w, uint8_t *pkt, bool *ack_req)
+{
+    uint32_t offset = w->next * w->write_len;
+    uint32_t len;
+    uint32_t crc;
+    uint8_t *data = &pkt[4];
+
+    if ((w->next >= w->count) || ((w->next - w->base) >= w->window))
+    {
+        return 0u;
+    }
+
+    len = ((w->size - offset) < w->write_len) ? (w->size - offset) : w->write_len;
+    crc = crc32c_update(0u, &w->image[offset], len);
+
+    /* Last of the window or of the image: the device answers it */
+    *ack_req = ((w->next + 1u - w->base) == w->window) || ((w->next + 1u) == w->count);
+
+    data[0] = (uint8_t)w->next;
+    data[1] = (uint8_t)(w->next >> 8u);
+    data[2] = *ack_req ? DFU_APP_WINDOW_ACK_REQ : 0u;
+    data[3] = 0u;
+    data[4] = (uint8_t)(w->address + offset);
+    data[5] = (uint8_t)((w->address + offset) >> 8u);
+    data[6] = (uint8_t)((w->address + offset) >> 16u);
+    data[7] = (uint8_t)((w->address + offset) >> 24u);
+    data[8] = (uint8_t)crc;
+    data[9] = (uint8_t)(crc >> 8u);
+    data[10] = (uint8_t)(crc >> 16u);
+    data[11] = (uint8_t)(crc >> 24u);
+    memcpy(&data[DFU_APP_WINDOW_HEADER], &w->image[offset], len);
+
+    if (w->next < w->sent)
+    {
+        w->resent++;
+    }
+    else
+    {
+        w->sent = w->next + 1u;
+    }
+    w->next++;
+
+    return dfu_window_host_frame(pkt, DFU_APP_CMD_WINDOW_DATA, DFU_APP_WINDOW_HEADER + len);
+}
+
+int dfu_window_host_response(struct dfu_window_host *w, const uint8_t *rsp, uint32_t len)
+{
+    uint32_t acked;
+
+    if ((len != (DFU_WINDOW_HOST_ACK_LEN + DFU_PACKET_OVERHEAD)) || (rsp[0] != DFU_PACKET_SOP) ||
+        (rsp[1] != DFU_WINDOW_HOST_SUCCESS) || (rsp[2] != DFU_WINDOW_HOST_ACK_LEN) || (rsp[3] != 0u) ||
+        (rsp[9] != DFU_PACKET_EOP) ||
+        (dfu_window_host_checksum(rsp, 7u) != (uint16_t)((uint32_t)rsp[7] | ((uint32_t)rsp[8] << 8u))))
+    {
+        return -1;
+    }
+
+    /* The 16-bit sequence number of the device, relative to the window base */
+    acked = w->base + (uint16_t)(((uint32_t)rsp[4] | ((uint32_t)rsp[5] << 8u)) - w->base);
+    if (acked > w->next)
+    {
+        return -1;
+    }
+
+    if (acked > w->base)
+    {
+        w->base = acked;
+        w->attempts = 0u;
+    }
+
+    if ((rsp[6] != DFU_WINDOW_HOST_SUCCESS) || (w->base < w->next))
+    {
+        w->nacks++;
+        return dfu_window_host_rewind(w);
+    }
+
+    return 0;
+}
+
+int dfu_window_host_timeout(struct dfu_window_host *w)
+{
+    w->timeouts++;
+
+    return dfu_window_host_rewind(w);
+}
+
+bool dfu_window_host_done(const struct dfu_window_host *w)
+{
+    return (w->base >= w->count);
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,152 @@
+/*****************************************************************************
+ * File Name:   dfu_window_host.h
+ *
+ * Description: This file contains the interface of the host side of the
+ *              windowed DFU writes (DFU_APP_CMD_WINDOW_* in dfu_app_cmd.h):
+ *              a go-back-N sender of an image, independent of the transport.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef DFU_WINDOW_HOST_H_
+#define DFU_WINDOW_HOST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** Times the host sends the same packet again before it gives up */
+#define DFU_WINDOW_HOST_ATTEMPTS    (4u)
+
+/** Sender state of one image */
+struct dfu_window_host {
+    const uint8_t *image;       /* Image data */
+    uint32_t address;           /* Device address of the image */
+    uint32_t size;              /* Image size, whole rows */
+    uint32_t write_len;         /* Image bytes per data packet, whole rows */
+    uint32_t window;            /* Data packets in flight */
+    uint32_t count;             /* Data packets of the image */
+    uint32_t base;              /* Oldest packet not acknowledged */
+    uint32_t next;              /* Next packet to send */
+    uint32_t attempts;          /* Times the packet at base was sent again */
+    uint32_t sent;              /* Data packets sent */
+    uint32_t resent;            /* Data packets sent again */
+    uint32_t nacks;             /* Responses asking to send again */
+    uint32_t timeouts;          /* Acknowledgements not received */
+};
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Build the DFU_APP_CMD_WINDOW_OPEN packet.
+ *
+ * @param  pkt        The packet buffer, at least DFU_PACKET_OVERHEAD bytes.
+ *
+ * @return The packet length.
+ */
+uint32_t dfu_window_host_open_packet(uint8_t *pkt);
+
+/**
+ * @brief Start sending an image, after the device answered the open command.
+ *
+ * @param  w          The sender state.
+ * @param  image      The image data.
+ * @param  address    The device address of the image, row aligned.
+ * @param  size       The image size, whole rows.
+ * @param  write_len  Image bytes per data packet, whole rows, at most the
+ *                    largest write of the open response.
+ * @param  window     Data packets in flight, at most the window of the open
+ *                    response.
+ */
+void dfu_window_host_init(struct dfu_window_host *w, const uint8_t *image, uint32_t address,
+                          uint32_t size, uint32_t write_len, uint32_t window);
+
+/**
+ * @brief Build the next data packet while the window has room.
+ *
+ * The last packet of a window and the last packet of the image ask for an
+ * acknowledgement: read the response, then pass it to
+ * dfu_window_host_response(), or call dfu_window_host_timeout() when none
+ * arrives.
+ *
+ * @param  w          The sender state.
+ * @param  pkt        The packet buffer, write_len + DFU_APP_WINDOW_HEADER +
+ *                    DFU_PACKET_OVERHEAD bytes.
+ * @param  ack_req    Set when the packet asks for an acknowledgement.
+ *
+ * @return The packet length, 0 when the window is full or all packets are
+ *         sent.
+ */
+uint32_t dfu_window_host_next(struct dfu_window_host *w, uint8_t *pkt, bool *ack_req);
+
+/**
+ * @brief Handle a response to a data packet.
+ *
+ * Slides the window to the next sequence number of the response. When the
+ * device asks for it, or packets after it are not acknowledged, sending
+ * starts over from there.
+ *
+ * @param  w          The sender state.
+ * @param  rsp        The response packet.
+ * @param  len        The response length.
+ *
+ * @return 0 on success.
+ * @return -1 when the response is invalid or a packet failed
+ *         DFU_WINDOW_HOST_ATTEMPTS times.
+ */
+int dfu_window_host_response(struct dfu_window_host *w, const uint8_t *rsp, uint32_t len);
+
+/**
+ * @brief Handle a missing acknowledgement: send again from the oldest packet
+ * not acknowledged.
+ *
+ * @param  w          The sender state.
+ *
+ * @return 0 on success.
+ * @return -1 when the packet failed DFU_WINDOW_HOST_ATTEMPTS times.
+ */
+int dfu_window_host_timeout(struct dfu_window_host *w);
+
+/**
+ * @brief Tell whether the device acknowledged every packet of the image.
+ *
+ * @param  w          The sender state.
+ *
+ * @return true when done.
+ */
+bool dfu_window_host_done(const struct dfu_window_host *w);
+
+#endif /* DFU_WINDOW_HOST_H_ */
+
+/* [] END OF FILE */
@@ -0,0 +1,393 @@
+/*****************************************************************************
+ * File Name:   dfu_write_sim.c
+ *
+ * Description: Host model of the DFU row write timeline. Compares rows that
+ *              are programmed before the response is sent (DFU_WRITE_PIPELINE
+ *              = 0) with the write pipeline of dfu_user.c, where the next row
+ *              is received while the previous one is programming, each with
+ *              and without erasing the slot ahead of the rows
+ *              (DFU_NVM_PRE_ERASE). Flash and transport latencies are
+ *              modeled, nothing is programmed.
+ *
+ *              Build:
+ *                gcc -O2 host/dfu_write_sim.c -o dfu_write_sim
+ *
+ *              Usage:
+ *                dfu_write_sim [-n <rows>] [-b <bit/s>] [-p <us>] [-r <us>] [-e <us>]
+ *                              [-s <rows>] [-c <us>] [-l <us>]
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+/* Flash row, one DFU program data command per row */
+#define SIM_ROW_SIZE                (512u)
+
+/* Most rows the model tracks, 1 MB */
+#define SIM_MAX_ROWS                (2048u)
+
+/* DFU packet framing: start, command, length, checksum, end */
+#define SIM_PACKET_OVERHEAD         (7u)
+
+/* Program data command payload ahead of the row: address and CRC-32C */
+#define SIM_PROGRAM_HEADER          (8u)
+
+/* I2C byte on the wire: 8 data bits and the acknowledge bit */
+#define SIM_BITS_PER_BYTE           (9u)
+
+/* Cy_DFU_Continue() timeout of main.c, the main loop runs at least this often */
+#define SIM_LOOP_PERIOD_US          (20000.0)
+
+/*******************************************************************************
+* Type Definitions
+*******************************************************************************/
+
+/* Modeled latencies, in microseconds */
+struct sim_model
+{
+    uint32_t rows;
+    uint32_t sector_rows;   /* Rows per erase sector */
+    double rx_us;           /* Program data command, host to device */
+    double tx_us;           /* Response, device to host */
+    double turnaround_us;   /* Host poll and processing between packets */
+    double program_us;      /* Row program */
+    double row_erase_us;    /* Row erase ahead of the program */
+    double sector_erase_us; /* Sector erase */
+    double copy_us;         /* Row copy into the pipeline buffer */
+    double check_us;        /* Hash and sector check of the row */
+};
+
+/* Pre-erase progress, see dfu_nvm_pre_erase_run() */
+struct sim_erase
+{
+    bool enabled;
+    uint32_t next;                      /* Next sector to erase */
+    bool sector_erased[SIM_MAX_ROWS];   /* Indexed by sector */
+    bool row_written[SIM_MAX_ROWS];
+};
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static void usage(const char *prog);
+static bool sim_sector_written(const struct sim_model *m, const struct sim_erase *e, uint32_t sector);
+static bool sim_erase_next(const struct sim_model *m, struct sim_erase *e);
+static double sim_row_write(const struct sim_model *m, struct sim_erase *e, uint32_t row);
+static double sim_blocking(const struct sim_model *m, bool pre_erase);
+static double sim_pipelined(const struct sim_model *m, bool pre_erase);
+static void print_result(const char *name, const struct sim_model *m, double total_us, double base_us);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-n <rows>] [-b <bit/s>] [-p <us>] [-r <us>] [-e <us>] [-s <rows>] [-c <us>] [-l <us>]\n"
+                    "  -n  Rows to write (default 256, one 128 KB slot, at most %u)\n"
+                    "  -b  I2C bit rate (default 400000)\n"
+                    "  -p  Row program time (default 1000)\n"
+                    "  -r  Row erase time ahead of the program (default 3000)\n"
+                    "  -e  Sector erase time (default 4000)\n"
+                    "  -s  Rows per erase sector (default 8)\n"
+                    "  -c  Row hash and sector check time (default 60)\n"
+                    "  -l  Host turnaround between packets (default 200)\n",
+                    prog, (unsigned int)SIM_MAX_ROWS);
+}
+
+static bool sim_sector_written(const struct sim_model *m, const struct sim_erase *e, uint32_t sector)
+{
+    bool written = false;
+    uint32_t row;
+
+    for (row = sector * m->sector_rows; (row < ((sector + 1u) * m->sector_rows)) && (row < m->rows); row++)
+    {
+        written = written || e->row_written[row];
+    }
+
+    return written;
+}
+
+/*******************************************************************************
+* Function Name: sim_erase_next
+********************************************************************************
+* Summary:
+*  One dfu_nvm_pre_erase_run() call: picks the next sector without written
+*  rows and marks it erased.
+*
+* Return:
+*  true when a sector erase was started
+*
+*******************************************************************************/
+static bool sim_erase_next(const struct sim_model *m, struct sim_erase *e)
+{
+    uint32_t sectors = (m->rows + m->sector_rows - 1u) / m->sector_rows;
+
+    while ((e->next < sectors) && sim_sector_written(m, e, e->next))
+    {
+        e->next++;
+    }
+
+    if (!e->enabled || (e->next >= sectors))
+    {
+        return false;
+    }
+
+    e->sector_erased[e->next++] = true;
+    return true;
+}
+
+/*******************************************************************************
+* Function Name: sim_row_write
+********************************************************************************
+* Summary:
+*  Flash time of one row: program only when its sector was erased ahead and
+*  the row was not written since, erase and program otherwise. With
+*  pre-erase, the first row of an untouched sector erases the whole sector.
+*
+*******************************************************************************/
+static double sim_row_write(const struct sim_model *m, struct sim_erase *e, uint32_t row)
+{
+    uint32_t sector = row / m->sector_rows;
+    double flash_us = 0.0;
+    bool blank;
+
+    if (e->enabled && !e->sector_erased[sector] && !sim_sector_written(m, e, sector))
+    {
+        e->sector_erased[sector] = true;
+        flash_us += m->sector_erase_us;
+    }
+
+    blank = e->sector_erased[sector] && !e->row_written[row];
+    e->row_written[row] = true;
+
+    return flash_us + (blank ? m->program_us : (m->row_erase_us + m->program_us));
+}
+
+/*******************************************************************************
+* Function Name: sim_blocking
+********************************************************************************
+* Summary:
+*  Timeline with DFU_WRITE_PIPELINE = 0. The response of a row is sent after
+*  the row is programmed and checked, so every row costs the transport time
+*  plus the flash time. A pre-erase step erases one sector in the main loop
+*  pass after the response, before the next packet is read.
+*
+* Return:
+*  Time until the last row is programmed, in microseconds
+*
+*******************************************************************************/
+static double sim_blocking(const struct sim_model *m, bool pre_erase)
+{
+    static struct sim_erase e;
+    double t = 0.0;
+    uint32_t row;
+
+    memset(&e, 0, sizeof(e));
+    e.enabled = pre_erase;
+
+    for (row = 0u; row < m->rows; row++)
+    {
+        t += m->rx_us;
+        t += sim_row_write(m, &e, row) + m->check_us;
+        t += m->tx_us + m->turnaround_us;
+
+        if (sim_erase_next(m, &e))
+        {
+            t += m->sector_erase_us;
+        }
+    }
+
+    return t;
+}
+
+/*******************************************************************************
+* Function Name: sim_pipelined
+********************************************************************************
+* Summary:
+*  Timeline of the write pipeline. A row is copied out of the DFU buffer,
+*  waits for the flash operation ahead of it, starts programming and is
+*  checked while the flash is busy. The response goes out before the row is
+*  programmed. Main loop passes start the next sector erase when the flash is
+*  idle: one after each response and one per loop period while waiting for a
+*  packet. The final flush waits for the last row.
+*
+* Return:
+*  Time until the last row is programmed, in microseconds
+*
+*******************************************************************************/
+static double sim_pipelined(const struct sim_model *m, bool pre_erase)
+{
+    static struct sim_erase e;
+    double t = 0.0;
+    double flash_free = 0.0;
+    double arrival;
+    double pass;
+    double start;
+    uint32_t row;
+
+    memset(&e, 0, sizeof(e));
+    e.enabled = pre_erase;
+
+    for (row = 0u; row < m->rows; row++)
+    {
+        arrival = t + m->rx_us;
+
+        /* Loop passes before the row arrives */
+        for (pass = t; pass < arrival; pass += SIM_LOOP_PERIOD_US)
+        {
+            if ((flash_free <= pass) && sim_erase_next(m, &e))
+            {
+                flash_free = pass + m->sector_erase_us;
+            }
+        }
+
+        t = arrival + m->copy_us;
+
+        start = (t > flash_free) ? t : flash_free;
+        flash_free = start + sim_row_write(m, &e, row);
+
+        t = start + m->check_us;
+        t += m->tx_us + m->turnaround_us;
+    }
+
+    return (t > flash_free) ? t : flash_free;
+}
+
+static void print_result(const char *name, const struct sim_model *m, double total_us, double base_us)
+{
+    printf("%-20s %10.1f ms %8.2f KB/s %8.1f us/row %6.2fx\n", name, total_us / 1000.0,
+           ((double)m->rows * SIM_ROW_SIZE / 1024.0) / (total_us / 1e6), total_us / (double)m->rows,
+           base_us / total_us);
+}
+
+int main(int argc, char *argv[])
+{
+    struct sim_model m;
+    double bitrate = 400000.0;
+    double blocking;
+    int arg;
+
+    m.rows = 256u;
+    m.sector_rows = 8u;
+    m.program_us = 1000.0;
+    m.row_erase_us = 3000.0;
+    m.sector_erase_us = 4000.0;
+    m.check_us = 60.0;
+    m.copy_us = 5.0;
+    m.turnaround_us = 200.0;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((arg + 1) >= argc)
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else if (strcmp(argv[arg], "-n") == 0)
+        {
+            m.rows = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else if (strcmp(argv[arg], "-b") == 0)
+        {
+            bitrate = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-p") == 0)
+        {
+            m.program_us = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-r") == 0)
+        {
+            m.row_erase_us = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-e") == 0)
+        {
+            m.sector_erase_us = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-s") == 0)
+        {
+            m.sector_rows = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else if (strcmp(argv[arg], "-c") == 0)
+        {
+            m.check_us = strtod(argv[++arg], NULL);
+        }
+        else if (strcmp(argv[arg], "-l") == 0)
+        {
+            m.turnaround_us = strtod(argv[++arg], NULL);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    if ((m.rows == 0u) || (m.rows > SIM_MAX_ROWS) || (m.sector_rows == 0u) || (bitrate <= 0.0))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    m.rx_us = (double)(SIM_ROW_SIZE + SIM_PROGRAM_HEADER + SIM_PACKET_OVERHEAD) * SIM_BITS_PER_BYTE * 1e6 / bitrate;
+    m.tx_us = (double)SIM_PACKET_OVERHEAD * SIM_BITS_PER_BYTE * 1e6 / bitrate;
+
+    blocking = sim_blocking(&m, false);
+
+    printf("rows %u, transport %.1f us/row, row erase+program %.1f us, sector erase %.1f us per %u rows\n",
+           (unsigned int)m.rows, m.rx_us + m.tx_us + m.turnaround_us, m.row_erase_us + m.program_us,
+           m.sector_erase_us, (unsigned int)m.sector_rows);
+    print_result("blocking", &m, blocking, blocking);
+    print_result("blocking+pre-erase", &m, sim_blocking(&m, true), blocking);
+    print_result("pipelined", &m, sim_pipelined(&m, false), blocking);
+    print_result("pipelined+pre-erase", &m, sim_pipelined(&m, true), blocking);
+
+    return 0;
+}
+
+/* [] END OF FILE */
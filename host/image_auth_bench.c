@@ -0,0 +1,288 @@
+/*****************************************************************************
+ * File Name:   image_auth_bench.c
+ *
+ * Description: Host benchmark for image authentication. Measures SHA-256 and
+ *              CRC32C (unsigned image check) throughput for image sizes from 4 KB
+ *              up to the slot size, ECDSA-P256 verify
+ *              time, is_pub_key_valid() cost and full validate_image_flash() time for a
+ *              signed slot image. Results are printed as CSV on stdout.
+ *
+ *              Build (mbedTLS 3.x with PSA crypto):
+ *                gcc -O2 -DMCUBOOT_IMAGE -DIMAGE_AUTH_HOST -I. -Ihost -I<mbedtls>/include \
+ *                    image_auth.c crc32c.c host/image_flash_host.c host/image_auth_bench.c \
+ *                    -L<mbedtls>/library -lmbedcrypto -o image_auth_bench
+ *
+ *              Usage:
+ *                image_auth_bench [-n <iterations>] -k <key hash> <image.bin|image.hex>
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "psa/crypto.h"
+#include "image_auth.h"
+#include "crc32c.h"
+#include "image_flash_host.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+#define BENCH_MIN_SIZE              (0x1000u)
+#define BENCH_DEFAULT_ITERATIONS    (100u)
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+/* TLVs of the benchmarked image */
+static const uint8_t *bench_hash;
+static const uint8_t *bench_key;
+static const uint8_t *bench_sig;
+static uint16_t bench_key_len;
+static uint16_t bench_sig_len;
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static double now_usec(void);
+static void report(const char *metric, uint32_t size, uint32_t iterations, double usec);
+static int find_tlvs(const struct image_flash *fl);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static double now_usec(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((double)ts.tv_sec * 1e6) + ((double)ts.tv_nsec / 1e3);
+}
+
+/*******************************************************************************
+* Function Name: report
+********************************************************************************
+* Summary:
+*  Prints one CSV result line: metric,size,iterations,usec_per_op,mb_per_s.
+*  The throughput column is only meaningful for size dependent metrics.
+*
+*******************************************************************************/
+static void report(const char *metric, uint32_t size, uint32_t iterations, double usec)
+{
+    double per_op = usec / (double)iterations;
+    double mbps = ((size != 0u) && (per_op > 0.0)) ? ((double)size / per_op) : 0.0;
+
+    printf("%s,%u,%u,%.3f,%.3f\n", metric, (unsigned int)size, (unsigned int)iterations, per_op, mbps);
+}
+
+static int find_tlvs(const struct image_flash *fl)
+{
+    const struct image_header *hdr;
+    const struct image_tlv_entry *tlv;
+    struct image_tlv_index idx;
+
+    hdr = (const struct image_header *)fl->map(fl, 0u, sizeof(struct image_header));
+    if ((hdr == NULL) || (tlv_index_build(&idx, fl, hdr) != 0))
+    {
+        return -1;
+    }
+
+    if ((tlv = tlv_index_find(&idx, IMAGE_TLV_SHA256)) != NULL)
+    {
+        bench_hash = fl->map(fl, tlv->off, tlv->len);
+    }
+    if ((tlv = tlv_index_find(&idx, IMAGE_TLV_PUBKEY)) != NULL)
+    {
+        bench_key = fl->map(fl, tlv->off, tlv->len);
+        bench_key_len = tlv->len;
+    }
+    if ((tlv = tlv_index_find(&idx, IMAGE_TLV_ECDSA256)) != NULL)
+    {
+        bench_sig = fl->map(fl, tlv->off, tlv->len);
+        bench_sig_len = tlv->len;
+    }
+
+    return ((bench_hash != NULL) && (bench_key != NULL) && (bench_sig != NULL)) ? 0 : -1;
+}
+
+int main(int argc, char *argv[])
+{
+    psa_key_attributes_t attr = PSA_KEY_ATTRIBUTES_INIT;
+    psa_key_id_t key_id = 0;
+    struct image_flash_host h;
+    const char *key_hash = NULL;
+    uint32_t iterations = BENCH_DEFAULT_ITERATIONS;
+    uint8_t *buf;
+    uint8_t digest[32];
+    volatile uint32_t crc = 0u;
+    size_t digest_len;
+    uint32_t size;
+    uint32_t i;
+    double start;
+    int arg;
+
+    for (arg = 1; (arg < argc) && (argv[arg][0] == '-'); arg++)
+    {
+        if ((strcmp(argv[arg], "-n") == 0) && ((arg + 1) < argc))
+        {
+            iterations = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else if ((strcmp(argv[arg], "-k") == 0) && ((arg + 1) < argc))
+        {
+            key_hash = argv[++arg];
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if ((arg != (argc - 1)) || (key_hash == NULL) || (iterations == 0u))
+    {
+        fprintf(stderr, "usage: %s [-n <iterations>] -k <key hash> <image>\n", argv[0]);
+        return 2;
+    }
+
+    if ((psa_crypto_init() != PSA_SUCCESS) || (image_flash_host_open(&h, argv[arg]) != 0) ||
+        (image_flash_host_set_key_hash(&h, 0u, key_hash) != 0) || (find_tlvs(&h.fl) != 0))
+    {
+        fprintf(stderr, "cannot load %s\n", argv[arg]);
+        return 2;
+    }
+
+    /* Hash input does not have to be a valid image */
+    buf = malloc(IMAGE_SLOT_SIZE);
+    if (buf == NULL)
+    {
+        return 2;
+    }
+    for (i = 0u; i < IMAGE_SLOT_SIZE; i++)
+    {
+        buf[i] = (uint8_t)(i * 31u);
+    }
+
+    printf("metric,size,iterations,usec_per_op,mb_per_s\n");
+
+    /* Warm up caches and the crypto library before the first measurement */
+    (void)psa_hash_compute(PSA_ALG_SHA_256, buf, IMAGE_SLOT_SIZE, digest, sizeof(digest), &digest_len);
+
+    for (size = BENCH_MIN_SIZE; size <= IMAGE_SLOT_SIZE; size *= 2u)
+    {
+        start = now_usec();
+        for (i = 0u; i < iterations; i++)
+        {
+            (void)psa_hash_compute(PSA_ALG_SHA_256, buf, size, digest, sizeof(digest), &digest_len);
+        }
+        report("sha256", size, iterations, now_usec() - start);
+    }
+
+    for (size = BENCH_MIN_SIZE; size <= IMAGE_SLOT_SIZE; size *= 2u)
+    {
+        start = now_usec();
+        for (i = 0u; i < iterations; i++)
+        {
+            crc = crc32c_update(crc, buf, size);
+        }
+        report("crc32c", size, iterations, now_usec() - start);
+    }
+
+    start = now_usec();
+    for (i = 0u; i < iterations; i++)
+    {
+        if (is_pub_key_valid(&h.fl, bench_key) != 0)
+        {
+            fprintf(stderr, "public key does not match the key hash\n");
+            return 1;
+        }
+    }
+    report("is_pub_key_valid", 0u, iterations, now_usec() - start);
+
+    psa_set_key_usage_flags(&attr, PSA_KEY_USAGE_VERIFY_HASH);
+    psa_set_key_algorithm(&attr, PSA_ALG_ECDSA(PSA_ALG_SHA_256));
+    psa_set_key_type(&attr, PSA_KEY_TYPE_ECC_PUBLIC_KEY(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&attr, ECC_KEY_BITS);
+
+    start = now_usec();
+    for (i = 0u; i < iterations; i++)
+    {
+        (void)psa_import_key(&attr, bench_key, bench_key_len, &key_id);
+        (void)psa_destroy_key(key_id);
+    }
+    report("psa_import_key", 0u, iterations, now_usec() - start);
+
+    if (psa_import_key(&attr, bench_key, bench_key_len, &key_id) != PSA_SUCCESS)
+    {
+        return 1;
+    }
+    start = now_usec();
+    for (i = 0u; i < iterations; i++)
+    {
+        if (psa_verify_hash(key_id, PSA_ALG_ECDSA(PSA_ALG_SHA_256), bench_hash,
+                            PSA_HASH_LENGTH(PSA_ALG_SHA_256), bench_sig, bench_sig_len) != PSA_SUCCESS)
+        {
+            fprintf(stderr, "signature verification failed\n");
+            return 1;
+        }
+    }
+    report("ecdsa_p256_verify", 0u, iterations, now_usec() - start);
+    (void)psa_destroy_key(key_id);
+
+    start = now_usec();
+    for (i = 0u; i < iterations; i++)
+    {
+        if (validate_image_flash(&h.fl) != 0)
+        {
+            fprintf(stderr, "image validation failed\n");
+            return 1;
+        }
+    }
+    report("validate_image", h.fl.size, iterations, now_usec() - start);
+    image_auth_keys_release();
+
+    free(buf);
+    image_flash_host_close(&h);
+
+    return 0;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,331 @@
+/*****************************************************************************
+ * File Name:   image_flash_host.c
+ *
+ * Description: This file provides the host (Linux) flash backend for image
+ *              authentication.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "image_flash_host.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+/* Value of erased flash, must match ERASED_VAL in postbuild.mk */
+#define HOST_ERASED_VAL             (0x00u)
+
+#define IHEX_REC_DATA               (0x00u)
+#define IHEX_REC_EOF                (0x01u)
+#define IHEX_REC_EXT_SEG_ADDR       (0x02u)
+#define IHEX_REC_EXT_LIN_ADDR       (0x04u)
+#define IHEX_MAX_DATA               (255u)
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static const uint8_t *image_flash_host_map(const struct image_flash *fl, uint32_t off, uint32_t len);
+static int hex_byte(const char *s, uint8_t *val);
+static int hex_decode(const char *hex, uint8_t *out, uint32_t len);
+static int image_flash_host_load_hex(struct image_flash_host *h, FILE *f);
+static int image_flash_host_map_bin(struct image_flash_host *h, int fd);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static const uint8_t *image_flash_host_map(const struct image_flash *fl, uint32_t off, uint32_t len)
+{
+    const struct image_flash_host *h = (const struct image_flash_host *)fl->ctx;
+
+    if ((off > fl->size) || (len > (fl->size - off)))
+    {
+        return NULL;
+    }
+
+    return &h->buf[off];
+}
+
+static int hex_byte(const char *s, uint8_t *val)
+{
+    unsigned int v = 0u;
+    int i;
+
+    for (i = 0; i < 2; i++)
+    {
+        if (!isxdigit((unsigned char)s[i]))
+        {
+            return -1;
+        }
+        v = (v << 4) | (unsigned int)(isdigit((unsigned char)s[i]) ? (s[i] - '0') : ((tolower((unsigned char)s[i]) - 'a') + 10));
+    }
+
+    *val = (uint8_t)v;
+    return 0;
+}
+
+static int hex_decode(const char *hex, uint8_t *out, uint32_t len)
+{
+    uint32_t i;
+
+    if (strlen(hex) != (2u * len))
+    {
+        return -1;
+    }
+
+    for (i = 0u; i < len; i++)
+    {
+        if (hex_byte(&hex[2u * i], &out[i]) != 0)
+        {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+* Function Name: image_flash_host_load_hex
+********************************************************************************
+* Summary:
+*  Loads an Intel HEX file into a slot sized buffer. The lowest address in the
+*  file is the start of the slot.
+*
+*******************************************************************************/
+static int image_flash_host_load_hex(struct image_flash_host *h, FILE *f)
+{
+    char line[16u + (2u * IHEX_MAX_DATA)];
+    uint8_t rec[5u + IHEX_MAX_DATA];
+    uint32_t upper = 0u;
+    uint32_t base = 0u;
+    int have_base = 0;
+    uint32_t addr;
+    uint32_t i;
+    uint32_t n;
+    uint8_t sum;
+
+    h->buf = malloc(IMAGE_SLOT_SIZE);
+    if (h->buf == NULL)
+    {
+        return -1;
+    }
+    memset(h->buf, HOST_ERASED_VAL, IMAGE_SLOT_SIZE);
+    h->len = IMAGE_SLOT_SIZE;
+
+    while (fgets(line, (int)sizeof(line), f) != NULL)
+    {
+        if (line[0] != ':')
+        {
+            continue;
+        }
+
+        /* Decode byte count, then the whole record including checksum */
+        if (hex_byte(&line[1], &rec[0]) != 0)
+        {
+            return -1;
+        }
+        n = 5u + rec[0];
+        sum = 0u;
+        for (i = 0u; i < n; i++)
+        {
+            if (hex_byte(&line[1u + (2u * i)], &rec[i]) != 0)
+            {
+                return -1;
+            }
+            sum = (uint8_t)(sum + rec[i]);
+        }
+        if (sum != 0u)
+        {
+            return -1;
+        }
+
+        switch (rec[3])
+        {
+            case IHEX_REC_DATA:
+                addr = upper + (((uint32_t)rec[1] << 8) | rec[2]);
+                if (!have_base)
+                {
+                    base = addr;
+                    have_base = 1;
+                }
+                if ((addr < base) || ((addr - base) > (IMAGE_SLOT_SIZE - rec[0])))
+                {
+                    fprintf(stderr, "hex record at 0x%08x is outside the slot\n", (unsigned int)addr);
+                    return -1;
+                }
+                memcpy(&h->buf[addr - base], &rec[4], rec[0]);
+                break;
+
+            case IHEX_REC_EOF:
+                return have_base ? 0 : -1;
+
+            case IHEX_REC_EXT_SEG_ADDR:
+                upper = (((uint32_t)rec[4] << 8) | rec[5]) << 4;
+                break;
+
+            case IHEX_REC_EXT_LIN_ADDR:
+                upper = (((uint32_t)rec[4] << 8) | rec[5]) << 16;
+                break;
+
+            default:
+                /* Start address records are not needed */
+                break;
+        }
+    }
+
+    return -1;
+}
+
+static int image_flash_host_map_bin(struct image_flash_host *h, int fd)
+{
+    struct stat st;
+    void *p;
+
+    if ((fstat(fd, &st) != 0) || (st.st_size <= 0) || ((uint64_t)st.st_size > IMAGE_SLOT_SIZE))
+    {
+        return -1;
+    }
+
+    p = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED)
+    {
+        return -1;
+    }
+
+    h->buf = p;
+    h->len = (size_t)st.st_size;
+    h->mapped = 1;
+
+    return 0;
+}
+
+int image_flash_host_open(struct image_flash_host *h, const char *path)
+{
+    const char *ext;
+    FILE *f;
+    int fd;
+    int status;
+
+    memset(h, 0, sizeof(*h));
+
+    ext = strrchr(path, '.');
+    if ((ext != NULL) && (strcmp(ext, ".hex") == 0))
+    {
+        f = fopen(path, "r");
+        if (f == NULL)
+        {
+            return -1;
+        }
+        status = image_flash_host_load_hex(h, f);
+        fclose(f);
+    }
+    else
+    {
+        fd = open(path, O_RDONLY);
+        if (fd < 0)
+        {
+            return -1;
+        }
+        status = image_flash_host_map_bin(h, fd);
+        close(fd);
+    }
+
+    if (status != 0)
+    {
+        image_flash_host_close(h);
+        return -1;
+    }
+
+    h->fl.map = image_flash_host_map;
+    h->fl.ctx = h;
+    h->fl.addr = 0u;
+    h->fl.size = (uint32_t)h->len;
+
+    return 0;
+}
+
+int image_flash_host_set_key_hash(struct image_flash_host *h, uint32_t idx, const char *hex)
+{
+    if ((idx >= IMAGE_OEM_KEY_COUNT) || (hex_decode(hex, h->key_hash[idx], IMAGE_OEM_KEY_HASH_LEN) != 0))
+    {
+        return -1;
+    }
+    h->fl.key_hash[idx] = h->key_hash[idx];
+
+    return 0;
+}
+
+int image_flash_host_set_pub_key(struct image_flash_host *h, uint32_t idx, const char *hex)
+{
+    if ((idx >= IMAGE_OEM_KEY_COUNT) || (hex_decode(hex, h->pub_key[idx], IMAGE_OEM_PUB_KEY_LEN) != 0))
+    {
+        return -1;
+    }
+    h->fl.pub_key[idx] = h->pub_key[idx];
+
+    return 0;
+}
+
+void image_flash_host_close(struct image_flash_host *h)
+{
+    if (h->buf != NULL)
+    {
+        if (h->mapped)
+        {
+            (void)munmap(h->buf, h->len);
+        }
+        else
+        {
+            free(h->buf);
+        }
+    }
+    h->buf = NULL;
+    h->len = 0u;
+    h->mapped = 0;
+}
+
+/* [] END OF FILE */
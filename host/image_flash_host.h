@@ -0,0 +1,107 @@
+/*****************************************************************************
+ * File Name:   image_flash_host.h
+ *
+ * Description: This file contains the host (Linux) flash backend for image
+ *              authentication. It maps a signed slot image from a .bin or .hex file.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef IMAGE_FLASH_HOST_H_
+#define IMAGE_FLASH_HOST_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include "image_auth.h"
+
+/** Host flash backend. The embedded image_flash is passed to the verifier. */
+struct image_flash_host {
+    struct image_flash fl;
+    uint8_t *buf;           /* Slot contents */
+    size_t len;             /* Length of buf */
+    int mapped;             /* Non-zero if buf is a file mapping */
+    uint8_t key_hash[IMAGE_OEM_KEY_COUNT][IMAGE_OEM_KEY_HASH_LEN];
+    uint8_t pub_key[IMAGE_OEM_KEY_COUNT][IMAGE_OEM_PUB_KEY_LEN];
+};
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Open a signed slot image.
+ *
+ * A .hex file is loaded into memory relative to its lowest address. Any other
+ * file is treated as a raw slot image and mapped read-only with mmap().
+ *
+ * @param  h          The pointer to host backend structure to populate.
+ * @param  path       The path of the image file.
+ *
+ * @return 0 on success.
+ * @return -1 on failure.
+ */
+int image_flash_host_open(struct image_flash_host *h, const char *path);
+
+/**
+ * @brief Set an OEM public key hash used by is_pub_key_valid().
+ *
+ * @param  h          The pointer to host backend structure.
+ * @param  idx        The key slot, less than IMAGE_OEM_KEY_COUNT.
+ * @param  hex        The key hash as IMAGE_OEM_KEY_HASH_LEN hex encoded bytes.
+ *
+ * @return 0 on success.
+ * @return -1 on failure.
+ */
+int image_flash_host_set_key_hash(struct image_flash_host *h, uint32_t idx, const char *hex);
+
+/**
+ * @brief Set an OEM public key of the key store used for key hash TLVs.
+ *
+ * @param  h          The pointer to host backend structure.
+ * @param  idx        The key slot, less than IMAGE_OEM_KEY_COUNT.
+ * @param  hex        The uncompressed public key as IMAGE_OEM_PUB_KEY_LEN hex
+ *                    encoded bytes.
+ *
+ * @return 0 on success.
+ * @return -1 on failure.
+ */
+int image_flash_host_set_pub_key(struct image_flash_host *h, uint32_t idx, const char *hex);
+
+/**
+ * @brief Release the resources of an opened image.
+ *
+ * @param  h          The pointer to host backend structure.
+ */
+void image_flash_host_close(struct image_flash_host *h);
+
+#endif /* IMAGE_FLASH_HOST_H_ */
@@ -0,0 +1,254 @@
+/*****************************************************************************
+ * File Name:   image_verify.c
+ *
+ * Description: Host tool that verifies signed slot images with the same
+ *              image_auth.c code that runs on the device.
+ *
+ *              Build (mbedTLS 3.x with PSA crypto):
+ *                gcc -DMCUBOOT_IMAGE -DIMAGE_AUTH_HOST -I. -Ihost -I<mbedtls>/include \
+ *                    image_auth.c host/image_flash_host.c host/image_verify.c \
+ *                    -L<mbedtls>/library -lmbedcrypto -o image_verify
+ *
+ *              Usage:
+ *                image_verify -k <key0 hash> [-k <key1 hash>] <image.bin|image.hex>...
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "psa/crypto.h"
+#include "image_auth.h"
+#include "image_flash_host.h"
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static void usage(const char *prog);
+static double now_sec(void);
+static int validate_sliced(const struct image_flash *fl, uint32_t slice, uint32_t *steps, double *max_step);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s -k <key hash> [-k <key hash>] [-p <pub key>]... [-r <count>] [-s <bytes>] <image>...\n"
+                    "  -k  OEM public key hash as provisioned in SFLASH (%u hex bytes)\n"
+                    "  -p  OEM public key for images with a key hash TLV (%u hex bytes)\n"
+                    "  -r  Validate each image <count> times in a row (default 1)\n"
+                    "  -s  Validate through the resumable job, hashing <bytes> per step\n",
+                    prog, (unsigned int)IMAGE_OEM_KEY_HASH_LEN, (unsigned int)IMAGE_OEM_PUB_KEY_LEN);
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + ((double)ts.tv_nsec / 1e9);
+}
+
+/*******************************************************************************
+* Function Name: validate_sliced
+********************************************************************************
+* Summary:
+*  Drives a validation job to completion the way the firmware main loop does
+*  and records the number of steps and the longest step.
+*
+*******************************************************************************/
+static int validate_sliced(const struct image_flash *fl, uint32_t slice, uint32_t *steps, double *max_step)
+{
+    double start;
+    double step;
+    int status;
+
+    if (image_auth_job_start_flash(fl) != 0)
+    {
+        return -1;
+    }
+
+    do
+    {
+        start = now_sec();
+        status = image_auth_job_run(slice);
+        step = now_sec() - start;
+
+        (*steps)++;
+        if (step > *max_step)
+        {
+            *max_step = step;
+        }
+    } while (status == IMAGE_AUTH_JOB_PENDING);
+
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *key_hash[IMAGE_OEM_KEY_COUNT] = { NULL };
+    const char *pub_key[IMAGE_OEM_KEY_COUNT] = { NULL };
+    struct image_flash_host h;
+    uint32_t key_count = 0u;
+    uint32_t pub_key_count = 0u;
+    uint32_t repeat = 1u;
+    uint32_t slice = 0u;
+    uint32_t steps = 0u;
+    double max_step = 0.0;
+    uint32_t i;
+    uint32_t n;
+    int status;
+    int failed = 0;
+    int checked = 0;
+    int arg;
+    double start;
+    double elapsed;
+
+    for (arg = 1; arg < argc; arg++)
+    {
+        if ((strcmp(argv[arg], "-k") == 0) && ((arg + 1) < argc) && (key_count < IMAGE_OEM_KEY_COUNT))
+        {
+            key_hash[key_count++] = argv[++arg];
+        }
+        else if ((strcmp(argv[arg], "-p") == 0) && ((arg + 1) < argc) && (pub_key_count < IMAGE_OEM_KEY_COUNT))
+        {
+            pub_key[pub_key_count++] = argv[++arg];
+        }
+        else if ((strcmp(argv[arg], "-r") == 0) && ((arg + 1) < argc))
+        {
+            repeat = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else if ((strcmp(argv[arg], "-s") == 0) && ((arg + 1) < argc))
+        {
+            slice = (uint32_t)strtoul(argv[++arg], NULL, 0);
+        }
+        else if (argv[arg][0] == '-')
+        {
+            usage(argv[0]);
+            return 2;
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    if ((key_count == 0u) || (repeat == 0u) || (arg >= argc))
+    {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (psa_crypto_init() != PSA_SUCCESS)
+    {
+        fprintf(stderr, "psa_crypto_init failed\n");
+        return 2;
+    }
+
+    start = now_sec();
+    for (; arg < argc; arg++)
+    {
+        if (image_flash_host_open(&h, argv[arg]) != 0)
+        {
+            printf("ERROR %s\n", argv[arg]);
+            failed++;
+            continue;
+        }
+
+        for (i = 0u; i < key_count; i++)
+        {
+            if (image_flash_host_set_key_hash(&h, i, key_hash[i]) != 0)
+            {
+                fprintf(stderr, "invalid key hash: %s\n", key_hash[i]);
+                image_flash_host_close(&h);
+                return 2;
+            }
+        }
+
+        for (i = 0u; i < pub_key_count; i++)
+        {
+            if (image_flash_host_set_pub_key(&h, i, pub_key[i]) != 0)
+            {
+                fprintf(stderr, "invalid public key: %s\n", pub_key[i]);
+                image_flash_host_close(&h);
+                return 2;
+            }
+        }
+
+        /* Repeated runs must not use up PSA key slots */
+        for (n = 0u; n < repeat; n++)
+        {
+            status = (slice != 0u) ? validate_sliced(&h.fl, slice, &steps, &max_step) :
+                                     validate_image_flash(&h.fl);
+            if (status != 0)
+            {
+                break;
+            }
+        }
+
+        if (n == repeat)
+        {
+            printf("OK    %s\n", argv[arg]);
+        }
+        else
+        {
+            printf("FAIL  %s\n", argv[arg]);
+            failed++;
+        }
+        checked++;
+        image_flash_host_close(&h);
+    }
+    elapsed = now_sec() - start;
+
+    image_auth_keys_release();
+
+    printf("%d image(s), %d failed, %.1f validations/s\n", checked, failed,
+           (elapsed > 0.0) ? (((double)checked * repeat) / elapsed) : 0.0);
+    if (slice != 0u)
+    {
+        printf("%u step(s) of up to %u bytes, longest step %.1f us\n",
+               (unsigned int)steps, (unsigned int)slice, max_step * 1e6);
+    }
+
+    return (failed == 0) ? 0 : 1;
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,555 @@
+/*****************************************************************************
+ * File Name:   mtb_hal_nvm_sim.c
+ *
+ * Description: This file provides a simulated NVM for host (Linux) builds of
+ *              dfu_user.c with DFU_USER_HOST: the mtb_hal_nvm_* and
+ *              mtb_hal_system_critical_section_* calls and the non-blocking
+ *              Cy_Flash_Start*() calls of the flash driver. The two flash
+ *              banks live in a backing file mapped at the device addresses.
+ *              Erase and program times pass on a simulated clock, and chosen
+ *              operations can be made to fail, leaving a torn row or sector.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+/*******************************************************************************
+* Header Files
+*******************************************************************************/
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "mtb_hal_nvm_sim.h"
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+#ifndef MAP_FIXED_NOREPLACE
+#define MAP_FIXED_NOREPLACE         (0x100000)
+#endif
+
+#define NVM_SIM_FILE_SIZE           (2u * NVM_SIM_BANK_SIZE)
+#define NVM_SIM_REGION_MAX          (2u)
+
+/*******************************************************************************
+* Global Variables
+*******************************************************************************/
+
+volatile uint32_t nvm_sim_flash_ctl;
+
+static struct nvm_sim_cfg sim_cfg;
+static struct nvm_sim_stats sim_stats;
+static int sim_fd = -1;
+static uint64_t sim_now;                /* Simulated time in microseconds */
+static uint32_t sim_fail_count;         /* Operations of sim_cfg.fail_ops so far */
+static uint32_t sim_masked_depth;
+static uint64_t sim_masked_start;
+
+static mtb_hal_nvm_region_info_t sim_regions[NVM_SIM_REGION_MAX];
+static uint8_t sim_region_count;
+
+/* Operation started with Cy_Flash_Start*(), applied when it completes */
+static struct {
+    bool busy;
+    bool fail;
+    uint32_t op;
+    uint32_t addr;
+    const uint32_t *data;               /* Row data, read at completion as the flash does */
+    uint64_t done;                      /* Completion time */
+} sim_job;
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static uint32_t nvm_sim_op_size(uint32_t op);
+static bool nvm_sim_addr_valid(uint32_t op, uint32_t addr);
+static bool nvm_sim_fail_next(uint32_t op);
+static uint32_t nvm_sim_duration(uint32_t op);
+static void nvm_sim_apply(uint32_t op, uint32_t addr, const uint32_t *data, bool fail);
+static void nvm_sim_finish(void);
+static cy_rslt_t nvm_sim_run(uint32_t op, uint32_t addr, const uint32_t *data);
+static cy_en_flashdrv_status_t nvm_sim_start(uint32_t op, uint32_t addr, const uint32_t *data);
+static int nvm_sim_map(uint32_t addr, uint32_t size, uint32_t file_off);
+
+/*******************************************************************************
+* Function Definitions
+*******************************************************************************/
+
+static uint32_t nvm_sim_op_size(uint32_t op)
+{
+    return (op == NVM_SIM_OP_ERASE) ? sim_cfg.sector_size : CY_NVM_SIZEOF_ROW;
+}
+
+static bool nvm_sim_addr_valid(uint32_t op, uint32_t addr)
+{
+    uint32_t size = nvm_sim_op_size(op);
+    uint32_t idx;
+
+    for (idx = 0u; idx < sim_region_count; idx++)
+    {
+        const mtb_hal_nvm_region_info_t *r = &sim_regions[idx];
+        if ((addr >= r->start_address) && ((addr - r->start_address) < r->size))
+        {
+            return (((addr - r->start_address) % size) == 0u);
+        }
+    }
+
+    return false;
+}
+
+/*******************************************************************************
+* Function Name: nvm_sim_fail_next
+********************************************************************************
+* Summary:
+*  Counts an operation of sim_cfg.fail_ops and decides whether it fails:
+*  number fail_at and every fail_every after it.
+*
+*******************************************************************************/
+static bool nvm_sim_fail_next(uint32_t op)
+{
+    uint32_t n;
+
+    if ((sim_cfg.fail_at == 0u) || ((sim_cfg.fail_ops & NVM_SIM_OP_MASK(op)) == 0u))
+    {
+        return false;
+    }
+
+    n = ++sim_fail_count;
+    if (n < sim_cfg.fail_at)
+    {
+        return false;
+    }
+
+    return (n == sim_cfg.fail_at) ||
+           ((sim_cfg.fail_every != 0u) && (((n - sim_cfg.fail_at) % sim_cfg.fail_every) == 0u));
+}
+
+static uint32_t nvm_sim_duration(uint32_t op)
+{
+    uint32_t us = sim_cfg.sector_erase_us;
+
+    if (op == NVM_SIM_OP_WRITE)
+    {
+        us = sim_cfg.row_erase_us + sim_cfg.program_us;
+    }
+    else if (op == NVM_SIM_OP_PROGRAM)
+    {
+        us = sim_cfg.program_us;
+    }
+
+    return us;
+}
+
+/*******************************************************************************
+* Function Name: nvm_sim_apply
+********************************************************************************
+* Summary:
+*  Changes the flash contents for a completed operation. Programming clears
+*  bits only. A failed operation stops halfway: a row is left half programmed,
+*  a sector half erased.
+*
+*******************************************************************************/
+static void nvm_sim_apply(uint32_t op, uint32_t addr, const uint32_t *data, bool fail)
+{
+    uint8_t *dst = (uint8_t *)(uintptr_t)addr;
+    uint32_t size = nvm_sim_op_size(op);
+    uint32_t len = fail ? (size / 2u) : size;
+    uint32_t idx;
+
+    if (fail)
+    {
+        sim_stats.failed[op]++;
+    }
+
+    if (op == NVM_SIM_OP_ERASE)
+    {
+        memset(dst, NVM_SIM_ERASED, len);
+        return;
+    }
+
+    if (op == NVM_SIM_OP_WRITE)
+    {
+        memset(dst, NVM_SIM_ERASED, size);
+    }
+
+    for (idx = 0u; idx < len; idx++)
+    {
+        dst[idx] &= ((const uint8_t *)data)[idx];
+    }
+}
+
+/* Wait for the operation in flight, as the HAL does before its own */
+static void nvm_sim_finish(void)
+{
+    if (sim_job.busy)
+    {
+        if (sim_now < sim_job.done)
+        {
+            sim_now = sim_job.done;
+        }
+        nvm_sim_apply(sim_job.op, sim_job.addr, sim_job.data, sim_job.fail);
+        sim_job.busy = false;
+    }
+}
+
+/*******************************************************************************
+* Function Name: nvm_sim_run
+********************************************************************************
+* Summary:
+*  Runs a blocking operation of the HAL: the caller waits for its duration.
+*
+*******************************************************************************/
+static cy_rslt_t nvm_sim_run(uint32_t op, uint32_t addr, const uint32_t *data)
+{
+    uint32_t us;
+    bool fail;
+
+    if (!nvm_sim_addr_valid(op, addr))
+    {
+        sim_stats.rejected++;
+        return NVM_SIM_RSLT_ERR_ADDRESS;
+    }
+
+    nvm_sim_finish();
+
+    us = nvm_sim_duration(op);
+    fail = nvm_sim_fail_next(op);
+    sim_stats.ops[op]++;
+    sim_stats.busy_us += us;
+    sim_now += us;
+    nvm_sim_apply(op, addr, data, fail);
+
+    return fail ? NVM_SIM_RSLT_ERR_FAULT : CY_RSLT_SUCCESS;
+}
+
+/*******************************************************************************
+* Function Name: nvm_sim_start
+********************************************************************************
+* Summary:
+*  Starts a non-blocking operation of the flash driver. One operation runs at
+*  a time, as on the device.
+*
+*******************************************************************************/
+static cy_en_flashdrv_status_t nvm_sim_start(uint32_t op, uint32_t addr, const uint32_t *data)
+{
+    uint32_t us;
+
+    if (sim_job.busy || !nvm_sim_addr_valid(op, addr))
+    {
+        sim_stats.rejected++;
+        return CY_FLASH_DRV_ERR_UNC;
+    }
+
+    us = nvm_sim_duration(op);
+    sim_job.busy = true;
+    sim_job.fail = nvm_sim_fail_next(op);
+    sim_job.op = op;
+    sim_job.addr = addr;
+    sim_job.data = data;
+    sim_job.done = sim_now + us;
+    sim_stats.ops[op]++;
+    sim_stats.busy_us += us;
+
+    return CY_FLASH_DRV_OPERATION_STARTED;
+}
+
+static int nvm_sim_map(uint32_t addr, uint32_t size, uint32_t file_off)
+{
+    void *p = mmap((void *)(uintptr_t)addr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE,
+                   sim_fd, (off_t)file_off);
+
+    if (p == MAP_FAILED)
+    {
+        return -1;
+    }
+    if (p != (void *)(uintptr_t)addr)
+    {
+        /* Kernels before 4.17 take the address as a hint only */
+        (void)munmap(p, size);
+        return -1;
+    }
+
+    sim_regions[sim_region_count].start_address = addr;
+    sim_regions[sim_region_count].offset = 0u;
+    sim_regions[sim_region_count].size = size;
+    sim_regions[sim_region_count].sector_size = sim_cfg.sector_size;
+    sim_regions[sim_region_count].block_size = CY_NVM_SIZEOF_ROW;
+    sim_regions[sim_region_count].is_erase_required = true;
+    sim_regions[sim_region_count].erase_value = NVM_SIM_ERASED;
+    sim_region_count++;
+
+    return 0;
+}
+
+void nvm_sim_cfg_default(struct nvm_sim_cfg *cfg)
+{
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->path = "nvm_sim.bin";
+    cfg->dual_bank = true;
+    cfg->sector_size = 4096u;
+    cfg->program_us = 1000u;
+    cfg->row_erase_us = 3000u;
+    cfg->sector_erase_us = 4000u;
+    cfg->poll_us = 1u;
+}
+
+int nvm_sim_open(const struct nvm_sim_cfg *cfg)
+{
+    static uint8_t erased[CY_NVM_SIZEOF_ROW];
+    struct stat st;
+    off_t off;
+
+    if ((cfg->sector_size < CY_NVM_SIZEOF_ROW) || ((cfg->sector_size % CY_NVM_SIZEOF_ROW) != 0u) ||
+        ((NVM_SIM_BANK_SIZE % cfg->sector_size) != 0u))
+    {
+        fprintf(stderr, "nvm_sim: bad sector size %u\n", (unsigned int)cfg->sector_size);
+        return -1;
+    }
+
+    sim_cfg = *cfg;
+    memset(&sim_stats, 0, sizeof(sim_stats));
+    memset(&sim_job, 0, sizeof(sim_job));
+    sim_now = 0u;
+    sim_fail_count = 0u;
+    sim_masked_depth = 0u;
+    sim_region_count = 0u;
+
+    sim_fd = open(cfg->path, O_RDWR | O_CREAT, 0644);
+    if ((sim_fd < 0) || (fstat(sim_fd, &st) != 0))
+    {
+        perror(cfg->path);
+        nvm_sim_close();
+        return -1;
+    }
+
+    /* A new or short file is extended with erased flash */
+    memset(erased, NVM_SIM_ERASED, sizeof(erased));
+    for (off = st.st_size - (st.st_size % (off_t)sizeof(erased)); off < (off_t)NVM_SIM_FILE_SIZE;
+         off += (off_t)sizeof(erased))
+    {
+        if (pwrite(sim_fd, erased, sizeof(erased), off) != (ssize_t)sizeof(erased))
+        {
+            perror(cfg->path);
+            nvm_sim_close();
+            return -1;
+        }
+    }
+
+    nvm_sim_flash_ctl = 0u;
+    if (cfg->dual_bank)
+    {
+        uint32_t main_off = cfg->bank_mapping ? NVM_SIM_BANK_SIZE : 0u;
+
+        nvm_sim_flash_ctl |= FLASHC_FLASH_CTL_BANK_MODE_Msk;
+        if (cfg->bank_mapping)
+        {
+            nvm_sim_flash_ctl |= FLASHC_FLASH_CTL_BANK_MAPPING_Msk;
+        }
+
+        if ((nvm_sim_map(CY_FLASH_BASE, NVM_SIM_BANK_SIZE, main_off) != 0) ||
+            (nvm_sim_map(CY_DUAL_FLASH_S_SBUS_BASE, NVM_SIM_BANK_SIZE, NVM_SIM_BANK_SIZE - main_off) != 0))
+        {
+            perror("nvm_sim: mmap");
+            nvm_sim_close();
+            return -1;
+        }
+    }
+    else if (nvm_sim_map(CY_FLASH_BASE, NVM_SIM_FILE_SIZE, 0u) != 0)
+    {
+        perror("nvm_sim: mmap");
+        nvm_sim_close();
+        return -1;
+    }
+
+    return 0;
+}
+
+void nvm_sim_close(void)
+{
+    uint32_t idx;
+
+    nvm_sim_finish();
+
+    for (idx = 0u; idx < sim_region_count; idx++)
+    {
+        (void)munmap((void *)(uintptr_t)sim_regions[idx].start_address, sim_regions[idx].size);
+    }
+    sim_region_count = 0u;
+
+    if (sim_fd >= 0)
+    {
+        (void)close(sim_fd);
+        sim_fd = -1;
+    }
+}
+
+uint64_t nvm_sim_now_us(void)
+{
+    return sim_now;
+}
+
+void nvm_sim_advance(uint64_t us)
+{
+    sim_now += us;
+}
+
+void nvm_sim_stats_get(struct nvm_sim_stats *stats)
+{
+    *stats = sim_stats;
+}
+
+/*******************************************************************************
+* HAL and flash driver
+*******************************************************************************/
+
+void mtb_hal_nvm_get_info(mtb_hal_nvm_t *obj, mtb_hal_nvm_info_t *info)
+{
+    CY_UNUSED_PARAMETER(obj);
+
+    info->region_count = sim_region_count;
+    info->regions = sim_regions;
+}
+
+cy_rslt_t mtb_hal_nvm_read(mtb_hal_nvm_t *obj, uint32_t address, uint8_t *data, size_t size)
+{
+    uint32_t idx;
+
+    CY_UNUSED_PARAMETER(obj);
+
+    for (idx = 0u; idx < sim_region_count; idx++)
+    {
+        const mtb_hal_nvm_region_info_t *r = &sim_regions[idx];
+        if ((address >= r->start_address) && ((address - r->start_address) < r->size) &&
+            (size <= (r->size - (address - r->start_address))))
+        {
+            nvm_sim_finish();
+            memcpy(data, (const void *)(uintptr_t)address, size);
+            return CY_RSLT_SUCCESS;
+        }
+    }
+
+    sim_stats.rejected++;
+    return NVM_SIM_RSLT_ERR_ADDRESS;
+}
+
+cy_rslt_t mtb_hal_nvm_write(mtb_hal_nvm_t *obj, uint32_t address, const uint32_t *data)
+{
+    CY_UNUSED_PARAMETER(obj);
+    return nvm_sim_run(NVM_SIM_OP_WRITE, address, data);
+}
+
+cy_rslt_t mtb_hal_nvm_program(mtb_hal_nvm_t *obj, uint32_t address, const uint32_t *data)
+{
+    CY_UNUSED_PARAMETER(obj);
+    return nvm_sim_run(NVM_SIM_OP_PROGRAM, address, data);
+}
+
+cy_rslt_t mtb_hal_nvm_erase(mtb_hal_nvm_t *obj, uint32_t address)
+{
+    CY_UNUSED_PARAMETER(obj);
+    return nvm_sim_run(NVM_SIM_OP_ERASE, address, NULL);
+}
+
+cy_en_flashdrv_status_t Cy_Flash_StartWrite(uint32_t rowAddr, const uint32_t *data)
+{
+    return nvm_sim_start(NVM_SIM_OP_WRITE, rowAddr, data);
+}
+
+cy_en_flashdrv_status_t Cy_Flash_StartProgram(uint32_t rowAddr, const uint32_t *data)
+{
+    return nvm_sim_start(NVM_SIM_OP_PROGRAM, rowAddr, data);
+}
+
+cy_en_flashdrv_status_t Cy_Flash_StartEraseSector(uint32_t sectorAddr)
+{
+    return nvm_sim_start(NVM_SIM_OP_ERASE, sectorAddr, NULL);
+}
+
+/*******************************************************************************
+* Function Name: Cy_Flash_IsOperationComplete
+********************************************************************************
+* Summary:
+*  Each poll while the operation runs takes sim_cfg.poll_us of simulated time,
+*  so a caller that spins on it waits for the operation.
+*
+*******************************************************************************/
+cy_en_flashdrv_status_t Cy_Flash_IsOperationComplete(void)
+{
+    if (!sim_job.busy)
+    {
+        return CY_FLASH_DRV_SUCCESS;
+    }
+
+    if (sim_now < sim_job.done)
+    {
+        sim_now += sim_cfg.poll_us;
+        if (sim_now < sim_job.done)
+        {
+            return CY_FLASH_DRV_OPCODE_BUSY;
+        }
+    }
+
+    nvm_sim_apply(sim_job.op, sim_job.addr, sim_job.data, sim_job.fail);
+    sim_job.busy = false;
+
+    return sim_job.fail ? CY_FLASH_DRV_ERR_UNC : CY_FLASH_DRV_SUCCESS;
+}
+
+uint32_t mtb_hal_system_critical_section_enter(void)
+{
+    if (sim_masked_depth == 0u)
+    {
+        sim_masked_start = sim_now;
+    }
+    sim_masked_depth++;
+
+    return sim_masked_depth - 1u;
+}
+
+void mtb_hal_system_critical_section_exit(uint32_t old_state)
+{
+    sim_masked_depth = old_state;
+    if ((sim_masked_depth == 0u) && ((sim_now - sim_masked_start) > sim_stats.masked_max_us))
+    {
+        sim_stats.masked_max_us = sim_now - sim_masked_start;
+    }
+}
+
+/* [] END OF FILE */
@@ -0,0 +1,147 @@
+/*****************************************************************************
+ * File Name:   mtb_hal_nvm_sim.h
+ *
+ * Description: This file contains the interface of the simulated NVM used by
+ *              host (Linux) builds of dfu_user.c with DFU_USER_HOST.
+ *
+ ******************************************************************************
+ * Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ *****************************************************************************/
+
+#ifndef MTB_HAL_NVM_SIM_H_
+#define MTB_HAL_NVM_SIM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "dfu_user_host.h"
+
+/** Size of one flash bank, the backing file holds two */
+#define NVM_SIM_BANK_SIZE           (CY_DUAL_FLASH_S_SIZE)
+
+/** Value of erased bytes */
+#define NVM_SIM_ERASED              (0xFFu)
+
+/** Operations for nvm_sim_cfg.fail_ops and the statistics */
+#define NVM_SIM_OP_WRITE            (0u)    /* Row erase and program */
+#define NVM_SIM_OP_PROGRAM          (1u)    /* Program of an erased row */
+#define NVM_SIM_OP_ERASE            (2u)    /* Sector erase */
+#define NVM_SIM_OP_COUNT            (3u)
+
+#define NVM_SIM_OP_MASK(op)         (1u << (op))
+
+/** Results of the simulated HAL calls */
+#define NVM_SIM_RSLT_ERR_ADDRESS    ((cy_rslt_t)0x04E00001u)
+#define NVM_SIM_RSLT_ERR_FAULT      ((cy_rslt_t)0x04E00002u)
+
+/** Layout, timing and failures of the simulated NVM */
+struct nvm_sim_cfg {
+    const char *path;           /* Backing file, created erased when missing */
+    bool dual_bank;             /* FLASHC bank mode: two banks, the Alternate one at CY_DUAL_FLASH_S_SBUS_BASE */
+    bool bank_mapping;          /* FLASHC bank mapping: file bank 1 is the Main bank */
+    uint32_t sector_size;       /* Erase sector size in bytes */
+    uint32_t program_us;        /* Program time of an erased row */
+    uint32_t row_erase_us;      /* Erase time of a row ahead of its program */
+    uint32_t sector_erase_us;   /* Erase time of a sector */
+    uint32_t poll_us;           /* Time of one busy Cy_Flash_IsOperationComplete() */
+    uint32_t fail_ops;          /* NVM_SIM_OP_MASK() of the operations that can fail */
+    uint32_t fail_at;           /* 1-based number of the failing one of those, 0 for none */
+    uint32_t fail_every;        /* Period of further failures, 0 for a single one */
+};
+
+/** Counters since nvm_sim_open() */
+struct nvm_sim_stats {
+    uint32_t ops[NVM_SIM_OP_COUNT];     /* Started operations */
+    uint32_t failed[NVM_SIM_OP_COUNT];  /* Injected failures */
+    uint32_t rejected;          /* Calls with a bad address or while an operation was in flight */
+    uint64_t busy_us;           /* Time the flash was busy */
+    uint64_t masked_max_us;     /* Longest critical section */
+};
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+/**
+ * @brief Fill a configuration with the defaults.
+ *
+ * Dual bank mode with the default mapping, 4 KB sectors and the row times of
+ * host/dfu_write_sim.c. No failures are injected.
+ *
+ * @param  cfg        The configuration to fill.
+ */
+void nvm_sim_cfg_default(struct nvm_sim_cfg *cfg);
+
+/**
+ * @brief Map the backing file at the flash addresses.
+ *
+ * The banks are mapped at CY_FLASH_BASE and CY_DUAL_FLASH_S_SBUS_BASE, so the
+ * code under test reads the flash through plain pointers as on the device.
+ * Writes through the HAL and flash driver calls reach the file. Resets the
+ * simulated time and the statistics.
+ *
+ * @param  cfg        The configuration, copied.
+ *
+ * @return 0 on success.
+ * @return -1 on failure, e.g. the addresses are taken.
+ */
+int nvm_sim_open(const struct nvm_sim_cfg *cfg);
+
+/**
+ * @brief Complete the operation in flight and unmap the backing file.
+ */
+void nvm_sim_close(void);
+
+/**
+ * @brief Get the simulated time.
+ *
+ * @return Microseconds since nvm_sim_open()
+ */
+uint64_t nvm_sim_now_us(void);
+
+/**
+ * @brief Let simulated time pass outside the NVM calls, e.g. while a packet is
+ * received. An operation started before keeps running meanwhile.
+ *
+ * @param  us         Microseconds to pass.
+ */
+void nvm_sim_advance(uint64_t us);
+
+/**
+ * @brief Get the counters since nvm_sim_open().
+ *
+ * @param  stats      The counters to fill.
+ */
+void nvm_sim_stats_get(struct nvm_sim_stats *stats);
+
+#endif /* MTB_HAL_NVM_SIM_H_ */
+
+/* [] END OF FILE */
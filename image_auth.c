@@ -41,37 +41,234 @@
 *******************************************************************************/
 
 #include <string.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include "image_auth.h"
+#if !defined (MCUBOOT_IMAGE)
+#include "crc32c.h"
+#endif /* !MCUBOOT_IMAGE */
 #if defined (MCUBOOT_IMAGE)
 #include "mbedtls/ecdsa.h"
 #include "psa/crypto.h"
+#if !defined (IMAGE_AUTH_HOST)
+#include "cy_dfu.h"
+#include "dfu_nvm.h"
+#endif /* !IMAGE_AUTH_HOST */
+#if defined (IMAGE_KEYHASH_TLV)
+#include "oem_pub_keys.h"
+#endif /* IMAGE_KEYHASH_TLV */
+#endif /* MCUBOOT_IMAGE */
+
+/*******************************************************************************
+* Macros
+*******************************************************************************/
+
+#define IMG_JOB_IDLE                (0u)    /* No validation job */
+#define IMG_JOB_PREPARE             (1u)    /* Header, TLV and key checks */
+#define IMG_JOB_HASH                (2u)    /* Hashing the image in slices */
+#define IMG_JOB_VERIFY              (3u)    /* Signature verification */
+
+#if defined (MCUBOOT_IMAGE)
+#define IMG_STREAM_IDLE             (0u)    /* No stream in progress */
+#define IMG_STREAM_ACTIVE           (1u)    /* Rows are being hashed in order */
+#define IMG_STREAM_DONE             (2u)    /* Header and body fully hashed */
+#define IMG_STREAM_BROKEN           (3u)    /* Out-of-order write, hash the slot */
+
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+/* Streaming hash of the image being written to the slot */
+static struct {
+    psa_hash_operation_t op;
+    uint32_t next;      /* Next expected slot offset */
+    uint32_t total;     /* Number of bytes covered by the image hash */
+    uint8_t state;
+} img_stream = { PSA_HASH_OPERATION_INIT, 0u, 0u, IMG_STREAM_IDLE };
+
+/* Per-sector digests of the image body being written to the slot */
+static struct {
+    psa_hash_operation_t op;
+    uint32_t base;          /* Slot offset of sector 0, 0 if sectors are not tracked */
+    uint32_t end;           /* Slot offset of the end of the image body */
+    uint32_t prot_end;      /* Slot offset of the end of the protected TLV area */
+    uint32_t count;         /* Number of sectors of the image body */
+    uint32_t cur;           /* Sector being hashed, IMAGE_SECTOR_COUNT if none */
+    uint32_t next;          /* Next expected slot offset of the current sector */
+    uint32_t done;          /* Bitmap of hashed sectors */
+    uint32_t bad;           /* Bitmap of sectors that do not match the table */
+    const uint8_t *table;   /* Sector digests in the slot, NULL until written */
+    uint8_t digest[IMAGE_SECTOR_COUNT][IMAGE_SECTOR_HASH_LEN];
+} img_sectors = { .op = PSA_HASH_OPERATION_INIT, .cur = IMAGE_SECTOR_COUNT };
+
+/* Resumable validation job */
+static struct {
+    struct image_flash fl;
+    struct image_tlv_index idx;
+    psa_hash_operation_t op;
+    const struct image_header *hdr;
+    const uint8_t *img_hash;
+    const uint8_t *sig;
+    uint16_t sig_len;
+    psa_key_id_t key_id;
+    uint32_t off;       /* Next image offset to hash */
+    uint32_t total;     /* Number of bytes covered by the image hash */
+    uint8_t state;
+} img_job = { .op = PSA_HASH_OPERATION_INIT, .state = IMG_JOB_IDLE };
+
+#if (IMAGE_AUTH_CACHE != 0u)
+/* Row buffer used to program the metadata row */
+static uint32_t img_meta_row[IMAGE_META_ROW_SIZE / sizeof(uint32_t)];
+
+/* Set once the metadata row of the slot is known not to hold a record */
+static bool img_cache_clear = false;
+#endif /* IMAGE_AUTH_CACHE */
+
+/* Public keys imported per OEM key hash slot */
+static struct {
+    psa_key_id_t id;                            /* 0 if the slot holds no key */
+    uint8_t key[IMAGE_OEM_PUB_KEY_LEN];
+    uint8_t key_hash[IMAGE_OEM_KEY_HASH_LEN];   /* Provisioned hash it matched */
+    uint8_t key_digest[IMAGE_KEYHASH_LEN];      /* Key hash TLV value of the key */
+} img_keys[IMAGE_OEM_KEY_COUNT];
+
+#if defined (IMAGE_KEYHASH_TLV)
+/* OEM public keys for images signed with a key hash TLV */
+static const uint8_t img_oem_pub_key[IMAGE_OEM_KEY_COUNT][IMAGE_OEM_PUB_KEY_LEN] = {
+    OEM_PUB_KEY_0,
+    OEM_PUB_KEY_1
+};
+#endif /* IMAGE_KEYHASH_TLV */
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static const uint8_t *image_flash_device_map(const struct image_flash *fl, uint32_t off, uint32_t len);
+#if !defined (IMAGE_AUTH_HOST)
+static int image_flash_device_program(const struct image_flash *fl, uint32_t off, const uint8_t *row);
+#endif /* !IMAGE_AUTH_HOST */
+#if (IMAGE_AUTH_CACHE != 0u)
+static bool image_auth_ct_equal(const uint8_t *a, const uint8_t *b, uint32_t len);
+static int image_auth_cache_lookup(const struct image_flash *fl, const struct image_header *hdr, const struct image_tlv_index *idx);
+static void image_auth_cache_record(const struct image_flash *fl, const struct image_header *hdr, const uint8_t *digest);
+#endif /* IMAGE_AUTH_CACHE */
+static int img_hash_stream_finish(const struct image_flash *fl, const uint8_t *ref_hash, uint16_t len);
+static int img_sector_check(uint32_t sector);
+static int img_sector_table_load(void);
+static int image_auth_key_get(const struct image_flash *fl, const uint8_t *key, psa_key_id_t *key_id);
+static int image_auth_key_find(const struct image_flash *fl, const uint8_t *key_digest, psa_key_id_t *key_id);
+static int image_auth_job_prepare(void);
+static int image_auth_job_hash(uint32_t budget);
+#else
+/*******************************************************************************
+* Global variables
+*******************************************************************************/
+
+/* Validation job of an image without MCUBoot format */
+static struct {
+    uint32_t addr;      /* Start address of the image */
+    uint32_t off;       /* Next image offset to checksum */
+    uint32_t len;       /* Number of bytes covered by the trailer */
+    uint32_t crc;       /* CRC32C of the bytes checked so far */
+    uint32_t ref_crc;   /* CRC32C recorded in the trailer */
+    uint8_t state;
+} img_job = { .state = IMG_JOB_IDLE };
+
+/*******************************************************************************
+* Function Prototypes
+*******************************************************************************/
+
+static int image_vectors_valid(uint32_t boot_addr);
+static int image_crc_job_prepare(void);
 #endif /* MCUBOOT_IMAGE */
 
 /*******************************************************************************
 * Function Definitions
 *******************************************************************************/
 #if defined (MCUBOOT_IMAGE)
-int tlv_iter_begin(struct image_tlv_iter *it, const struct image_header *hdr)
+static const uint8_t *image_flash_device_map(const struct image_flash *fl, uint32_t off, uint32_t len)
 {
-    uint32_t off;
-    struct image_tlv_info *info;
+    if ((off > fl->size) || (len > (fl->size - off)))
+    {
+        return NULL;
+    }
+
+    return (const uint8_t *)(uintptr_t)(fl->addr + off);
+}
 
-    if (it == NULL || hdr == NULL)
+#if !defined (IMAGE_AUTH_HOST)
+static int image_flash_device_program(const struct image_flash *fl, uint32_t off, const uint8_t *row)
+{
+    /* The metadata row is the only row the verifier writes, and the host cannot */
+    if (off != IMAGE_META_OFFSET)
     {
-            return -1;
+        return -1;
     }
 
-    /* TLV start Offset */
-    off = hdr->ih_hdr_size + hdr->ih_img_size;
+    return (dfu_nvm_meta_write(fl->addr + off, row) == CY_DFU_SUCCESS) ? 0 : -1;
+}
+#endif /* !IMAGE_AUTH_HOST */
+
+void image_flash_device_init(struct image_flash *fl, uint32_t boot_addr)
+{
+    fl->map = image_flash_device_map;
+#if !defined (IMAGE_AUTH_HOST)
+    fl->program = image_flash_device_program;
+#else
+    fl->program = NULL;
+#endif /* !IMAGE_AUTH_HOST */
+    fl->ctx = NULL;
+    fl->addr = boot_addr;
+    fl->size = IMAGE_SLOT_SIZE;
+    fl->key_hash[0] = (const uint8_t *)(uintptr_t)SFLASH_OEM_KEY0_HASH_ADDR;
+    fl->key_hash[1] = (const uint8_t *)(uintptr_t)SFLASH_OEM_KEY1_HASH_ADDR;
+#if defined (IMAGE_KEYHASH_TLV)
+    fl->pub_key[0] = img_oem_pub_key[0];
+    fl->pub_key[1] = img_oem_pub_key[1];
+#else
+    fl->pub_key[0] = NULL;
+    fl->pub_key[1] = NULL;
+#endif /* IMAGE_KEYHASH_TLV */
+}
+
+uint32_t image_hashed_size(const struct image_header *hdr)
+{
+    return (uint32_t)hdr->ih_hdr_size + hdr->ih_img_size + hdr->ih_protect_tlv_size;
+}
+
+/*******************************************************************************
+* Function Name: tlv_iter_init
+********************************************************************************
+* Summary:
+*  Initializes a TLV iterator for the TLV area starting at the given offset.
+*  The whole area must be mapped by the flash backend.
+*
+* Parameters:
+*  it        - The pointer to TLV iterator structure.
+*  fl        - The pointer to flash backend holding the image.
+*  off       - The offset of the TLV area info header.
+*  magic     - The expected TLV area magic.
+*
+* Return:
+*  0 on success, -1 on failure.
+*
+*******************************************************************************/
+static int tlv_iter_init(struct image_tlv_iter *it, const struct image_flash *fl, uint32_t off, uint16_t magic)
+{
+    const struct image_tlv_info *info;
 
-    info = (struct image_tlv_info *)FLASH_ADDR(off);
+    info = (const struct image_tlv_info *)fl->map(fl, off, sizeof(struct image_tlv_info));
 
-    if (info->it_magic != IMAGE_TLV_INFO_MAGIC)
+    if ((info == NULL) || (info->it_magic != magic) ||
+        (info->it_tlv_tot < sizeof(struct image_tlv_info)) ||
+        (fl->map(fl, off, info->it_tlv_tot) == NULL))
     {
         return -1;
     }
 
+    it->fl = fl;
+
     /* Offset of 1st TLV */
     it->tlv_off = off + sizeof(struct image_tlv_info);
 
@@ -81,11 +278,22 @@ int tlv_iter_begin(struct image_tlv_iter *it, const struct image_header *hdr)
     return 0;
 }
 
+int tlv_iter_begin(struct image_tlv_iter *it, const struct image_flash *fl, const struct image_header *hdr)
+{
+    if (it == NULL || fl == NULL || hdr == NULL)
+    {
+            return -1;
+    }
+
+    /* TLV start Offset, after the protected TLV area */
+    return tlv_iter_init(it, fl, image_hashed_size(hdr), IMAGE_TLV_INFO_MAGIC);
+}
+
 int tlv_iter_next(struct image_tlv_iter *it, uint32_t *off, uint16_t *len, uint16_t *type)
 {
-    struct image_tlv *tlv;
+    const struct image_tlv *tlv;
 
-    if (it == NULL || off == NULL || len == NULL)
+    if (it == NULL || off == NULL || len == NULL || type == NULL)
     {
         return -1;
     }
@@ -96,7 +304,17 @@ int tlv_iter_next(struct image_tlv_iter *it, uint32_t *off, uint16_t *len, uint1
         return 1;
     }
 
-    tlv = (struct image_tlv *)FLASH_ADDR(it->tlv_off);
+    /* TLV header and data must lie inside the TLV area */
+    if ((it->tlv_end - it->tlv_off) < sizeof(struct image_tlv))
+    {
+        return -1;
+    }
+
+    tlv = (const struct image_tlv *)it->fl->map(it->fl, it->tlv_off, sizeof(struct image_tlv));
+    if ((tlv == NULL) || (tlv->it_len > (it->tlv_end - it->tlv_off - sizeof(struct image_tlv))))
+    {
+        return -1;
+    }
 
     /* Assign TLV values */
     *type = tlv->it_type;
@@ -109,6 +327,136 @@ int tlv_iter_next(struct image_tlv_iter *it, uint32_t *off, uint16_t *len, uint1
     return 0;
 }
 
+static int tlv_index_slot(uint16_t type)
+{
+    switch (type)
+    {
+        case IMAGE_TLV_PUBKEY:
+            return (int)IMAGE_TLV_SLOT_PUBKEY;
+        case IMAGE_TLV_SHA256:
+            return (int)IMAGE_TLV_SLOT_SHA256;
+        case IMAGE_TLV_ECDSA256:
+            return (int)IMAGE_TLV_SLOT_ECDSA256;
+        case IMAGE_TLV_KEYHASH:
+            return (int)IMAGE_TLV_SLOT_KEYHASH;
+        default:
+            return -1;
+    }
+}
+
+/*******************************************************************************
+* Function Name: tlv_index_add
+********************************************************************************
+* Summary:
+*  Records every TLV of one TLV area in the index.
+*
+* Return:
+*  0 on success, -1 on a malformed area or a duplicated TLV with lookup slot.
+*
+*******************************************************************************/
+static int tlv_index_add(struct image_tlv_index *idx, struct image_tlv_iter *it)
+{
+    struct image_tlv_entry *entry;
+    uint32_t off;
+    uint16_t len;
+    uint16_t type;
+    int slot;
+    int status;
+
+    while (1)
+    {
+        status = tlv_iter_next(it, &off, &len, &type);
+        if (status > 0)
+        {
+            return 0;
+        }
+        else if (status < 0)
+        {
+            return -1;
+        }
+
+        slot = tlv_index_slot(type);
+        if ((slot >= 0) && (idx->slot[slot] != 0u))
+        {
+            return -1;
+        }
+
+        if (idx->count >= IMAGE_TLV_INDEX_MAX)
+        {
+            /* Unknown TLVs are skipped once the index is full */
+            if (slot < 0)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        entry = &idx->entry[idx->count];
+        entry->off = off;
+        entry->type = type;
+        entry->len = len;
+        idx->count++;
+
+        if (slot >= 0)
+        {
+            idx->slot[slot] = idx->count;
+        }
+    }
+}
+
+int tlv_index_build(struct image_tlv_index *idx, const struct image_flash *fl, const struct image_header *hdr)
+{
+    struct image_tlv_iter it;
+    uint32_t off;
+
+    if (idx == NULL || fl == NULL || hdr == NULL)
+    {
+        return -1;
+    }
+
+    (void)memset(idx, 0, sizeof(struct image_tlv_index));
+
+    if (hdr->ih_protect_tlv_size != 0u)
+    {
+        /* Protected TLV area directly follows the image body */
+        off = (uint32_t)hdr->ih_hdr_size + hdr->ih_img_size;
+        if ((tlv_iter_init(&it, fl, off, IMAGE_TLV_PROT_INFO_MAGIC) != 0) ||
+            ((it.tlv_end - off) != hdr->ih_protect_tlv_size) ||
+            (tlv_index_add(idx, &it) != 0))
+        {
+            return -1;
+        }
+    }
+
+    if ((tlv_iter_begin(&it, fl, hdr) != 0) || (tlv_index_add(idx, &it) != 0))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+const struct image_tlv_entry *tlv_index_find(const struct image_tlv_index *idx, uint16_t type)
+{
+    int slot = tlv_index_slot(type);
+    uint32_t i;
+
+    if (slot >= 0)
+    {
+        return (idx->slot[slot] != 0u) ? &idx->entry[idx->slot[slot] - 1u] : NULL;
+    }
+
+    for (i = 0u; i < idx->count; i++)
+    {
+        if (idx->entry[i].type == type)
+        {
+            return &idx->entry[i];
+        }
+    }
+
+    return NULL;
+}
+
 int is_img_magic_valid(const struct image_header *hdr)
 {
     if(hdr->ih_magic != IMAGE_MAGIC)
@@ -119,11 +467,17 @@ int is_img_magic_valid(const struct image_header *hdr)
     return 0;
 }
 
-int is_pub_key_valid(uint8_t *key_addr)
+int is_pub_key_valid(const struct image_flash *fl, const uint8_t *key_addr)
+{
+    return (image_pub_key_slot(fl, key_addr) >= 0) ? 0 : -1;
+}
+
+int image_pub_key_slot(const struct image_flash *fl, const uint8_t *key_addr)
 {
     psa_status_t status;
     uint8_t key_hash[32];
     size_t hash_len;
+    uint32_t i;
 
     status = psa_hash_compute(PSA_ALG_SHA_256, (key_addr + 1), (size_t)64, key_hash, sizeof(key_hash), &hash_len);
     if(status != PSA_SUCCESS)
@@ -131,122 +485,1000 @@ int is_pub_key_valid(uint8_t *key_addr)
         return -1;
     }
 
-    if(0 == memcmp(key_hash, (uint8_t*)SFLASH_OEM_KEY0_HASH_ADDR, 16))
+    for (i = 0u; i < IMAGE_OEM_KEY_COUNT; i++)
     {
-        return 0;
+        if ((fl->key_hash[i] != NULL) &&
+            (0 == memcmp(key_hash, fl->key_hash[i], IMAGE_OEM_KEY_HASH_LEN)))
+        {
+            return (int)i;
+        }
     }
-    else if(0 == memcmp(key_hash, (uint8_t*)SFLASH_OEM_KEY1_HASH_ADDR, 16))
+
+    return -1;
+}
+
+/*******************************************************************************
+* Function Name: image_auth_key_get
+********************************************************************************
+* Summary:
+*  Returns the PSA key for an image public key. A key already imported for an
+*  OEM key hash slot is reused while the provisioned hash of that slot is
+*  unchanged, otherwise the key is checked against the OEM key hashes and
+*  imported into the matching slot.
+*
+* Parameters:
+*  fl        - The pointer to flash backend providing the OEM key hashes.
+*  key       - The pointer to public key of IMAGE_OEM_PUB_KEY_LEN bytes.
+*  key_id    - The pointer to store the PSA key identifier.
+*
+* Return:
+*  0 on success, -1 if the key is not trusted or cannot be imported.
+*
+*******************************************************************************/
+static int image_auth_key_get(const struct image_flash *fl, const uint8_t *key, psa_key_id_t *key_id)
+{
+    psa_key_attributes_t ec_key_attributes = PSA_KEY_ATTRIBUTES_INIT;
+    psa_status_t psa_status;
+    size_t hash_len;
+    uint32_t i;
+    int slot;
+
+    for (i = 0u; i < IMAGE_OEM_KEY_COUNT; i++)
     {
-        return 0;
+        if ((img_keys[i].id != 0u) && (fl->key_hash[i] != NULL) &&
+            (0 == memcmp(img_keys[i].key_hash, fl->key_hash[i], IMAGE_OEM_KEY_HASH_LEN)) &&
+            (0 == memcmp(img_keys[i].key, key, IMAGE_OEM_PUB_KEY_LEN)))
+        {
+            *key_id = img_keys[i].id;
+            return 0;
+        }
     }
-    else
+
+    slot = image_pub_key_slot(fl, key);
+    if (slot < 0)
     {
         return -1;
     }
-}
-
-#endif /* MCUBOOT_IMAGE */
 
-int validate_image(uint32_t boot_addr)
-{
-#if defined (MCUBOOT_IMAGE)
-    const struct image_header *hdr;
-    struct image_tlv_iter tlv_it;
-    uint8_t *img_hash = NULL;
-    uint32_t off;
-    uint16_t len;
-    uint16_t type;
-    int status;
-    psa_key_attributes_t ec_key_attributes = PSA_KEY_ATTRIBUTES_INIT;
-    psa_key_id_t key_id = 0;
-    psa_status_t psa_status;
+    /* A different key in this slot is only possible if the provisioned hash changed */
+    if (img_keys[slot].id != 0u)
+    {
+        (void)psa_destroy_key(img_keys[slot].id);
+        img_keys[slot].id = 0u;
+    }
 
-    hdr = (const struct image_header *)boot_addr;
+    psa_set_key_usage_flags(&ec_key_attributes, PSA_KEY_USAGE_VERIFY_HASH | PSA_KEY_USAGE_VERIFY_MESSAGE | PSA_KEY_USAGE_EXPORT);
+    psa_set_key_algorithm(&ec_key_attributes, PSA_ALG_ECDSA(PSA_ALG_SHA_256));
+    psa_set_key_lifetime(&ec_key_attributes, PSA_KEY_LIFETIME_VOLATILE);
+    psa_set_key_type(&ec_key_attributes, PSA_KEY_TYPE_ECC_PUBLIC_KEY(PSA_ECC_FAMILY_SECP_R1));
+    psa_set_key_bits(&ec_key_attributes, ECC_KEY_BITS);
 
-    status = is_img_magic_valid(hdr);
-    if (status != 0)
+    /* Value of a key hash TLV naming this key, for image_auth_key_find() */
+    psa_status = psa_hash_compute(PSA_ALG_SHA_256, key, IMAGE_OEM_PUB_KEY_LEN,
+                                  img_keys[slot].key_digest, sizeof(img_keys[slot].key_digest), &hash_len);
+    if(psa_status != PSA_SUCCESS)
     {
         return -1;
     }
 
-    status = tlv_iter_begin(&tlv_it, hdr);
-    if (status != 0)
+    psa_status = psa_import_key(&ec_key_attributes, key, IMAGE_OEM_PUB_KEY_LEN, &img_keys[slot].id);
+    if(psa_status != PSA_SUCCESS)
     {
+        img_keys[slot].id = 0u;
         return -1;
     }
 
-    while(1)
+    (void)memcpy(img_keys[slot].key, key, IMAGE_OEM_PUB_KEY_LEN);
+    (void)memcpy(img_keys[slot].key_hash, fl->key_hash[slot], IMAGE_OEM_KEY_HASH_LEN);
+    *key_id = img_keys[slot].id;
+
+    return 0;
+}
+
+/*******************************************************************************
+* Function Name: image_auth_key_find
+********************************************************************************
+* Summary:
+*  Returns the PSA key named by a key hash TLV. Keys already imported are
+*  matched without hashing. Otherwise the key store of the flash backend is
+*  searched and the matching key is imported by image_auth_key_get().
+*
+* Parameters:
+*  fl          - The pointer to flash backend providing the key store.
+*  key_digest  - The pointer to key hash TLV value of IMAGE_KEYHASH_LEN bytes.
+*  key_id      - The pointer to store the PSA key identifier.
+*
+* Return:
+*  0 on success, -1 if no trusted key matches.
+*
+*******************************************************************************/
+static int image_auth_key_find(const struct image_flash *fl, const uint8_t *key_digest, psa_key_id_t *key_id)
+{
+    uint8_t digest[IMAGE_KEYHASH_LEN];
+    size_t hash_len;
+    uint32_t i;
+
+    for (i = 0u; i < IMAGE_OEM_KEY_COUNT; i++)
     {
-        status = tlv_iter_next(&tlv_it, &off, &len, &type);
-        if (status > 0)
+        if ((img_keys[i].id != 0u) && (fl->key_hash[i] != NULL) &&
+            (0 == memcmp(img_keys[i].key_hash, fl->key_hash[i], IMAGE_OEM_KEY_HASH_LEN)) &&
+            (0 == memcmp(img_keys[i].key_digest, key_digest, IMAGE_KEYHASH_LEN)))
         {
-            /* All TLV traversed */
-            break;
+            *key_id = img_keys[i].id;
+            return 0;
         }
-        else if(status > 0)
+    }
+
+    for (i = 0u; i < IMAGE_OEM_KEY_COUNT; i++)
+    {
+        if ((fl->pub_key[i] != NULL) &&
+            (psa_hash_compute(PSA_ALG_SHA_256, fl->pub_key[i], IMAGE_OEM_PUB_KEY_LEN,
+                              digest, sizeof(digest), &hash_len) == PSA_SUCCESS) &&
+            (0 == memcmp(digest, key_digest, IMAGE_KEYHASH_LEN)))
         {
-            return -1;
+            return image_auth_key_get(fl, fl->pub_key[i], key_id);
         }
+    }
 
-        if (type == IMAGE_TLV_SHA256)
+    return -1;
+}
+
+void image_auth_keys_release(void)
+{
+    uint32_t i;
+
+    for (i = 0u; i < IMAGE_OEM_KEY_COUNT; i++)
+    {
+        if (img_keys[i].id != 0u)
         {
-            /* Compare hash of image with reference hash */
-            psa_status = psa_hash_compare(PSA_ALG_SHA_256, (uint8_t *)hdr, (size_t)((hdr->ih_img_size) + (hdr->ih_hdr_size)), (uint8_t*) FLASH_ADDR(off), len);
-            if(psa_status != PSA_SUCCESS)
-            {
-                return -1;
-            }
-            img_hash = (uint8_t*) FLASH_ADDR(off);
+            (void)psa_destroy_key(img_keys[i].id);
         }
+    }
 
-        else if (type == IMAGE_TLV_PUBKEY)
-        {
-            if(0 != is_pub_key_valid((uint8_t *)FLASH_ADDR(off)))
-            {
-                return -1;
-            }
+    (void)memset(img_keys, 0, sizeof(img_keys));
+}
 
-            psa_set_key_usage_flags(&ec_key_attributes, PSA_KEY_USAGE_VERIFY_HASH | PSA_KEY_USAGE_VERIFY_MESSAGE | PSA_KEY_USAGE_EXPORT);
-            psa_set_key_algorithm(&ec_key_attributes, PSA_ALG_ECDSA(PSA_ALG_SHA_256));
-            psa_set_key_lifetime(&ec_key_attributes, PSA_KEY_LIFETIME_VOLATILE);
-            psa_set_key_type(&ec_key_attributes, PSA_KEY_TYPE_ECC_PUBLIC_KEY(PSA_ECC_FAMILY_SECP_R1));
-            psa_set_key_bits(&ec_key_attributes, ECC_KEY_BITS);
+void img_hash_stream_reset(void)
+{
+    (void)psa_hash_abort(&img_stream.op);
+    img_stream.next = 0u;
+    img_stream.total = 0u;
+    img_stream.state = IMG_STREAM_IDLE;
+}
+
+void img_hash_stream_update(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    const struct image_header *hdr;
+    uint32_t off;
+    uint32_t n;
 
+    /* Only rows of the image slot contribute to the image hash */
+    if ((addr < FLASH_ADDR(0u)) || (addr >= FLASH_ADDR(IMAGE_SLOT_SIZE)))
+    {
+        return;
+    }
+    off = addr - FLASH_ADDR(0u);
 
-            psa_status = psa_import_key(&ec_key_attributes, (uint8_t *)FLASH_ADDR(off), len, &key_id);
-            if(psa_status != PSA_SUCCESS)
-            {
-                return -1;
-            }
-        }
+    if (off == 0u)
+    {
+        /* Header row, start a new stream */
+        img_hash_stream_reset();
 
-        else if (type == IMAGE_TLV_ECDSA256)
+        hdr = (const struct image_header *)data;
+        if ((len < sizeof(struct image_header)) || (is_img_magic_valid(hdr) != 0) ||
+            (psa_hash_setup(&img_stream.op, PSA_ALG_SHA_256) != PSA_SUCCESS))
         {
-            psa_status = psa_verify_hash(key_id, PSA_ALG_ECDSA(PSA_ALG_SHA_256), img_hash, PSA_HASH_LENGTH(PSA_ALG_SHA_256), (unsigned char *)FLASH_ADDR(off), len);
-            if(psa_status != PSA_SUCCESS)
-            {
-                return -1;
-            }
+            img_stream.state = IMG_STREAM_BROKEN;
+            return;
         }
-        else
+        img_stream.total = image_hashed_size(hdr);
+        img_stream.state = IMG_STREAM_ACTIVE;
+    }
+    else if (img_stream.state == IMG_STREAM_DONE)
+    {
+        /* Rows past the hashed area (TLVs) do not affect the stream */
+        if (off < img_stream.total)
         {
-            /* Invalid TLV type */
-            return -1;
+            img_hash_stream_reset();
+            img_stream.state = IMG_STREAM_BROKEN;
         }
+        return;
+    }
+    else if ((img_stream.state != IMG_STREAM_ACTIVE) || (off != img_stream.next))
+    {
+        if (img_stream.state == IMG_STREAM_ACTIVE)
+        {
+            img_hash_stream_reset();
+            img_stream.state = IMG_STREAM_BROKEN;
+        }
+        return;
     }
-    return 0;
-#else
-    uint32_t stack_pointer;
-    uint32_t reset_handler;
 
-    /* For images without MCUBoot format check if stack pointer and reset handler are non-zero */
-    stack_pointer = *(uint32_t*)boot_addr;
-    reset_handler = *(uint32_t*)(boot_addr + 4);
-    if ((stack_pointer == 0) || (reset_handler == 0))
+    n = img_stream.total - off;
+    if (n > len)
+    {
+        n = len;
+    }
+
+    if (psa_hash_update(&img_stream.op, data, n) != PSA_SUCCESS)
+    {
+        img_hash_stream_reset();
+        img_stream.state = IMG_STREAM_BROKEN;
+        return;
+    }
+
+    img_stream.next = off + len;
+    if (img_stream.next >= img_stream.total)
+    {
+        img_stream.state = IMG_STREAM_DONE;
+    }
+}
+
+void img_sector_reset(void)
+{
+    (void)psa_hash_abort(&img_sectors.op);
+    (void)memset(&img_sectors, 0, sizeof(img_sectors));
+    img_sectors.op = psa_hash_operation_init();
+    img_sectors.cur = IMAGE_SECTOR_COUNT;
+}
+
+/*******************************************************************************
+* Function Name: img_sector_check
+********************************************************************************
+* Summary:
+*  Compares the digest of a hashed sector with the sector hash table and
+*  updates the bad sector map.
+*
+* Return:
+*  0 if the sector matches or the table is not known yet, -1 on mismatch.
+*
+*******************************************************************************/
+static int img_sector_check(uint32_t sector)
+{
+    const uint8_t *ref;
+
+    if ((img_sectors.table == NULL) || ((img_sectors.done & (1uL << sector)) == 0u))
+    {
+        return 0;
+    }
+
+    ref = &img_sectors.table[sector * IMAGE_SECTOR_HASH_LEN];
+    if (0 != memcmp(ref, img_sectors.digest[sector], IMAGE_SECTOR_HASH_LEN))
     {
+        img_sectors.bad |= (1uL << sector);
         return -1;
     }
+
+    img_sectors.bad &= ~(1uL << sector);
     return 0;
+}
+
+/*******************************************************************************
+* Function Name: img_sector_table_load
+********************************************************************************
+* Summary:
+*  Looks for the sector hash table in the protected TLV area of the slot once
+*  that area has been written, and checks the sectors hashed so far.
+*
+* Return:
+*  0 if all hashed sectors match or no table is available, -1 otherwise.
+*
+*******************************************************************************/
+static int img_sector_table_load(void)
+{
+    struct image_flash fl;
+    struct image_tlv_iter it;
+    const struct image_sector_table *table;
+    uint32_t off;
+    uint32_t i;
+    uint16_t len;
+    uint16_t type;
+    int status = 0;
+
+    image_flash_device_init(&fl, FLASH_ADDR(0u));
+
+    if (tlv_iter_init(&it, &fl, img_sectors.end, IMAGE_TLV_PROT_INFO_MAGIC) != 0)
+    {
+        return 0;
+    }
+
+    while (tlv_iter_next(&it, &off, &len, &type) == 0)
+    {
+        if (type != IMAGE_TLV_SECTOR_HASH)
+        {
+            continue;
+        }
+
+        table = (const struct image_sector_table *)fl.map(&fl, off, len);
+        if ((table == NULL) || (table->sector_size != IMAGE_SECTOR_SIZE) ||
+            (len != (sizeof(struct image_sector_table) + (img_sectors.count * IMAGE_SECTOR_HASH_LEN))))
+        {
+            /* Table for another sector size, sectors are not checked */
+            return 0;
+        }
+        img_sectors.table = table->digest;
+
+        for (i = 0u; i < img_sectors.count; i++)
+        {
+            if (img_sector_check(i) != 0)
+            {
+                status = -1;
+            }
+        }
+        break;
+    }
+
+    return status;
+}
+
+int img_sector_update(uint32_t addr, const uint8_t *data, uint32_t len)
+{
+    const struct image_header *hdr;
+    psa_status_t psa_status;
+    uint32_t off;
+    uint32_t pos;
+    uint32_t sector;
+    uint32_t sector_end;
+    uint32_t n;
+    size_t hash_len;
+    uint8_t digest[PSA_HASH_LENGTH(PSA_ALG_SHA_256)];
+    int status = 0;
+
+    /* Only rows of the image slot carry sectors */
+    if ((addr < FLASH_ADDR(0u)) || (addr >= FLASH_ADDR(IMAGE_SLOT_SIZE)))
+    {
+        return 0;
+    }
+    off = addr - FLASH_ADDR(0u);
+
+    if (off == 0u)
+    {
+        /* Header row of a new image */
+        img_sector_reset();
+
+        hdr = (const struct image_header *)data;
+        if ((len < sizeof(struct image_header)) || (is_img_magic_valid(hdr) != 0) ||
+            (hdr->ih_protect_tlv_size == 0u) ||
+            (((uint32_t)hdr->ih_img_size + IMAGE_SECTOR_SIZE - 1u) / IMAGE_SECTOR_SIZE > IMAGE_SECTOR_COUNT))
+        {
+            return 0;
+        }
+        img_sectors.base = hdr->ih_hdr_size;
+        img_sectors.end = (uint32_t)hdr->ih_hdr_size + hdr->ih_img_size;
+        img_sectors.prot_end = image_hashed_size(hdr);
+        img_sectors.count = (hdr->ih_img_size + IMAGE_SECTOR_SIZE - 1u) / IMAGE_SECTOR_SIZE;
+    }
+
+    if (img_sectors.base == 0u)
+    {
+        return 0;
+    }
+
+    /* Hash the part of the row that belongs to the image body */
+    pos = (off > img_sectors.base) ? off : img_sectors.base;
+    while ((pos < (off + len)) && (pos < img_sectors.end))
+    {
+        sector = (pos - img_sectors.base) / IMAGE_SECTOR_SIZE;
+        sector_end = img_sectors.base + ((sector + 1u) * IMAGE_SECTOR_SIZE);
+        if (sector_end > img_sectors.end)
+        {
+            sector_end = img_sectors.end;
+        }
+
+        n = (((off + len) < sector_end) ? (off + len) : sector_end) - pos;
+
+        if (pos == (img_sectors.base + (sector * IMAGE_SECTOR_SIZE)))
+        {
+            /* First row of a sector, also when a sector is sent again */
+            (void)psa_hash_abort(&img_sectors.op);
+            img_sectors.done &= ~(1uL << sector);
+            img_sectors.cur = (psa_hash_setup(&img_sectors.op, PSA_ALG_SHA_256) == PSA_SUCCESS) ?
+                              sector : IMAGE_SECTOR_COUNT;
+        }
+        else if ((img_sectors.cur != sector) || (img_sectors.next != pos))
+        {
+            /* Rows of a sector must arrive in order */
+            (void)psa_hash_abort(&img_sectors.op);
+            img_sectors.cur = IMAGE_SECTOR_COUNT;
+        }
+
+        if (img_sectors.cur == sector)
+        {
+            psa_status = psa_hash_update(&img_sectors.op, &data[pos - off], n);
+            img_sectors.next = pos + n;
+
+            if ((psa_status == PSA_SUCCESS) && (img_sectors.next == sector_end))
+            {
+                psa_status = psa_hash_finish(&img_sectors.op, digest, sizeof(digest), &hash_len);
+                if (psa_status == PSA_SUCCESS)
+                {
+                    (void)memcpy(img_sectors.digest[sector], digest, IMAGE_SECTOR_HASH_LEN);
+                    img_sectors.done |= (1uL << sector);
+                    if (img_sector_check(sector) != 0)
+                    {
+                        status = -1;
+                    }
+                }
+                img_sectors.cur = IMAGE_SECTOR_COUNT;
+            }
+
+            if (psa_status != PSA_SUCCESS)
+            {
+                (void)psa_hash_abort(&img_sectors.op);
+                img_sectors.cur = IMAGE_SECTOR_COUNT;
+            }
+        }
+
+        pos += n;
+    }
+
+    /* The table is known once the protected TLV area has been written */
+    if ((img_sectors.table == NULL) && ((off + len) >= img_sectors.prot_end) &&
+        (img_sector_table_load() != 0))
+    {
+        status = -1;
+    }
+
+    return status;
+}
+
+uint32_t img_sector_bad_map(void)
+{
+    return img_sectors.bad;
+}
+
+/*******************************************************************************
+* Function Name: img_hash_stream_finish
+********************************************************************************
+* Summary:
+*  Finalizes the streaming hash and compares it with the reference hash.
+*  The stream is consumed by this call.
+*
+* Parameters:
+*  fl        - The pointer to flash backend holding the image.
+*  ref_hash  - The pointer to the reference hash.
+*  len       - The length of the reference hash.
+*
+* Return:
+*  0 if the stream matches, -1 if it does not match, 1 if the stream does not
+*  cover the image and the slot must be hashed instead.
+*
+*******************************************************************************/
+static int img_hash_stream_finish(const struct image_flash *fl, const uint8_t *ref_hash, uint16_t len)
+{
+    const struct image_header *hdr = (const struct image_header *)fl->map(fl, 0u, sizeof(struct image_header));
+    psa_status_t psa_status;
+
+    /* The stream only describes the device slot it was fed from */
+    if ((img_stream.state != IMG_STREAM_DONE) || (hdr == NULL) || (fl->addr != FLASH_ADDR(0u)) ||
+        (img_stream.total != image_hashed_size(hdr)))
+    {
+        img_hash_stream_reset();
+        return 1;
+    }
+
+    psa_status = psa_hash_verify(&img_stream.op, ref_hash, len);
+    img_hash_stream_reset();
+
+    return (psa_status == PSA_SUCCESS) ? 0 : -1;
+}
+
+#if (IMAGE_AUTH_CACHE != 0u)
+static bool image_auth_ct_equal(const uint8_t *a, const uint8_t *b, uint32_t len)
+{
+    uint8_t diff = 0u;
+    uint32_t i;
+
+    /* Runtime does not depend on the position of the first mismatch */
+    for (i = 0u; i < len; i++)
+    {
+        diff |= (uint8_t)(a[i] ^ b[i]);
+    }
+
+    return (diff == 0u);
+}
+
+/*******************************************************************************
+* Function Name: image_auth_cache_lookup
+********************************************************************************
+* Summary:
+*  Checks whether the metadata row records a successful validation of this
+*  image. The record must match the image header and dual bank counter and,
+*  with IMAGE_AUTH_CACHE_SPOT_CHECK, the hash TLV of the image.
+*
+* Return:
+*  0 on cache hit, -1 otherwise.
+*
+*******************************************************************************/
+static int image_auth_cache_lookup(const struct image_flash *fl, const struct image_header *hdr, const struct image_tlv_index *idx)
+{
+    const struct image_auth_cache *rec;
+    const uint32_t *ctr;
+#if (IMAGE_AUTH_CACHE_SPOT_CHECK != 0u)
+    const struct image_tlv_entry *tlv;
+    const uint8_t *digest = NULL;
+#else
+    (void)idx;
+#endif /* IMAGE_AUTH_CACHE_SPOT_CHECK */
+
+    rec = (const struct image_auth_cache *)fl->map(fl, IMAGE_META_OFFSET, sizeof(struct image_auth_cache));
+    ctr = (const uint32_t *)fl->map(fl, (uint32_t)hdr->ih_hdr_size + IMAGE_CTR_OFFSET, sizeof(uint32_t));
+
+    if ((rec == NULL) || (ctr == NULL) || (rec->magic != IMAGE_AUTH_CACHE_MAGIC) ||
+        (rec->check != (~IMAGE_AUTH_CACHE_MAGIC ^ rec->ctr)) || (rec->ctr != *ctr) ||
+        (memcmp(&rec->hdr, hdr, sizeof(struct image_header)) != 0))
+    {
+        return -1;
+    }
+
+#if (IMAGE_AUTH_CACHE_SPOT_CHECK != 0u)
+    tlv = tlv_index_find(idx, IMAGE_TLV_SHA256);
+    if ((tlv != NULL) && (tlv->len == sizeof(rec->digest)))
+    {
+        digest = fl->map(fl, tlv->off, tlv->len);
+    }
+    if ((digest == NULL) ||
+        !image_auth_ct_equal(digest, rec->digest, sizeof(rec->digest)))
+    {
+        return -1;
+    }
+#endif /* IMAGE_AUTH_CACHE_SPOT_CHECK */
+
+    return 0;
+}
+
+static void image_auth_cache_record(const struct image_flash *fl, const struct image_header *hdr, const uint8_t *digest)
+{
+    struct image_auth_cache *rec = (struct image_auth_cache *)img_meta_row;
+    const uint32_t *ctr;
+
+    ctr = (const uint32_t *)fl->map(fl, (uint32_t)hdr->ih_hdr_size + IMAGE_CTR_OFFSET, sizeof(uint32_t));
+    if ((fl->program == NULL) || (ctr == NULL) || (digest == NULL))
+    {
+        return;
+    }
+
+    (void)memset(img_meta_row, 0, sizeof(img_meta_row));
+    rec->magic = IMAGE_AUTH_CACHE_MAGIC;
+    rec->ctr = *ctr;
+    rec->hdr = *hdr;
+    (void)memcpy(rec->digest, digest, sizeof(rec->digest));
+    rec->check = ~IMAGE_AUTH_CACHE_MAGIC ^ rec->ctr;
+
+    if (fl->program(fl, IMAGE_META_OFFSET, (const uint8_t *)img_meta_row) == 0)
+    {
+        img_cache_clear = false;
+    }
+}
+#endif /* IMAGE_AUTH_CACHE */
+
+void image_auth_cache_invalidate(uint32_t addr)
+{
+#if (IMAGE_AUTH_CACHE != 0u)
+    struct image_flash fl;
+    const struct image_auth_cache *rec;
+
+    /* The metadata row itself is written by the cache only, DFU cannot write it */
+    if (img_cache_clear || (addr < FLASH_ADDR(0u)) || (addr >= FLASH_ADDR(IMAGE_META_OFFSET)))
+    {
+        return;
+    }
+
+    image_flash_device_init(&fl, FLASH_ADDR(0u));
+
+    rec = (const struct image_auth_cache *)fl.map(&fl, IMAGE_META_OFFSET, sizeof(struct image_auth_cache));
+    if ((rec != NULL) && (rec->magic == IMAGE_AUTH_CACHE_MAGIC))
+    {
+        if (fl.program == NULL)
+        {
+            return;
+        }
+
+        (void)memset(img_meta_row, 0, sizeof(img_meta_row));
+        if (fl.program(&fl, IMAGE_META_OFFSET, (const uint8_t *)img_meta_row) != 0)
+        {
+            return;
+        }
+    }
+
+    img_cache_clear = true;
+#else
+    (void)addr;
+#endif /* IMAGE_AUTH_CACHE */
+}
+
+/*******************************************************************************
+* Function Name: image_auth_job_prepare
+********************************************************************************
+* Summary:
+*  First step of a validation job. Checks the header, indexes the TLVs, looks
+*  up the verification cache and the signing key, and consumes the streaming
+*  hash if it covers the image.
+*
+* Return:
+*  0 if the job is finished (cache hit), IMAGE_AUTH_JOB_PENDING if the job
+*  continues, -1 on failure.
+*
+*******************************************************************************/
+static int image_auth_job_prepare(void)
+{
+    const struct image_flash *fl = &img_job.fl;
+    const struct image_header *hdr;
+    const struct image_tlv_entry *sha_tlv;
+    const struct image_tlv_entry *key_tlv;
+    const struct image_tlv_entry *sig_tlv;
+    const uint8_t *key;
+    uint16_t key_len;
+    int status;
+
+    hdr = (const struct image_header *)fl->map(fl, 0u, sizeof(struct image_header));
+    if (hdr == NULL)
+    {
+        return -1;
+    }
+
+    status = is_img_magic_valid(hdr);
+    if (status != 0)
+    {
+        return -1;
+    }
+    img_job.hdr = hdr;
+
+    /* Single pass over the TLV areas, TLV order does not matter */
+    status = tlv_index_build(&img_job.idx, fl, hdr);
+    if (status != 0)
+    {
+        return -1;
+    }
+
+#if (IMAGE_AUTH_CACHE != 0u)
+    /* Image unchanged since its last successful validation */
+    if (image_auth_cache_lookup(fl, hdr, &img_job.idx) == 0)
+    {
+        return 0;
+    }
+#endif /* IMAGE_AUTH_CACHE */
+
+    sha_tlv = tlv_index_find(&img_job.idx, IMAGE_TLV_SHA256);
+    sig_tlv = tlv_index_find(&img_job.idx, IMAGE_TLV_ECDSA256);
+    if ((sha_tlv == NULL) || (sig_tlv == NULL) || (sha_tlv->len != PSA_HASH_LENGTH(PSA_ALG_SHA_256)))
+    {
+        return -1;
+    }
+
+    /* The image names its key either in full or by the hash of the key */
+    key_tlv = tlv_index_find(&img_job.idx, IMAGE_TLV_PUBKEY);
+    key_len = IMAGE_OEM_PUB_KEY_LEN;
+    if (key_tlv == NULL)
+    {
+        key_tlv = tlv_index_find(&img_job.idx, IMAGE_TLV_KEYHASH);
+        key_len = IMAGE_KEYHASH_LEN;
+    }
+    if ((key_tlv == NULL) || (key_tlv->len != key_len))
+    {
+        return -1;
+    }
+
+    img_job.img_hash = fl->map(fl, sha_tlv->off, sha_tlv->len);
+    img_job.sig = fl->map(fl, sig_tlv->off, sig_tlv->len);
+    img_job.sig_len = sig_tlv->len;
+    key = fl->map(fl, key_tlv->off, key_tlv->len);
+    if ((img_job.img_hash == NULL) || (key == NULL) || (img_job.sig == NULL))
+    {
+        return -1;
+    }
+
+    /* Reject images signed with an unknown key before hashing the slot */
+    if (key_tlv->type == IMAGE_TLV_PUBKEY)
+    {
+        status = image_auth_key_get(fl, key, &img_job.key_id);
+    }
+    else
+    {
+        status = image_auth_key_find(fl, key, &img_job.key_id);
+    }
+    if (status != 0)
+    {
+        return -1;
+    }
+
+    /* Use the hash streamed during download, if it covers the image */
+    status = img_hash_stream_finish(fl, img_job.img_hash, sha_tlv->len);
+    if (status < 0)
+    {
+        return -1;
+    }
+    else if (status == 0)
+    {
+        img_job.state = IMG_JOB_VERIFY;
+        return IMAGE_AUTH_JOB_PENDING;
+    }
+
+    if (psa_hash_setup(&img_job.op, PSA_ALG_SHA_256) != PSA_SUCCESS)
+    {
+        return -1;
+    }
+    img_job.off = 0u;
+    img_job.total = image_hashed_size(hdr);
+    img_job.state = IMG_JOB_HASH;
+
+    return IMAGE_AUTH_JOB_PENDING;
+}
+
+/*******************************************************************************
+* Function Name: image_auth_job_hash
+********************************************************************************
+* Summary:
+*  Hashes at most budget bytes of the image and compares the digest with the
+*  hash TLV once the whole image is hashed.
+*
+* Return:
+*  IMAGE_AUTH_JOB_PENDING if the job continues, -1 on failure.
+*
+*******************************************************************************/
+static int image_auth_job_hash(uint32_t budget)
+{
+    const uint8_t *data;
+    uint32_t n;
+
+    n = img_job.total - img_job.off;
+    if (n > budget)
+    {
+        n = budget;
+    }
+
+    data = img_job.fl.map(&img_job.fl, img_job.off, n);
+    if ((data == NULL) || (psa_hash_update(&img_job.op, data, n) != PSA_SUCCESS))
+    {
+        return -1;
+    }
+    img_job.off += n;
+
+    if (img_job.off == img_job.total)
+    {
+        /* Compare hash of image with reference hash */
+        if (psa_hash_verify(&img_job.op, img_job.img_hash, PSA_HASH_LENGTH(PSA_ALG_SHA_256)) != PSA_SUCCESS)
+        {
+            return -1;
+        }
+        img_job.state = IMG_JOB_VERIFY;
+    }
+
+    return IMAGE_AUTH_JOB_PENDING;
+}
+
+int image_auth_job_start_flash(const struct image_flash *fl)
+{
+    if (fl == NULL)
+    {
+        return -1;
+    }
+
+    image_auth_job_abort();
+    img_job.fl = *fl;
+    img_job.state = IMG_JOB_PREPARE;
+
+    return 0;
+}
+
+int image_auth_job_start(uint32_t boot_addr)
+{
+    struct image_flash fl;
+
+    image_flash_device_init(&fl, boot_addr);
+
+    return image_auth_job_start_flash(&fl);
+}
+
+int image_auth_job_run(uint32_t budget)
+{
+    psa_status_t psa_status;
+    int status;
+
+    if (budget == 0u)
+    {
+        return -1;
+    }
+
+    switch (img_job.state)
+    {
+        case IMG_JOB_PREPARE:
+            status = image_auth_job_prepare();
+            break;
+
+        case IMG_JOB_HASH:
+            status = image_auth_job_hash(budget);
+            break;
+
+        case IMG_JOB_VERIFY:
+            psa_status = psa_verify_hash(img_job.key_id, PSA_ALG_ECDSA(PSA_ALG_SHA_256),
+                                         img_job.img_hash, PSA_HASH_LENGTH(PSA_ALG_SHA_256),
+                                         img_job.sig, img_job.sig_len);
+            status = (psa_status == PSA_SUCCESS) ? 0 : -1;
+#if (IMAGE_AUTH_CACHE != 0u)
+            if (status == 0)
+            {
+                image_auth_cache_record(&img_job.fl, img_job.hdr, img_job.img_hash);
+            }
+#endif /* IMAGE_AUTH_CACHE */
+            break;
+
+        default:
+            /* No job started */
+            status = -1;
+            break;
+    }
+
+    if (status != IMAGE_AUTH_JOB_PENDING)
+    {
+        image_auth_job_abort();
+    }
+
+    return status;
+}
+
+void image_auth_job_abort(void)
+{
+    (void)psa_hash_abort(&img_job.op);
+    img_job.state = IMG_JOB_IDLE;
+}
+
+int validate_image_flash(const struct image_flash *fl)
+{
+    int status;
+
+    if (image_auth_job_start_flash(fl) != 0)
+    {
+        return -1;
+    }
+
+    do
+    {
+        status = image_auth_job_run(IMAGE_AUTH_JOB_UNBOUNDED);
+    } while (status == IMAGE_AUTH_JOB_PENDING);
+
+    return status;
+}
+
+#else
+
+static int image_vectors_valid(uint32_t boot_addr)
+{
+    uint32_t stack_pointer;
+    uint32_t reset_handler;
+
+    /* For images without MCUBoot format check if stack pointer and reset handler are non-zero */
+    stack_pointer = *(const uint32_t *)(uintptr_t)boot_addr;
+    reset_handler = *(const uint32_t *)(uintptr_t)(boot_addr + 4u);
+    if ((stack_pointer == 0u) || (reset_handler == 0u))
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+/*******************************************************************************
+* Function Name: image_crc_job_prepare
+********************************************************************************
+* Summary:
+*  First step of a validation job for an image without MCUBoot format. Checks
+*  the CRC32C trailer in the metadata row.
+*
+* Return:
+*  IMAGE_AUTH_JOB_PENDING if the trailer is valid, -1 otherwise.
+*
+*******************************************************************************/
+static int image_crc_job_prepare(void)
+{
+    const struct image_crc_trailer *trailer;
+
+    trailer = (const struct image_crc_trailer *)(uintptr_t)(img_job.addr + IMAGE_META_OFFSET);
+    if ((trailer->magic != IMAGE_CRC_MAGIC) || (trailer->len == 0u) || (trailer->len > IMAGE_META_OFFSET) ||
+        (trailer->check != (~IMAGE_CRC_MAGIC ^ trailer->len ^ trailer->crc)))
+    {
+        return -1;
+    }
+
+    img_job.off = 0u;
+    img_job.len = trailer->len;
+    img_job.crc = 0u;
+    img_job.ref_crc = trailer->crc;
+    img_job.state = IMG_JOB_HASH;
+
+    return IMAGE_AUTH_JOB_PENDING;
+}
+
+int image_auth_job_start(uint32_t boot_addr)
+{
+    image_auth_job_abort();
+    img_job.addr = boot_addr;
+    img_job.state = IMG_JOB_PREPARE;
+
+    return 0;
+}
+
+int image_auth_job_run(uint32_t budget)
+{
+    uint32_t n;
+    int status;
+
+    if (budget == 0u)
+    {
+        return -1;
+    }
+
+    switch (img_job.state)
+    {
+        case IMG_JOB_PREPARE:
+            status = image_vectors_valid(img_job.addr);
+            if ((status == 0) && (IMAGE_CRC_CHECK != 0u))
+            {
+                status = image_crc_job_prepare();
+            }
+            break;
+
+        case IMG_JOB_HASH:
+            n = img_job.len - img_job.off;
+            if (n > budget)
+            {
+                n = budget;
+            }
+
+            img_job.crc = crc32c_update(img_job.crc, (const uint8_t *)(uintptr_t)(img_job.addr + img_job.off), n);
+            img_job.off += n;
+
+            status = IMAGE_AUTH_JOB_PENDING;
+            if (img_job.off == img_job.len)
+            {
+                /* A torn or corrupted transfer does not match the trailer */
+                status = (img_job.crc == img_job.ref_crc) ? 0 : -1;
+            }
+            break;
+
+        default:
+            /* No job started */
+            status = -1;
+            break;
+    }
+
+    if (status != IMAGE_AUTH_JOB_PENDING)
+    {
+        image_auth_job_abort();
+    }
+
+    return status;
+}
+
+void image_auth_job_abort(void)
+{
+    img_job.state = IMG_JOB_IDLE;
+}
+
+#endif /* MCUBOOT_IMAGE */
+
+int validate_image(uint32_t boot_addr)
+{
+#if defined (MCUBOOT_IMAGE)
+    struct image_flash fl;
+
+    image_flash_device_init(&fl, boot_addr);
+
+    return validate_image_flash(&fl);
+#else
+    int status;
+
+    if (image_auth_job_start(boot_addr) != 0)
+    {
+        return -1;
+    }
+
+    do
+    {
+        status = image_auth_job_run(IMAGE_AUTH_JOB_UNBOUNDED);
+    } while (status == IMAGE_AUTH_JOB_PENDING);
+
+    return status;
 #endif
 }
 
@@ -39,6 +39,7 @@
 #ifndef IMAGE_AUTH_H_
 #define IMAGE_AUTH_H_
 
+#include <stdint.h>
 #if defined(MCUBOOT_IMAGE)
 #include "psa/crypto.h"
 #endif /* MCUBOOT_IMAGE) */
@@ -47,18 +48,59 @@
 
 #define SLOT_OFFSET                 0x800000
 
+#define FLASH_ADDR(off)             (FLASH_SBUS_S_OFFSET + SLOT_OFFSET + (off))
+
+/** Size of the image slot in bytes. */
+#define IMAGE_SLOT_SIZE             (0x20000u)
+
+/** Image metadata row reserved by the linker scripts at the end of the slot. */
+#define IMAGE_META_ROW_SIZE         (0x200u)
+#define IMAGE_META_OFFSET           (IMAGE_SLOT_SIZE - IMAGE_META_ROW_SIZE)
+
+#if !defined(MCUBOOT_IMAGE)
+/** Check the CRC32C trailer of images without MCUBoot format. */
+#ifndef IMAGE_CRC_CHECK
+#define IMAGE_CRC_CHECK             (1u)
+#endif
+
+#define IMAGE_CRC_MAGIC             (0x43524343u)
+
+/**
+ * Integrity trailer of an image without MCUBoot format, stored at the start
+ * of the metadata row by postbuild.mk. All fields in little endian.
+ */
+struct image_crc_trailer {
+    uint32_t magic;     /* IMAGE_CRC_MAGIC */
+    uint32_t len;       /* Number of image bytes covered, from the slot start */
+    uint32_t crc;       /* CRC32C of the image bytes */
+    uint32_t check;     /* Inverted magic XOR len XOR crc */
+};
+#endif /* !MCUBOOT_IMAGE */
+
 #if defined(MCUBOOT_IMAGE)
 #define IMAGE_MAGIC                 0x96f3b83dU
 
 #define IMAGE_TLV_INFO_MAGIC        0x6907
 
-#define FLASH_ADDR(off)             (FLASH_SBUS_S_OFFSET + SLOT_OFFSET + (off))
+#define IMAGE_TLV_PROT_INFO_MAGIC   0x6908
 
 #define SFLASH_OEM_KEY0_HASH_ADDR   0x13400A38
 #define SFLASH_OEM_KEY1_HASH_ADDR   0x13400A48
 
 #define ECC_KEY_BITS                (256u)
 
+/** Number of OEM public key hash slots. */
+#define IMAGE_OEM_KEY_COUNT         (2u)
+
+/** Length of a provisioned OEM public key hash. */
+#define IMAGE_OEM_KEY_HASH_LEN      (16u)
+
+/** Length of an uncompressed P-256 public key (0x04 || X || Y). */
+#define IMAGE_OEM_PUB_KEY_LEN       (65u)
+
+/** Length of the key hash TLV (SHA-256 of the public key). */
+#define IMAGE_KEYHASH_LEN           (32u)
+
 
 /*
  * Image trailer TLV types.
@@ -71,12 +113,26 @@
  *   2nd one is the actual signature.
  */
 
+#define IMAGE_TLV_KEYHASH           (0x01)   /* hash of the public key */
+
 #define IMAGE_TLV_PUBKEY            (0x02)   /* public key */
 
 #define IMAGE_TLV_SHA256            (0x10)   /* SHA256 of image hdr and body */
 
 #define IMAGE_TLV_ECDSA256          (0x22)   /* ECDSA of hash output */
 
+#define IMAGE_TLV_SECTOR_HASH       (0xA0)   /* Per-sector hashes of image body */
+
+/** Maximum number of TLVs recorded in a TLV index. */
+#define IMAGE_TLV_INDEX_MAX         (8u)
+
+/** TLV types with a fixed lookup slot in the TLV index. */
+#define IMAGE_TLV_SLOT_PUBKEY       (0u)
+#define IMAGE_TLV_SLOT_SHA256       (1u)
+#define IMAGE_TLV_SLOT_ECDSA256     (2u)
+#define IMAGE_TLV_SLOT_KEYHASH      (3u)
+#define IMAGE_TLV_SLOT_COUNT        (4u)
+
 /** Image version.  All fields are in little endian. */
 struct image_version {
     uint8_t iv_major;
@@ -109,8 +165,95 @@ struct image_tlv {
     uint16_t it_len;    /* Data length (not including TLV header). */
 };
 
+/**
+ * Sector granularity of the sector hash TLV. Sector 0 starts at the image
+ * body, the last sector ends with the image body.
+ */
+#define IMAGE_SECTOR_SIZE           (0x1000u)
+#define IMAGE_SECTOR_COUNT          (IMAGE_SLOT_SIZE / IMAGE_SECTOR_SIZE)
+
+/** Length of each truncated SHA256 digest of the sector hash TLV. */
+#define IMAGE_SECTOR_HASH_LEN       (16u)
+
+#if (IMAGE_SECTOR_COUNT > 32u)
+#error "The bad sector map holds at most 32 sectors"
+#endif
+
+/** Offset of the dual bank counter (ctr) from the start of the image body. */
+#define IMAGE_CTR_OFFSET            (0x270u)
+
+/** Record verified images in the metadata row and skip re-hashing them. */
+#ifndef IMAGE_AUTH_CACHE
+#define IMAGE_AUTH_CACHE            (1u)
+#endif
+
+/** Compare the cached digest with the image hash TLV on a cache hit. */
+#ifndef IMAGE_AUTH_CACHE_SPOT_CHECK
+#define IMAGE_AUTH_CACHE_SPOT_CHECK (1u)
+#endif
+
+#define IMAGE_AUTH_CACHE_MAGIC      (0x43485356u)
+
+/**
+ * Image flash access backend.
+ *
+ * All reads done by the verifier go through this interface. Offsets are
+ * relative to the start of the image slot. The device backend maps the slot
+ * in place, host backends may map a file instead.
+ */
+struct image_flash {
+    /* Returns a pointer to len bytes at offset off, NULL if out of range */
+    const uint8_t *(*map)(const struct image_flash *fl, uint32_t off, uint32_t len);
+    /* Programs one IMAGE_META_ROW_SIZE row at offset off, NULL if read-only */
+    int (*program)(const struct image_flash *fl, uint32_t off, const uint8_t *row);
+    void *ctx;          /* Backend private data */
+    uint32_t addr;      /* Device address of the slot, 0 if not device flash */
+    uint32_t size;      /* Size of the mapped slot */
+    const uint8_t *key_hash[IMAGE_OEM_KEY_COUNT];   /* OEM public key hashes */
+    const uint8_t *pub_key[IMAGE_OEM_KEY_COUNT];    /* Key store for key hash TLVs, NULL if absent */
+};
+
+/** Verification cache record stored in the image metadata row. */
+struct image_auth_cache {
+    uint32_t magic;             /* IMAGE_AUTH_CACHE_MAGIC */
+    uint32_t ctr;               /* Dual bank counter of the verified image */
+    struct image_header hdr;    /* Header of the verified image */
+    uint8_t digest[32];         /* SHA256 of the verified image */
+    uint32_t check;             /* Inverted magic XOR counter */
+};
+
+/**
+ * Sector hash TLV data. Must be in the protected TLV area so it is covered by
+ * the image hash and therefore by the signature.
+ */
+struct image_sector_table {
+    uint32_t sector_size;       /* IMAGE_SECTOR_SIZE */
+    uint8_t digest[];           /* IMAGE_SECTOR_HASH_LEN bytes per sector */
+};
+
+/** Location of one TLV in the image. */
+struct image_tlv_entry {
+    uint32_t off;       /* Offset of TLV data from start of image */
+    uint16_t type;      /* IMAGE_TLV_[...]. */
+    uint16_t len;       /* Data length (not including TLV header). */
+};
+
+/**
+ * Index of the protected and unprotected TLV areas.
+ *
+ * Built in a single bounds-checked pass. TLV types with a lookup slot are
+ * found in constant time, other types are recorded while there is room and
+ * otherwise skipped, so unknown TLVs do not break older verifiers.
+ */
+struct image_tlv_index {
+    struct image_tlv_entry entry[IMAGE_TLV_INDEX_MAX];
+    uint8_t slot[IMAGE_TLV_SLOT_COUNT]; /* entry index + 1, 0 if absent */
+    uint8_t count;
+};
+
 /** Image trailer TLV iterator. */
 struct image_tlv_iter {
+    const struct image_flash *fl; /* Flash backend */
     uint32_t tlv_off; /* Next TLV offset*/
     uint32_t tlv_end; /* TLV END offset */
 };
@@ -119,6 +262,18 @@ struct image_tlv_iter {
 * Function Prototypes
 *******************************************************************************/
 
+/**
+ * @brief Initialize the device flash backend.
+ *
+ * With IMAGE_KEYHASH_TLV defined the backend also provides the OEM public
+ * keys from the generated oem_pub_keys.h, for images that carry a key hash
+ * TLV instead of the public key.
+ *
+ * @param  fl         The pointer to flash backend structure to populate.
+ * @param  boot_addr  The start address of the image slot.
+ */
+void image_flash_device_init(struct image_flash *fl, uint32_t boot_addr);
+
 /**
  * @brief TLV iterator initialization function.
  *
@@ -127,12 +282,13 @@ struct image_tlv_iter {
  *
  * @param  it         The pointer to tlv iterator structure. The function populates the
  *                    structure with address of first tlv offset and tlv end offset.
+ * @param  fl         The pointer to flash backend holding the image.
  * @param  hdr        The pointer to image header structure.
  *
  * @return  0 on success.
  * @return  -1 on failure.
  */
-int tlv_iter_begin(struct image_tlv_iter *it, const struct image_header *hdr);
+int tlv_iter_begin(struct image_tlv_iter *it, const struct image_flash *fl, const struct image_header *hdr);
 
 /**
  * @brief Next TLV function.
@@ -152,6 +308,41 @@ int tlv_iter_begin(struct image_tlv_iter *it, const struct image_header *hdr);
  */
 int tlv_iter_next(struct image_tlv_iter *it, uint32_t *off, uint16_t *len, uint16_t *type);
 
+/**
+ * @brief Build the TLV index of an image.
+ *
+ * Walks the protected and unprotected TLV areas once. Every TLV must lie
+ * inside its area and inside the slot. A TLV type with a lookup slot that
+ * occurs more than once makes the image invalid.
+ *
+ * @param  idx        The pointer to TLV index structure to populate.
+ * @param  fl         The pointer to flash backend holding the image.
+ * @param  hdr        The pointer to image header structure.
+ *
+ * @return 0 on success.
+ * @return -1 on failure.
+ */
+int tlv_index_build(struct image_tlv_index *idx, const struct image_flash *fl, const struct image_header *hdr);
+
+/**
+ * @brief Find a TLV in the TLV index.
+ *
+ * @param  idx        The pointer to TLV index structure.
+ * @param  type       The tag of TLV.
+ *
+ * @return The pointer to the TLV entry, NULL if the image has no such TLV.
+ */
+const struct image_tlv_entry *tlv_index_find(const struct image_tlv_index *idx, uint16_t type);
+
+/**
+ * @brief Number of image bytes covered by the image hash.
+ *
+ * @param  hdr        The pointer to image header structure.
+ *
+ * @return Header, body and protected TLV area size in bytes.
+ */
+uint32_t image_hashed_size(const struct image_header *hdr);
+
 /**
  * @brief Check if image magic is valid.
  *
@@ -165,12 +356,124 @@ int is_img_magic_valid(const struct image_header *hdr);
 /**
  * @brief Check if public key is valid.
  *
+ * @param  fl           The pointer to flash backend providing the OEM key hashes.
  * @param  key_addr     The pointer to public key.
  *
  * @return 0 if key is valid.
  * @return -1 if key is invalid.
  */
-int is_pub_key_valid(uint8_t *key_addr);
+int is_pub_key_valid(const struct image_flash *fl, const uint8_t *key_addr);
+
+/**
+ * @brief Find the OEM key hash slot matching a public key.
+ *
+ * @param  fl           The pointer to flash backend providing the OEM key hashes.
+ * @param  key_addr     The pointer to public key.
+ *
+ * @return Index of the matching OEM key hash slot.
+ * @return -1 if no slot matches.
+ */
+int image_pub_key_slot(const struct image_flash *fl, const uint8_t *key_addr);
+
+/**
+ * @brief Destroy the public keys imported by image validation.
+ *
+ * Keys are imported once per OEM key hash slot and reused by later
+ * validations. Call this before handing control to the application, or
+ * before deinitializing PSA crypto.
+ */
+void image_auth_keys_release(void);
+
+/**
+ * @brief Feed a programmed flash row to the streaming image hash.
+ *
+ * Called by the DFU write path after each row is programmed into the image
+ * slot. Rows that arrive in order starting at the slot base are hashed on the
+ * fly, so validate_image() only has to finalize the digest. A write to the
+ * slot base restarts the stream; any other out-of-order or rewritten row
+ * invalidates it and validate_image() falls back to hashing the slot.
+ *
+ * @param  addr       The address the row was programmed to.
+ * @param  data       The pointer to the programmed data.
+ * @param  len        The length of the programmed data.
+ */
+void img_hash_stream_update(uint32_t addr, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Discard the streaming image hash state.
+ *
+ * Called by the DFU write path when a row fed to the stream fails to program
+ * in the background, so validate_image() hashes the slot instead.
+ */
+void img_hash_stream_reset(void);
+
+/**
+ * @brief Feed a programmed flash row to the per-sector hashes.
+ *
+ * Called by the DFU write path after each row is programmed into the image
+ * slot. Each image body sector is hashed once its rows have arrived in
+ * order. Once the protected TLV area has been written, the digests are
+ * compared with the sector hash TLV. A sector sent again is hashed and
+ * checked again, so only bad sectors need to be retransmitted.
+ *
+ * The sector hash TLV is only authenticated by the final image validation.
+ * This check finds transfer errors early and does not replace that
+ * validation.
+ *
+ * @param  addr       The address of the programmed row.
+ * @param  data       The pointer to the row data.
+ * @param  len        The length of the row.
+ *
+ * @return 0 if no checked sector is bad.
+ * @return -1 if this row revealed a bad sector.
+ */
+int img_sector_update(uint32_t addr, const uint8_t *data, uint32_t len);
+
+/**
+ * @brief Bitmap of image body sectors that do not match the sector hash TLV.
+ *
+ * @return Bit n set if sector n is bad.
+ */
+uint32_t img_sector_bad_map(void);
+
+/**
+ * @brief Discard the per-sector hash state.
+ */
+void img_sector_reset(void);
+
+/**
+ * @brief Invalidate the verification cache before the slot is modified.
+ *
+ * Called by the DFU write path before a row is programmed, and when a DFU
+ * session starts. The metadata row is cleared the first time any other row
+ * of the slot is written, so an image modified after verification is always
+ * fully validated again. DFU writes from the host cannot reach the metadata
+ * row, the record is written through dfu_nvm_meta_write() only.
+ *
+ * @param  addr       The address of the row about to be programmed.
+ */
+void image_auth_cache_invalidate(uint32_t addr);
+
+/**
+ * @brief Validate an image through a flash backend.
+ *
+ * @param  fl         The pointer to flash backend holding the image slot.
+ *
+ * @return 0 on success.
+ * @return -1 on failure.
+ */
+int validate_image_flash(const struct image_flash *fl);
+
+/**
+ * @brief Start a validation job for an image held by a flash backend.
+ *
+ * @param  fl         The pointer to flash backend holding the image slot. The
+ *                    backend structure is copied.
+ *
+ * @return 0 on success.
+ * @return -1 on failure.
+ */
+int image_auth_job_start_flash(const struct image_flash *fl);
 
 #endif /* MCUBOOT_IMAGE) */
 
@@ -185,4 +488,49 @@ int is_pub_key_valid(uint8_t *key_addr);
 
 int validate_image(uint32_t boot_addr);
 
+/** Default number of image bytes hashed per image_auth_job_run() call. */
+#ifndef IMAGE_AUTH_JOB_SLICE_SIZE
+#define IMAGE_AUTH_JOB_SLICE_SIZE   (4096u)
+#endif
+
+/** Budget that completes the hashing step of a job in one call. */
+#define IMAGE_AUTH_JOB_UNBOUNDED    (0xFFFFFFFFu)
+
+/** Returned by image_auth_job_run() while the job is in progress. */
+#define IMAGE_AUTH_JOB_PENDING      (1)
+
+/**
+ * @brief Start a resumable validation job.
+ *
+ * The job performs the same checks as validate_image() but is driven from
+ * the main loop by image_auth_job_run(), like Cy_DFU_Continue(). Only one
+ * job exists at a time and starting a job aborts the running one.
+ * validate_image() runs a job to completion internally.
+ *
+ * @param  boot_addr  The start address of image.
+ *
+ * @return 0 on success.
+ * @return -1 on failure.
+ */
+int image_auth_job_start(uint32_t boot_addr);
+
+/**
+ * @brief Run one step of the validation job.
+ *
+ * A step is either the header and TLV checks, hashing at most budget bytes of
+ * the image, or the signature verification.
+ *
+ * @param  budget     The maximum number of image bytes to hash, non-zero.
+ *
+ * @return IMAGE_AUTH_JOB_PENDING if the job needs more steps.
+ * @return 0 if the image is valid.
+ * @return -1 if the image is invalid or no job is running.
+ */
+int image_auth_job_run(uint32_t budget);
+
+/**
+ * @brief Abort the validation job.
+ */
+void image_auth_job_abort(void);
+
 #endif /* IMAGE_AUTH_H_ */
@@ -54,11 +54,19 @@
 #include "cy_retarget_io.h"
 #include "cy_dfu.h"
 #include "dfu_user.h"
+#include "dfu_transport.h"
+#include "dfu_event.h"
+#include "dfu_time.h"
+#include "dfu_task.h"
 #include "transport_i2c.h"
+#ifdef COMPONENT_DFU_UART
+#include "transport_uart.h"
+#endif /* COMPONENT_DFU_UART */
 #include "cy_dfu_logging.h"
 #include "mtb_hal_i2c.h"
 #include "cy_scb_i2c.h"
 #include "cy_sysint.h"
+#include "cy_systick.h"
 
 
 /*******************************************************************************
@@ -67,15 +75,9 @@
 
 #define BOOT_ADDR                     (FLASH_SBUS_S_OFFSET + SLOT_OFFSET)
 
-/* Timeout for Cy_DFU_Continue(), in milliseconds */
+/* Timeout for the responses of Cy_DFU_Continue(), in milliseconds */
 #define DFU_SESSION_TIMEOUT_MS                     (20u)
 
-/* DFU idle wait timeout: 300 seconds*/
-#define DFU_IDLE_TIMEOUT_MS                        (300000u)
-
-/* DFU session timeout: 5 seconds */
-#define DFU_COMMAND_TIMEOUT_MS                     (5000u)
-
 #define IMG_CTR_MASK                               (0xFFFF)
 
 #if(UPDATE_IMG)
@@ -103,6 +105,12 @@ static mtb_hal_uart_t               DEBUG_UART_hal_obj;           /** Debug UART
 static mtb_hal_i2c_t                dfuI2cHalObj;                 /* I2C transport HAL object  */
 static cy_stc_scb_i2c_context_t     dfuI2cContext;                /* I2C transport PDL context structure*/
 
+#ifdef COMPONENT_DFU_UART
+/* For DFU UART interface */
+static mtb_hal_uart_t               dfuUartHalObj;                /* UART transport HAL object  */
+static cy_stc_scb_uart_context_t    dfuUartContext;               /* UART transport PDL context structure*/
+#endif /* COMPONENT_DFU_UART */
+
 
 /*******************************************************************************
 * Function Prototypes
@@ -139,40 +147,31 @@ void launch_app(uint32_t boot_addr);
  *******************************************************************************/
 void start_app(uint32_t sp, uint32_t rst_handler);
 
-/*******************************************************************************
- * Function Name: dfu_status_in_str
- ********************************************************************************
- * Summary:
- * This is the function to convert DFU status in elaborative text
- *
- * Parameters:
- *  dfu_status
- *
- * Return:
- *  string pointer
- *
- *******************************************************************************/
-char* dfu_status_in_str(cy_en_dfu_status_t dfu_status);
+void dfuI2cIsr(void);
+
+void dfuI2cTransportCallback(cy_en_dfu_transport_i2c_action_t action);
+
+#ifdef COMPONENT_DFU_UART
+void dfuUartTransportCallback(cy_en_dfu_transport_uart_action_t action);
+#endif /* COMPONENT_DFU_UART */
+
+#if (DFU_EVENT_LOOP != 0u)
+void dfuTickCallback(void);
+
+#ifdef COMPONENT_DFU_UART
+void dfuUartIsr(void);
+#endif /* COMPONENT_DFU_UART */
 
 /*******************************************************************************
- * Function Name: counter_timeout_seconds
+ * Function Name: transport_rx_arm
  ********************************************************************************
  * Summary:
- *  Function to return DFU loop count for various target timeout .
- *
- * Parameters:
- *  seconds - time in seconds for particular timeout
- *  timeout - timeout for particular DFU loop
- *
- * Return:
- *  count - Total DFU Loop count value for particular timeout.
+ *  Re-enables the receive interrupts that signal DFU_EVENT_RX once, so the
+ *  loop is woken by the next data.
  *
  *******************************************************************************/
-static uint32_t counter_timeout_seconds(uint32_t seconds, uint32_t timeout);
-
-void dfuI2cIsr(void);
-
-void dfuI2cTransportCallback(cy_en_dfu_transport_i2c_action_t action);
+static void transport_rx_arm(void);
+#endif /* DFU_EVENT_LOOP */
 
 
 /*******************************************************************************
@@ -219,6 +218,11 @@ CY_SECTION_RAMFUNC_END
 void dfuI2cIsr(void)
 {
     mtb_hal_i2c_process_interrupt(&dfuI2cHalObj);
+
+#if (DFU_EVENT_LOOP != 0u)
+    /* Bus activity wakes the loop, the DFU read then waits for the end of the packet */
+    dfu_event_signal(DFU_EVENT_RX);
+#endif /* DFU_EVENT_LOOP */
 }
 
 void dfuI2cTransportCallback(cy_en_dfu_transport_i2c_action_t action)
@@ -235,52 +239,48 @@ void dfuI2cTransportCallback(cy_en_dfu_transport_i2c_action_t action)
     }
 }
 
-static uint32_t counter_timeout_seconds(uint32_t seconds, uint32_t timeout) {
-    uint32_t count = 1;
-
-    if (timeout != 0) {
-        count = ((seconds) / timeout);
+#ifdef COMPONENT_DFU_UART
+void dfuUartTransportCallback(cy_en_dfu_transport_uart_action_t action)
+{
+    if (action == CY_DFU_TRANSPORT_UART_INIT)
+    {
+        Cy_SCB_UART_Enable(DFU_UART_HW);
+        CY_DFU_LOG_INF("UART transport is enabled");
+    }
+    else if (action == CY_DFU_TRANSPORT_UART_DEINIT)
+    {
+        Cy_SCB_UART_Disable(DFU_UART_HW, &dfuUartContext);
+        CY_DFU_LOG_INF("UART transport is disabled");
     }
-
-    return count;
 }
+#endif /* COMPONENT_DFU_UART */
 
-char* dfu_status_in_str(cy_en_dfu_status_t dfu_status) {
-    switch (dfu_status) {
-    case CY_DFU_SUCCESS:
-        return "DFU: success";
-
-    case CY_DFU_ERROR_VERIFY:
-        return "DFU:Verification failed";
-
-    case CY_DFU_ERROR_LENGTH:
-        return "DFU: The length the packet is outside of the expected range";
-
-    case CY_DFU_ERROR_DATA:
-        return "DFU: The data in the received packet is invalid";
-
-    case CY_DFU_ERROR_CMD:
-        return "DFU: The command is not recognized";
-
-    case CY_DFU_ERROR_CHECKSUM:
-        return "DFU: The checksum does not match the expected value ";
-
-    case CY_DFU_ERROR_ADDRESS:
-        return "DFU: The wrong address";
-
-    case CY_DFU_ERROR_TIMEOUT:
-        return "DFU: The command timed out";
-
-    case CY_DFU_ERROR_BAD_PARAM:
-        return "DFU: One or more of input parameters are invalid";
+#if (DFU_EVENT_LOOP != 0u)
+void dfuTickCallback(void)
+{
+    dfu_event_signal(DFU_EVENT_TICK);
+}
 
-    case CY_DFU_ERROR_UNKNOWN:
-        return "DFU: did not recognize error";
+#ifdef COMPONENT_DFU_UART
+void dfuUartIsr(void)
+{
+    /* The transport reads the FIFO by polling, the interrupt only wakes the loop */
+    Cy_SCB_SetRxInterruptMask(DFU_UART_HW, 0u);
+    Cy_SCB_ClearRxInterrupt(DFU_UART_HW, CY_SCB_RX_INTR_NOT_EMPTY);
+    dfu_event_signal(DFU_EVENT_RX);
+}
+#endif /* COMPONENT_DFU_UART */
 
-    default:
-        return "Not recognized DFU status code";
-    }
+static void transport_rx_arm(void)
+{
+#ifdef COMPONENT_DFU_UART
+    /* Fires at once when data is already waiting */
+    Cy_SCB_ClearRxInterrupt(DFU_UART_HW, CY_SCB_RX_INTR_NOT_EMPTY);
+    Cy_SCB_SetRxInterruptMask(DFU_UART_HW, CY_SCB_RX_INTR_NOT_EMPTY);
+#endif /* COMPONENT_DFU_UART */
 }
+#endif /* DFU_EVENT_LOOP */
+
 
 
 /*******************************************************************************
@@ -301,15 +301,18 @@ char* dfu_status_in_str(cy_en_dfu_status_t dfu_status) {
 int main(void)
 {
     cy_rslt_t result;
+#if defined (MCUBOOT_IMAGE)
     int status;
+#endif /* MCUBOOT_IMAGE */
 
-    uint32_t count = 0;
-    uint32_t timeout_seconds = 0;
+    /* LED blink of the application */
+    dfu_deadline_t led_deadline;
 
     /* Status codes for DFU API. */
     cy_en_dfu_status_t dfu_status;
 
-    uint32_t dfu_state = CY_DFU_STATE_NONE;
+    /* Result of the last DFU task call */
+    dfu_task_status_t task_status;
 
     /* Buffer to store DFU commands. */
     CY_ALIGN(4) static uint8_t dfu_buffer[CY_DFU_SIZEOF_DATA_BUFFER];
@@ -426,8 +429,47 @@ int main(void)
     };
     Cy_DFU_TransportI2cConfig(&i2cTransportCfg);
 
+#ifdef COMPONENT_DFU_UART
+    result = (cy_rslt_t)Cy_SCB_UART_Init(DFU_UART_HW, &DFU_UART_config, &dfuUartContext);
+    if (CY_RSLT_SUCCESS == result)
+    {
+        result = mtb_hal_uart_setup(&dfuUartHalObj, &DFU_UART_hal_config, &dfuUartContext, NULL);
+    }
+    if (CY_RSLT_SUCCESS != result)
+    {
+        CY_DFU_LOG_ERR("Error during UART initialization. Status: %lX", (unsigned long)result);
+    }
+#if (DFU_EVENT_LOOP != 0u)
+    else
+    {
+        cy_stc_sysint_t uartIsrCfg =
+        {
+            .intrSrc = DFU_UART_IRQ,
+            .intrPriority = 3U
+        };
+        pdlSysIntStatus = Cy_SysInt_Init(&uartIsrCfg, dfuUartIsr);
+        if (CY_SYSINT_SUCCESS != pdlSysIntStatus)
+        {
+            CY_DFU_LOG_ERR("Error during UART Interrupt initialization. Status: %X", pdlSysIntStatus);
+        }
+        else
+        {
+            NVIC_EnableIRQ((IRQn_Type) uartIsrCfg.intrSrc);
+        }
+    }
+#endif /* DFU_EVENT_LOOP */
+
+    cy_stc_dfu_transport_uart_cfg_t uartTransportCfg =
+    {
+        .uart = &dfuUartHalObj,
+        .callback = dfuUartTransportCallback,
+    };
+    Cy_DFU_TransportUartConfig(&uartTransportCfg);
+#endif /* COMPONENT_DFU_UART */
+
     /* Initialize DFU Structure. */
-    dfu_status = Cy_DFU_Init(&dfu_state, &dfu_params);
+    dfu_time_start();
+    dfu_status = dfu_task_init(&dfu_params, BOOT_ADDR);
     if (CY_DFU_SUCCESS != dfu_status)
     {
         printf("DFU initialization failed \r\n");
@@ -435,100 +477,59 @@ int main(void)
     }
 
     /* Initialize DFU communication. */
+#if (DFU_TRANSPORT_LISTEN != 0u)
+    /* All transports, the first host to send a valid packet gets the session */
+    CY_UNUSED_PARAMETER(dfu_transport);
+    dfu_transport_listen();
+#else
     Cy_DFU_TransportStart(dfu_transport);
+#endif /* DFU_TRANSPORT_LISTEN */
+
+    dfu_deadline_start(&led_deadline, LED_TOGGLE_INTERVAL_MS);
+
+#if (DFU_EVENT_LOOP != 0u)
+    /* Wakes the loop for the timeouts and the LED while no command arrives, callback 0 is the time base */
+    (void) Cy_SysTick_SetCallback(1u, dfuTickCallback);
+#endif /* DFU_EVENT_LOOP */
 
     printf("\r\nSTARTING DFU \r\n ");
 
 
     for (;;)
     {
-        dfu_status = Cy_DFU_Continue(&dfu_state, &dfu_params);
-        count++;
-        if (CY_DFU_STATE_FINISHED == dfu_state)
-        {
-            count = 0u;
-            if (CY_DFU_SUCCESS == dfu_status)
-            {
-                printf("\r\nAuthenticating  Application\r\n");
-
-                /* Validate image */
-                status = validate_image(BOOT_ADDR);
-
-                if (status != 0)
-                {
-                    CY_ASSERT(0);
-                }
-
-                Cy_DFU_TransportStop();
-                printf("Image Authentication successful\r\n");
-                printf("Launching new firmware\r\n");
-                cy_retarget_io_deinit();
-
-                /* Launch validated image */
-                launch_app(BOOT_ADDR);
-            }
-            else
-            {
-                  Cy_DFU_Init(&dfu_state, &dfu_params);
-                  printf("DFU_STATE_FINISHED: %s \r\n",
-                                      dfu_status_in_str(dfu_status));
-            }
-        }
-        else if (CY_DFU_STATE_FAILED == dfu_state)
-        {
-            count = 0u;
-            Cy_DFU_Init(&dfu_state, &dfu_params);
-            printf("DFU_STATE_FAILED: %s \r\n", dfu_status_in_str(dfu_status));
-        }
-        else if (dfu_state == CY_DFU_STATE_UPDATING)
-        {
-            timeout_seconds = (count >= counter_timeout_seconds(DFU_COMMAND_TIMEOUT_MS, DFU_SESSION_TIMEOUT_MS)) ? 1U : 0u;
-
-            /* if no command has been received during 5 seconds when the loading
-             * has started then restart loading.
-             */
-            if (dfu_status == CY_DFU_SUCCESS)
-            {
-                count = 0u;
-            }
-            else if (dfu_status == CY_DFU_ERROR_TIMEOUT)
-            {
-                if (timeout_seconds != 0u)
-                {
-                    count = 0u;
-
-                  /* Restart DFU. */
-                }
-            }
-            else
-            {
-                count = 0u;
-
-                /* Delay because Transport still may be sending error response to a host. */
-                Cy_SysLib_Delay(DFU_SESSION_TIMEOUT_MS);
-
-                /* Restart DFU. */
-             }
-        }
-
-        /* Blink LED */
-        if ((count % counter_timeout_seconds(LED_TOGGLE_INTERVAL_MS, DFU_SESSION_TIMEOUT_MS)) == 0u)
+        /* The application: blinks the LED, a control loop would run here at its own rate */
+        if (dfu_deadline_periodic(&led_deadline))
         {
             /* Invert the USER LED state */
             Cy_GPIO_Inv(CYBSP_USER_LED1_PORT, CYBSP_USER_LED1_PIN);
-
         }
 
-        if ((count >= counter_timeout_seconds(DFU_IDLE_TIMEOUT_MS, DFU_SESSION_TIMEOUT_MS)) && (dfu_state == CY_DFU_STATE_NONE))
+#if (DFU_EVENT_LOOP != 0u)
+        transport_rx_arm();
+#endif /* DFU_EVENT_LOOP */
+
+        /* DFU in the background, within a CPU budget per pass of the application */
+        task_status = dfu_task_run(DFU_TASK_BUDGET_US);
+
+        if (DFU_TASK_READY == task_status)
+        {
+            /* The application switches when it can stop, this one at once */
+            Cy_DFU_TransportStop();
+            dfu_time_stop();
+            printf("Longest DFU task call: %lu us\r\n", (unsigned long)dfu_task_longest_us(false));
+            printf("Launching new firmware\r\n");
+            cy_retarget_io_deinit();
+
+            /* Launch validated image */
+            launch_app(BOOT_ADDR);
+        }
+#if (DFU_EVENT_LOOP != 0u)
+        else if (DFU_TASK_IDLE == task_status)
         {
-            /* In case, no valid user application, lets start fresh all over.
-             * This is just for demonstration.
-             * Final application can change it to either assert, reboot, enter low power mode etc,
-             * based on usecase requirements.
-             */
-            count = 0;
+            /* Nothing for the application or the DFU until the next interrupt */
+            dfu_event_sleep(DFU_EVENT_RX | DFU_EVENT_TICK);
         }
-          Cy_SysLib_Delay(1);
+#endif /* DFU_EVENT_LOOP */
     }
 }
 /* [] END OF FILE */
@@ -24,12 +24,19 @@ else ifeq ($(IMG_TYPE),UPDATE)
 IMAGE_VERSION?=1.1.0
 endif #($(IMG_TYPE),BOOT)
 
-SLOT_SIZE=0x20000
+#Slot size excluding the image metadata row reserved at the end of the bank
+SLOT_SIZE=0x1FE00
 
 KEY_PATH=./keys/oem_rot_priv_key_0.pem
 
 #Setting up the Additional Arguments
-ADDITIONAL_ARGS?=--align 1 -s 0 --public-key-format full --pubkey-encoding raw --signature-encoding raw --min-erase-size 0x200 --overwrite-only
+ADDITIONAL_ARGS?=--align 1 -s 0 --public-key-format $(PUBKEY_FORMAT) --pubkey-encoding raw --signature-encoding raw --min-erase-size 0x200 --overwrite-only
+
+#Add the sector hash TLV so corrupted sectors are found and resent during an update
+SECTOR_HASH?=FALSE
+ifeq ($(SECTOR_HASH),TRUE)
+SECTOR_HASH_ARGS=--custom-tlv 0xA0 $$($(CY_PYTHON_PATH) ./scripts/sector_hash.py --image $(INPUT_IMAGE).bin)
+endif #($(SECTOR_HASH),TRUE)
 
 #Signing the image for secured boot
 POSTBUILD+=edgeprotecttools sign-image --image $(INPUT_IMAGE).bin \
@@ -40,6 +47,7 @@ POSTBUILD+=edgeprotecttools sign-image --image $(INPUT_IMAGE).bin \
                                            --slot-size $(SLOT_SIZE) \
                                            --key $(KEY_PATH) \
                                            --image-version $(IMAGE_VERSION) \
+                                           $(SECTOR_HASH_ARGS) \
                                            $(ADDITIONAL_ARGS);
 
 POSTBUILD+=cp $(OUTPUT_IMAGE).hex ./build/last_config/$(APPNAME).hex;
@@ -48,5 +56,10 @@ POSTBUILD+=edgeprotecttools bin2hex --image $(INPUT_IMAGE).bin \
                                     --output $(OUTPUT_IMAGE).hex \
                                     --offset $(APP_START);
 
+#Append the CRC32C trailer checked by validate_image() before the image is launched
+POSTBUILD+=$(CY_PYTHON_PATH) ./scripts/image_crc.py --image $(INPUT_IMAGE).bin \
+                                                    --hex $(OUTPUT_IMAGE).hex \
+                                                    --address $(APP_START);
+
 POSTBUILD+=cp $(OUTPUT_IMAGE).hex ./build/last_config/$(APPNAME).hex;
 endif # ($(SECURED_BOOT),TRUE)
\ No newline at end of file
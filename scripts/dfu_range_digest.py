@@ -0,0 +1,197 @@
+#!/usr/bin/env python3
+##############################################################################
+# File Name:   dfu_range_digest.py
+#
+# Description: Host side of the DFU range digest command. Checks a written
+#              range of the device against an image with one command instead
+#              of a compare per row.
+#
+##############################################################################
+# Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+##############################################################################
+"""Checks an address range of the device against an image with one DFU command.
+
+Sends DFU_APP_CMD_RANGE_DIGEST (see dfu_app_cmd.h) over Linux i2c-dev and
+compares the returned CRC32C or SHA-256 with the digest of the same range of
+the image. The image is an Intel HEX file, or a binary with --image-address.
+Bytes the image does not cover are taken as --fill. The device only digests
+whole rows of the image slot.
+
+--print-packet prints the command packet instead of sending it, for use with
+other I2C bridges.
+"""
+
+import argparse
+import fcntl
+import hashlib
+import os
+import struct
+import sys
+import time
+
+from image_crc import crc32c
+
+DFU_PACKET_SOP = 0x01
+DFU_PACKET_EOP = 0x17
+DFU_PACKET_OVERHEAD = 7
+DFU_APP_CMD_RANGE_DIGEST = 0x60
+DFU_APP_DIGEST_CRC32C = 0x00
+DFU_APP_DIGEST_SHA256 = 0x01
+DFU_SUCCESS = 0x00
+
+I2C_SLAVE = 0x0703
+
+
+def checksum(data):
+    """Returns the DFU packet checksum of the bytes ahead of it."""
+    return (1 + ~sum(data)) & 0xFFFF
+
+
+def packet(cmd, data):
+    """Returns a DFU command packet."""
+    head = bytes([DFU_PACKET_SOP, cmd]) + struct.pack('<H', len(data)) + data
+    return head + struct.pack('<H', checksum(head)) + bytes([DFU_PACKET_EOP])
+
+
+def parse_response(rsp):
+    """Returns (status, data) of a DFU response packet."""
+    if len(rsp) < DFU_PACKET_OVERHEAD or rsp[0] != DFU_PACKET_SOP:
+        raise ValueError('no response packet')
+    length = struct.unpack_from('<H', rsp, 2)[0]
+    if len(rsp) < length + DFU_PACKET_OVERHEAD or rsp[length + 6] != DFU_PACKET_EOP:
+        raise ValueError('truncated response packet')
+    if struct.unpack_from('<H', rsp, length + 4)[0] != checksum(rsp[:length + 4]):
+        raise ValueError('response checksum mismatch')
+    return rsp[1], rsp[4:4 + length]
+
+
+def read_hex(path):
+    """Returns {address: byte} of an Intel HEX file."""
+    mem = {}
+    upper = 0
+    with open(path) as f:
+        for line in f:
+            line = line.strip()
+            if not line.startswith(':'):
+                continue
+            rec = bytes.fromhex(line[1:])
+            length, addr, rec_type = rec[0], (rec[1] << 8) | rec[2], rec[3]
+            if rec_type == 0x00:
+                for i, byte in enumerate(rec[4:4 + length]):
+                    mem[upper + addr + i] = byte
+            elif rec_type == 0x04:
+                upper = struct.unpack('>H', rec[4:6])[0] << 16
+            elif rec_type == 0x01:
+                break
+    return mem
+
+
+def image_range(args):
+    """Returns the bytes of the checked range as the image sets them."""
+    if args.image_address is None:
+        mem = read_hex(args.image)
+    else:
+        with open(args.image, 'rb') as f:
+            mem = {args.image_address + i: b for i, b in enumerate(f.read())}
+    return bytes(mem.get(args.address + i, args.fill) for i in range(args.length))
+
+
+def transfer(args, cmd_packet, rsp_len):
+    """Sends a command packet and polls for its response."""
+    fd = os.open(f'/dev/i2c-{args.bus}', os.O_RDWR)
+    try:
+        fcntl.ioctl(fd, I2C_SLAVE, args.i2c_address)
+        os.write(fd, cmd_packet)
+        deadline = time.monotonic() + args.timeout
+        while True:
+            try:
+                rsp = os.read(fd, rsp_len)
+                if rsp and rsp[0] == DFU_PACKET_SOP:
+                    return rsp
+            except OSError:
+                pass
+            if time.monotonic() > deadline:
+                raise TimeoutError('no response from the device')
+            time.sleep(0.005)
+    finally:
+        os.close(fd)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--address', type=lambda v: int(v, 0), required=True,
+                        help='Start address of the range')
+    parser.add_argument('--length', type=lambda v: int(v, 0), required=True,
+                        help='Length of the range in bytes, a multiple of the row size')
+    parser.add_argument('--sha256', action='store_true', help='Use SHA-256 instead of CRC32C')
+    parser.add_argument('--image', help='Intel HEX file or binary to compare with')
+    parser.add_argument('--image-address', type=lambda v: int(v, 0),
+                        help='Load address of a binary image')
+    parser.add_argument('--fill', type=lambda v: int(v, 0), default=0x00,
+                        help='Value of bytes the image does not cover (default 0x00)')
+    parser.add_argument('--bus', type=int, default=1, help='I2C bus number, /dev/i2c-<bus>')
+    parser.add_argument('--i2c-address', type=lambda v: int(v, 0), default=8,
+                        help='DFU I2C address of the device (default 8)')
+    parser.add_argument('--timeout', type=float, default=2.0,
+                        help='Seconds to wait for the digest (default 2)')
+    parser.add_argument('--print-packet', action='store_true',
+                        help='Print the command packet and exit')
+    args = parser.parse_args()
+
+    alg = DFU_APP_DIGEST_SHA256 if args.sha256 else DFU_APP_DIGEST_CRC32C
+    cmd_packet = packet(DFU_APP_CMD_RANGE_DIGEST, struct.pack('<IIB', args.address, args.length, alg))
+    rsp_len = DFU_PACKET_OVERHEAD + (32 if args.sha256 else 4)
+
+    if args.print_packet:
+        print(cmd_packet.hex())
+        return
+
+    try:
+        status, digest = parse_response(transfer(args, cmd_packet, rsp_len))
+    except (OSError, ValueError) as err:
+        sys.exit(f'dfu_range_digest.py: {err}')
+
+    if status != DFU_SUCCESS:
+        sys.exit(f'dfu_range_digest.py: device status 0x{status:02X}')
+
+    print(f'device {digest.hex()}')
+    if args.image:
+        data = image_range(args)
+        expected = hashlib.sha256(data).digest() if args.sha256 else struct.pack('<I', crc32c(data))
+        print(f'image  {expected.hex()}')
+        if digest != expected:
+            sys.exit('MISMATCH')
+        print('MATCH')
+
+
+if __name__ == '__main__':
+    main()
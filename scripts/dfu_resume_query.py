@@ -0,0 +1,141 @@
+#!/usr/bin/env python3
+##############################################################################
+# File Name:   dfu_resume_query.py
+#
+# Description: Host side of the DFU resume query command. Reports the rows
+#              of an interrupted download that the device still needs.
+#
+##############################################################################
+# Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+##############################################################################
+"""Reports the rows an interrupted DFU download still has to send.
+
+Sends DFU_APP_CMD_RESUME_QUERY (see dfu_app_cmd.h) over Linux i2c-dev with a
+tag for the image, by default the CRC32C of the image file. The device keeps
+the rows it completed for that tag, the next DFU session then only needs the
+missing ones. --out writes the image rows the device does not have as an
+Intel HEX file for the DFU host tool.
+
+Run it right before the DFU session is entered: a session entered without a
+query starts over.
+"""
+
+import argparse
+import struct
+import sys
+
+from dfu_range_digest import DFU_SUCCESS, DFU_PACKET_OVERHEAD, packet, parse_response, read_hex, transfer
+from image_crc import crc32c
+
+DFU_APP_CMD_RESUME_QUERY = 0x61
+
+
+def write_hex(path, mem):
+    """Writes {address: byte} as an Intel HEX file."""
+    def record(rec_type, addr, data):
+        rec = bytes([len(data), (addr >> 8) & 0xFF, addr & 0xFF, rec_type]) + data
+        return ':' + (rec + bytes([(-sum(rec)) & 0xFF])).hex().upper() + '\n'
+
+    lines = []
+    upper = None
+    addrs = sorted(mem)
+    i = 0
+    while i < len(addrs):
+        start = addrs[i]
+        chunk = bytearray()
+        while i < len(addrs) and addrs[i] == start + len(chunk) and len(chunk) < 16 and \
+                (start + len(chunk)) >> 16 == start >> 16:
+            chunk.append(mem[addrs[i]])
+            i += 1
+        if start >> 16 != upper:
+            upper = start >> 16
+            lines.append(record(0x04, 0, struct.pack('>H', upper)))
+        lines.append(record(0x00, start & 0xFFFF, bytes(chunk)))
+    lines.append(':00000001FF\n')
+    with open(path, 'w') as f:
+        f.writelines(lines)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--image', required=True, help='Intel HEX file of the download')
+    parser.add_argument('--tag', type=lambda v: int(v, 0),
+                        help='Image tag (default CRC32C of the image file), 0 forgets the journal')
+    parser.add_argument('--out', help='Write the rows still needed to this Intel HEX file')
+    parser.add_argument('--bus', type=int, default=1, help='I2C bus number, /dev/i2c-<bus>')
+    parser.add_argument('--i2c-address', type=lambda v: int(v, 0), default=8,
+                        help='DFU I2C address of the device (default 8)')
+    parser.add_argument('--timeout', type=float, default=2.0,
+                        help='Seconds to wait for the response (default 2)')
+    parser.add_argument('--print-packet', action='store_true',
+                        help='Print the command packet and exit')
+    args = parser.parse_args()
+
+    if args.tag is None:
+        with open(args.image, 'rb') as f:
+            args.tag = crc32c(f.read()) or 1
+
+    cmd_packet = packet(DFU_APP_CMD_RESUME_QUERY, struct.pack('<I', args.tag))
+    if args.print_packet:
+        print(cmd_packet.hex())
+        return
+
+    try:
+        status, data = parse_response(transfer(args, cmd_packet, DFU_PACKET_OVERHEAD + 8 + 64))
+    except (OSError, ValueError) as err:
+        sys.exit(f'dfu_resume_query.py: {err}')
+
+    if status != DFU_SUCCESS:
+        sys.exit(f'dfu_resume_query.py: device status 0x{status:02X}')
+
+    base, row_size, rows = struct.unpack_from('<IHH', data)
+    done = data[8:]
+    mem = read_hex(args.image)
+    needed = {}
+    image_rows = 0
+    for row in range(rows):
+        start = base + row * row_size
+        row_bytes = {a: mem[a] for a in range(start, start + row_size) if a in mem}
+        if not row_bytes:
+            continue
+        image_rows += 1
+        if not (done[row // 8] >> (row % 8)) & 1:
+            needed.update(row_bytes)
+
+    missing = len({(a - base) // row_size for a in needed})
+    print(f'tag 0x{args.tag:08X}: {image_rows - missing} of {image_rows} image rows done, {missing} to send')
+    if args.out:
+        write_hex(args.out, needed)
+
+
+if __name__ == '__main__':
+    main()
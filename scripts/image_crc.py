@@ -0,0 +1,106 @@
+#!/usr/bin/env python3
+##############################################################################
+# File Name:   image_crc.py
+#
+# Description: Appends the CRC32C integrity trailer of an image without MCUBoot
+#              format to its HEX file.
+#
+##############################################################################
+# Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+##############################################################################
+"""Appends the CRC32C trailer of an unsigned image to its Intel HEX file.
+
+The trailer is written at the start of the image metadata row and holds
+the magic, the image length, the CRC32C of the image and a check word. It
+must match struct image_crc_trailer in image_auth.h.
+"""
+
+import argparse
+import struct
+import sys
+
+IMAGE_CRC_MAGIC = 0x43524343
+
+
+def crc32c(data):
+    """Returns the CRC32C (Castagnoli) of data."""
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0x82F63B78 if crc & 1 else crc >> 1
+    return crc ^ 0xFFFFFFFF
+
+
+def hex_record(rec_type, addr, data):
+    rec = bytes([len(data), (addr >> 8) & 0xFF, addr & 0xFF, rec_type]) + data
+    return ':' + (rec + bytes([(-sum(rec)) & 0xFF])).hex().upper()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--image', required=True, help='Application binary')
+    parser.add_argument('--hex', required=True, help='Intel HEX file of the image, updated in place')
+    parser.add_argument('--address', type=lambda v: int(v, 0), required=True,
+                        help='Start address of the image')
+    parser.add_argument('--meta-offset', type=lambda v: int(v, 0), default=0x1FE00,
+                        help='Offset of the image metadata row (default 0x1FE00)')
+    args = parser.parse_args()
+
+    try:
+        with open(args.image, 'rb') as f:
+            body = f.read()
+        with open(args.hex) as f:
+            lines = [line.strip() for line in f if line.strip()]
+    except OSError as err:
+        sys.exit(f'image_crc.py: {err}')
+
+    if not body or len(body) > args.meta_offset:
+        sys.exit('image_crc.py: image overlaps the metadata row')
+
+    crc = crc32c(body)
+    check = ~IMAGE_CRC_MAGIC & 0xFFFFFFFF ^ len(body) ^ crc
+    trailer = struct.pack('<IIII', IMAGE_CRC_MAGIC, len(body), crc, check)
+    addr = args.address + args.meta_offset
+
+    # Replace the end of file record by the trailer and a new end of file record
+    lines = [line for line in lines if line[7:9] != '01']
+    lines.append(hex_record(0x04, 0, struct.pack('>H', addr >> 16)))
+    lines.append(hex_record(0x00, addr & 0xFFFF, trailer))
+    lines.append(hex_record(0x01, 0, b''))
+
+    with open(args.hex, 'w') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
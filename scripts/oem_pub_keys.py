@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+##############################################################################
+# File Name:   oem_pub_keys.py
+#
+# Description: Generates oem_pub_keys.h, the OEM public key store used to verify
+#              images signed with a key hash TLV (PUBKEY_FORMAT=hash).
+#
+##############################################################################
+# Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+##############################################################################
+"""Generates the OEM public key store header from the OEM key PEM files."""
+
+import argparse
+import sys
+
+from cryptography.hazmat.primitives import serialization
+from cryptography.hazmat.primitives.asymmetric import ec
+
+
+def load_pub_key(path):
+    """Returns the uncompressed P-256 point of a PEM public or private key."""
+    with open(path, 'rb') as f:
+        data = f.read()
+    try:
+        key = serialization.load_pem_public_key(data)
+    except ValueError:
+        key = serialization.load_pem_private_key(data, password=None).public_key()
+    if not isinstance(key, ec.EllipticCurvePublicKey) or key.curve.name != 'secp256r1':
+        raise ValueError(f'{path}: not an ECDSA P-256 key')
+    return key.public_bytes(serialization.Encoding.X962,
+                            serialization.PublicFormat.UncompressedPoint)
+
+
+def c_initializer(raw):
+    rows = []
+    for i in range(0, len(raw), 12):
+        rows.append('    ' + ', '.join(f'0x{b:02x}' for b in raw[i:i + 12]))
+    return '{ \\\n' + ', \\\n'.join(rows) + ' \\\n}'
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('--out', required=True, help='Output header file')
+    parser.add_argument('keys', nargs=2, metavar='KEY',
+                        help='PEM key of OEM key slot 0 and 1')
+    args = parser.parse_args()
+
+    lines = ['/* Generated by scripts/oem_pub_keys.py, do not edit. */',
+             '#ifndef OEM_PUB_KEYS_H_',
+             '#define OEM_PUB_KEYS_H_',
+             '']
+    for idx, path in enumerate(args.keys):
+        try:
+            raw = load_pub_key(path)
+        except (OSError, ValueError) as err:
+            sys.exit(f'oem_pub_keys.py: {err}')
+        lines.append(f'/* {path} */')
+        lines.append(f'#define OEM_PUB_KEY_{idx} {c_initializer(raw)}')
+        lines.append('')
+    lines.append('#endif /* OEM_PUB_KEYS_H_ */')
+
+    with open(args.out, 'w', newline='\n') as f:
+        f.write('\n'.join(lines) + '\n')
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+##############################################################################
+# File Name:   sector_hash.py
+#
+# Description: Computes the sector hash TLV (0xA0) of an application binary
+#              for edgeprotecttools sign-image --custom-tlv.
+#
+##############################################################################
+# Copyright 2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+##############################################################################
+"""Prints the sector hash TLV value of an application binary as 0x<hex>.
+
+The value is a little endian 32-bit sector size followed by the first 16
+bytes of the SHA-256 of each sector of the binary. The binary is the image
+body, so sector 0 starts right after the MCUboot header. Custom TLVs are
+placed in the protected TLV area and are covered by the image signature.
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+SECTOR_HASH_LEN = 16
+
+
+def sector_table(body, sector_size):
+    """Returns the sector hash TLV data of an image body."""
+    table = struct.pack('<I', sector_size)
+    for off in range(0, len(body), sector_size):
+        table += hashlib.sha256(body[off:off + sector_size]).digest()[:SECTOR_HASH_LEN]
+    return table
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('--image', required=True, help='Application binary (image body)')
+    parser.add_argument('--sector-size', type=lambda v: int(v, 0), default=0x1000,
+                        help='Sector size, must match IMAGE_SECTOR_SIZE (default 0x1000)')
+    args = parser.parse_args()
+
+    if args.sector_size <= 0 or args.sector_size % 0x200:
+        sys.exit('sector_hash.py: sector size must be a multiple of 0x200')
+
+    try:
+        with open(args.image, 'rb') as f:
+            body = f.read()
+    except OSError as err:
+        sys.exit(f'sector_hash.py: {err}')
+
+    print('0x' + sector_table(body, args.sector_size).hex())
+
+
+if __name__ == '__main__':
+    main()